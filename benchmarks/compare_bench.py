@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+#
+# This file is part of stator.
+#
+# stator is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# stator is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with stator. If not, see <http://www.gnu.org/licenses/>.
+
+"""Compares two runs of a benchmark written with --json.
+
+  compare_bench.py before.json after.json [--threshold=0.05]
+
+Prints each measurement of both runs and their ratio (after/before),
+marking the timings which changed by more than the threshold.
+"""
+
+import json
+import sys
+
+
+def load(filename):
+    with open(filename) as f:
+        return {r["name"]: r for r in json.load(f)["results"]}
+
+
+def main(argv):
+    threshold = 0.05
+    files = []
+    for arg in argv[1:]:
+        if arg.startswith("--threshold="):
+            threshold = float(arg[len("--threshold="):])
+        else:
+            files.append(arg)
+    if len(files) != 2:
+        print(__doc__)
+        return 1
+
+    before, after = load(files[0]), load(files[1])
+    width = max([len(name) for name in before] + [len(name) for name in after] + [4])
+    print("%-*s %14s %14s %8s" % (width, "name", "before", "after", "ratio"))
+    for name in list(before) + [n for n in after if n not in before]:
+        b, a = before.get(name), after.get(name)
+        if b is None or a is None:
+            r = b or a
+            print("%-*s %14s %14s %8s" % (width, name, "-" if b is None else "%.6g" % b["value"], "-" if a is None else "%.6g" % a["value"], "") + " " + r["unit"])
+            continue
+        ratio = a["value"] / b["value"] if b["value"] else float("nan")
+        mark = ""
+        if a["unit"] == "ns" and abs(ratio - 1) > threshold:
+            mark = " slower" if ratio > 1 else " faster"
+        print("%-*s %14.6g %14.6g %8.3f %s%s" % (width, name, b["value"], a["value"], ratio, a["unit"], mark))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
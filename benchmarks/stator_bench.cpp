@@ -0,0 +1,170 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//The reference suite of representative workloads, used to track the
+//performance of the library between changes: parsing, deep sums,
+//chains of derivatives, Jacobians, evaluation, Taylor series, and
+//high order polynomials. Record a run with
+//
+//  stator_bench --json=before.json
+//
+//and compare two runs with benchmarks/compare_bench.py.
+
+#include <stator/symbolic/ad.hpp>
+#include <stator/symbolic/native.hpp>
+#include <stator/symbolic/sparse_polynomial.hpp>
+#include <stator/symbolic/symbolic.hpp>
+#include <stator/benchmark.hpp>
+
+using namespace sym;
+
+namespace {
+  //A sum of n terms, nested as a chain of binary additions
+  std::string deep_sum(int n) {
+    std::string out;
+    for (int i(0); i < n; ++i)
+      out += (i ? "+" : "") + std::to_string(i % 7 + 1) + "*x^" + std::to_string(i % 5) + "*sin(" + std::to_string(i) + "*y)";
+    return out;
+  }
+
+  const std::string chain = "sin(x*y)*exp(x)/(1+x^2)";
+
+  //The variables a to h, and a system of functions of them
+  const int dims = 8;
+
+  std::string var(int i) { return std::string(1, char('a' + i)); }
+
+  std::vector<Expr> equations() {
+    std::vector<Expr> out;
+    for (int i(0); i < dims; ++i) {
+      const std::string u = var(i), v = var((i + 1) % dims), w = var((i + 3) % dims);
+      out.push_back(Expr(u + "*" + v + "^2-sin(" + w + ")*exp(-" + u + "/" + std::to_string(i + 2) + ")+ln(1+" + v + "*" + v + ")"));
+    }
+    return out;
+  }
+
+  std::vector<Expr> symbolic_jacobian(const std::vector<Expr>& f, const std::vector<Expr>& vars) {
+    std::vector<Expr> out;
+    out.reserve(f.size() * vars.size());
+    for (const Expr& fi : f)
+      for (const Expr& v : vars)
+	out.push_back(simplify(derivative(fi, v.as<VarRT>())));
+    return out;
+  }
+}
+
+BENCHMARK( parser ) {
+  bench.measure("small", [&]{ Expr f("x*x*sin(x)+exp(-x/3)*(1+x)^3-ln(2+x*x)/(x+4)"); benchmark_keep(f); });
+  const std::string text = deep_sum(1000);
+  bench.record("deep_sum/bytes", text.size(), "");
+  bench.measure("deep_sum", [&]{ Expr f(text); benchmark_keep(f); });
+}
+
+BENCHMARK( deep_sums ) {
+  const Expr f(deep_sum(10000));
+  const Expr subs("{x:0.5, y:2}");
+  const VarSlots slots({Expr("x"), Expr("y")});
+  const std::vector<double> values{0.5, 2};
+
+  bench.measure("simplify", [&]{ Expr g = simplify(f); benchmark_keep(g); });
+  bench.measure("flatten", [&]{ Expr g = flatten(f); benchmark_keep(g); });
+  bench.measure("sub", [&]{ Expr g = sub(f, subs); benchmark_keep(g); });
+  bench.measure("fast_sub", [&]{ double r = fast_sub(f, slots, values); benchmark_keep(r); });
+}
+
+BENCHMARK( derivative_chains ) {
+  const Expr f(chain);
+  const Expr x("x");
+  bench.measure("derivative_x4", [&]{
+      Expr d = f;
+      for (int i(0); i < 4; ++i)
+	d = derivative(d, x.as<VarRT>());
+      benchmark_keep(d);
+    });
+  bench.measure("derivative_simplify_x4", [&]{
+      Expr d = f;
+      for (int i(0); i < 4; ++i)
+	d = simplify(derivative(d, x.as<VarRT>()));
+      benchmark_keep(d);
+    });
+}
+
+BENCHMARK( jacobian ) {
+  const std::vector<Expr> f = equations();
+  std::vector<Expr> vars;
+  for (int i(0); i < dims; ++i)
+    vars.push_back(Expr(var(i)));
+
+  bench.measure("symbolic", [&]{ std::vector<Expr> J = symbolic_jacobian(f, vars); benchmark_keep(J); });
+
+  const std::vector<Expr> J = symbolic_jacobian(f, vars);
+  const VarSlots slots(vars);
+  std::vector<double> values(dims);
+  for (int i(0); i < dims; ++i)
+    values[i] = 0.1 * (i + 1);
+  std::vector<double> out(J.size());
+  bench.measure("fast_sub", [&]{
+      for (std::size_t i(0); i < J.size(); ++i)
+	out[i] = fast_sub(J[i], slots, values);
+      benchmark_keep(out);
+    });
+
+  std::vector<CompiledExpr> compiled;
+  for (const Expr& j : J)
+    compiled.emplace_back(j, slots);
+  bench.measure("compiled", [&]{
+      for (std::size_t i(0); i < J.size(); ++i)
+	out[i] = compiled[i](values);
+      benchmark_keep(out);
+    });
+}
+
+BENCHMARK( taylor ) {
+  Var<> x;
+  const Expr f("sin(2*x)*exp(x)/(1+x^2)");
+  const TaylorTape<4> tape(f, Expr(x));
+  bench.measure("ad_x1000", [&]{
+      double sum = 0;
+      for (int i(0); i < 1000; ++i)
+	sum += ad<4>(f, x = i * 1e-3).sum();
+      benchmark_keep(sum);
+    });
+  bench.measure("tape_x1000", [&]{
+      double sum = 0;
+      for (int i(0); i < 1000; ++i)
+	sum += tape(i * 1e-3).sum();
+      benchmark_keep(sum);
+    });
+}
+
+BENCHMARK( polynomials ) {
+  //Compile time polynomials of order 8
+  const Polynomial<1> x{0, 1};
+  bench.measure("expand_order8", [&]{
+      auto p = expand((x - 1.0) * (x - 2.0) * (x - 3.0) * (x - 4.0) * (x + 0.5) * (x + 1.5) * (x - 0.25) * (x + 2.5));
+      benchmark_keep(p);
+    });
+  const auto p = expand((x - 1.0) * (x - 2.0) * (x - 3.0) * (x - 4.0) * (x + 0.5) * (x + 1.5) * (x - 0.25) * (x + 2.5));
+  bench.measure("real_roots_order8", [&]{ auto roots = solve_real_roots(p); benchmark_keep(roots); });
+
+  //Runtime multivariate expansion
+  const Expr f("(x+y+1)^10");
+  bench.record("expand_runtime/terms", SparsePolynomial(expand(f)).size(), "");
+  bench.measure("expand_runtime", [&]{ Expr g = expand(f); benchmark_keep(g); });
+}
@@ -0,0 +1,59 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Compares Taylor series evaluation along a trajectory by walking the
+//tree (ad) against replaying a compiled TaylorTape.
+
+#include <stator/symbolic/ad.hpp>
+#include <stator/benchmark.hpp>
+
+using namespace sym;
+
+BENCHMARK( taylor_coefficients ) {
+  Var<> x;
+  const Expr f("x*x*sin(x)+exp(-x/3)*(1+x)^3-ln(2+x*x)/(x+4)+cos(2*x)");
+
+  const TaylorTape<4> tape(f, Expr(x));
+  bench.record("instructions", tape.size(), "");
+  bench.measure("compile", [&]{ TaylorTape<4> t(f, Expr(x)); benchmark_keep(t); });
+
+  auto walk = [&]{
+    double sum = 0;
+    for (int i(0); i < 1000; ++i)
+      sum += ad<4>(f, x = i * 1e-3).sum();
+    benchmark_keep(sum);
+  };
+  auto replay = [&]{
+    double sum = 0;
+    for (int i(0); i < 1000; ++i)
+      sum += tape(i * 1e-3).sum();
+    benchmark_keep(sum);
+  };
+
+  std::size_t heap = stator::heap_allocation_count();
+  Eigen::Matrix<double, 5, 1> c = ad<4>(f, x = 0.5);
+  bench.record("ad/heap_allocations", stator::heap_allocation_count() - heap, "");
+  heap = stator::heap_allocation_count();
+  c = tape(0.5);
+  bench.record("tape/heap_allocations", stator::heap_allocation_count() - heap, "");
+  benchmark_keep(c);
+
+  bench.measure("ad_x1000", walk);
+  bench.measure("tape_x1000", replay);
+}
@@ -0,0 +1,74 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Compares heap traffic and run time of parser and derivative heavy
+//workloads, with nodes allocated from the heap or from a NodeArena.
+
+//The node allocations are counted whether or not the rest of the
+//build enables the engine counters
+#ifndef STATOR_STATS
+# define STATOR_STATS
+#endif
+
+#include <stator/symbolic/runtime.hpp>
+#include <stator/benchmark.hpp>
+
+using namespace sym;
+
+namespace {
+  const std::string text = "x*x+sin(y)*exp(x*y)-ln(1+x^2)/(y+2)";
+
+  //Reports the node and total heap allocations of one call to f
+  template<class F>
+  void count_allocations(Benchmarks::State& bench, const std::string& label, F f) {
+    reset_node_alloc_stats();
+    std::size_t heap = stator::heap_allocation_count();
+    f();
+    bench.record(label + "/node_allocations", node_alloc_stats().allocations, "");
+    bench.record(label + "/node_heap_allocations", node_alloc_stats().heap_allocations, "");
+    bench.record(label + "/total_heap_allocations", stator::heap_allocation_count() - heap, "");
+  }
+
+  void run(Benchmarks::State& bench) {
+    auto x_ptr = VarRT::create("x");
+    const VarRT& x = *x_ptr;
+    Expr f(text);
+
+    auto parse = [&]{ Expr g(text); benchmark_keep(g); };
+    auto derive = [&]{
+      Expr g = f;
+      for (int i(0); i < 4; ++i)
+	g = derivative(g, x);
+      benchmark_keep(g);
+    };
+
+    count_allocations(bench, "parse", parse);
+    count_allocations(bench, "derivative", derive);
+    bench.measure("parse", parse);
+    bench.measure("derivative", derive);
+  }
+}
+
+BENCHMARK( alloc_heap ) { run(bench); }
+
+BENCHMARK( alloc_arena ) {
+  NodeArena arena;
+  NodeArenaScope scope(arena);
+  run(bench);
+}
@@ -0,0 +1,167 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Compares repeated numerical evaluation of an expression by walking
+//the tree (fast_sub) against the lowered CompiledExpr program (one
+//point at a time, and in batches) and native code (NativeExpr), and
+//against substitution and simplification for many variables, and the
+//reverse mode gradient against compiled symbolic derivatives.
+
+#include <stator/symbolic/native.hpp>
+#include <stator/benchmark.hpp>
+
+using namespace sym;
+
+namespace {
+  const std::string text = "x*x*sin(x)+exp(-x/3)*(1+x)^3-ln(2+x*x)/(x+4)+cos(2*x)";
+
+  //Sweeps x over an interval, summing the results
+  template<class F>
+  double sweep(F f) {
+    double sum = 0;
+    for (int i(0); i < 1000; ++i)
+      sum += f(i * 1e-3);
+    return sum;
+  }
+
+  //A model with many parameters, a sum of p_i*x^i*exp(-x/(i+1))
+  const int params = 20;
+
+  std::string param(int i) { return std::string("p") + char('a' + i); }
+
+  std::string model() {
+    std::string out;
+    for (int i(0); i < params; ++i)
+      out += (i ? "+" : "") + param(i) + "*x^" + std::to_string(i) + "*exp(-x/" + std::to_string(i + 1) + ")";
+    return out;
+  }
+
+  //Reports the heap allocations of one call to f
+  template<class F>
+  void count_allocations(Benchmarks::State& bench, const std::string& label, F f) {
+    //Warm up any per-thread scratch buffers first
+    f();
+    std::size_t heap = stator::heap_allocation_count();
+    f();
+    bench.record(label + "/heap_allocations", stator::heap_allocation_count() - heap, "");
+  }
+}
+
+BENCHMARK( compiled_vs_fast_sub ) {
+  const Expr f(text);
+  Var<> x;
+
+  const CompiledExpr cf(f, {Expr(x)});
+  bench.record("instructions", cf.program().size(), "");
+  bench.measure("compile", [&]{ CompiledExpr g(f, {Expr(x)}); benchmark_keep(g); });
+
+  bench.measure("fast_sub_x1000", [&]{ double r = sweep([&](double v) { return fast_sub(f, x = v); }); benchmark_keep(r); });
+  bench.measure("compiled_x1000", [&]{ double r = sweep([&](double v) { return cf(&v); }); benchmark_keep(r); });
+
+  std::vector<double> xs(1000), out(1000);
+  for (std::size_t i(0); i < xs.size(); ++i)
+    xs[i] = i * 1e-3;
+  const double* inputs[] = {xs.data()};
+  bench.measure("batch_x1000", [&]{ cf.batch(inputs, out.data(), xs.size()); benchmark_keep(out); });
+
+  //Native code, built into an empty cache and then reloaded from it
+  NativeOptions options;
+  options.cache_dir = (std::filesystem::temp_directory_path() / ("stator_bench_" + std::to_string(::getpid()))).string();
+  typedef std::chrono::steady_clock clock;
+  auto start = clock::now();
+  const NativeExpr nf(f, {Expr(x)}, options);
+  bench.record("native_build", std::chrono::duration<double>(clock::now() - start).count() * 1e3, "ms");
+  bench.measure("native_load", [&]{ NativeExpr g(f, {Expr(x)}, options); benchmark_keep(g); });
+  bench.measure("native_x1000", [&]{ double r = sweep([&](double v) { return nf(&v); }); benchmark_keep(r); });
+  std::filesystem::remove_all(options.cache_dir);
+}
+
+BENCHMARK( many_variables ) {
+  const Expr f(model());
+  std::vector<Expr> vars{Expr("x")};
+  std::string dict = "{x:0.5";
+  for (int i(0); i < params; ++i) {
+    vars.push_back(Expr(param(i)));
+    dict += ", " + param(i) + ":" + std::to_string(1.0 / (i + 1));
+  }
+  const Expr subs(dict + "}");
+  const VarSlots slots(vars);
+  std::vector<double> values{0.5};
+  for (int i(0); i < params; ++i)
+    values.push_back(1.0 / (i + 1));
+  const CompiledExpr cf(f, slots);
+
+  auto slow = [&]{ double r = simplify(sub(f, subs)).as<double>(); benchmark_keep(r); };
+  auto fast = [&]{ double r = fast_sub(f, slots, values); benchmark_keep(r); };
+  auto compiled = [&]{ double r = cf(values); benchmark_keep(r); };
+
+  count_allocations(bench, "sub_simplify", slow);
+  count_allocations(bench, "fast_sub", fast);
+  count_allocations(bench, "compiled", compiled);
+  bench.measure("sub_simplify", slow);
+  bench.measure("fast_sub", fast);
+  bench.measure("compiled", compiled);
+}
+
+BENCHMARK( repeated_subexpressions ) {
+  //Higher derivatives repeat the same subterms many times
+  Var<> x;
+  Expr f(text);
+  for (int i(0); i < 3; ++i)
+    f = derivative(f, Expr(x).as<VarRT>());
+
+  const CSEResult r = cse(f);
+  bench.record("definitions", r.definitions.size(), "");
+  bench.measure("cse", [&]{ CSEResult g = cse(f); benchmark_keep(g); });
+
+  const CompiledExpr cf(f, {Expr(x)});
+  bench.record("instructions", cf.program().size(), "");
+  bench.measure("fast_sub_x1000", [&]{ double r = sweep([&](double v) { return fast_sub(f, x = v); }); benchmark_keep(r); });
+  bench.measure("compiled_x1000", [&]{ double r = sweep([&](double v) { return cf(&v); }); benchmark_keep(r); });
+}
+
+BENCHMARK( gradient ) {
+  //The gradient of a least squares objective over many parameters,
+  //by reverse mode (one sweep) against one compiled symbolic
+  //derivative per parameter
+  const int n = 100;
+  std::vector<Expr> vars;
+  std::string text;
+  for (int i(0); i < n; ++i) {
+    const std::string p = "p" + detail::cse_suffix(i);
+    vars.push_back(Expr(p));
+    text += (i ? "+" : "") + std::string("(") + p + "*sin(" + std::to_string(i + 1) + "*" + p + ")-" + std::to_string(1.0 / (i + 1)) + ")^2";
+  }
+  const Expr f = Expr(text);
+  const std::vector<double> values(n, 0.5);
+
+  const CompiledExpr cf(f, vars);
+  std::vector<CompiledExpr> derivatives;
+  for (const Expr& v : vars)
+    derivatives.emplace_back(derivative(f, v.as<VarRT>()), vars);
+
+  std::vector<double> grad(n);
+  auto reverse = [&]{ double r = cf.gradient(values.data(), grad.data()); benchmark_keep(r); benchmark_keep(grad); };
+  auto symbolic = [&]{ for (int i(0); i < n; ++i) grad[i] = derivatives[i](values.data()); benchmark_keep(grad); };
+
+  count_allocations(bench, "reverse", reverse);
+  bench.measure("evaluate", [&]{ double r = cf(values.data()); benchmark_keep(r); });
+  bench.measure("reverse", reverse);
+  bench.measure("symbolic", symbolic);
+}
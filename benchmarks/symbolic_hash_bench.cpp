@@ -0,0 +1,51 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Hashing, comparison, and dictionary substitution of large
+//expressions.
+
+#include <stator/symbolic/runtime.hpp>
+#include <stator/benchmark.hpp>
+
+#include <unordered_map>
+
+using namespace sym;
+
+namespace {
+  std::string generated_expression(int terms, const std::string& last) {
+    std::string out;
+    for (int i(0); i < terms; ++i)
+      out += "sin(x*y)*exp(z)*(x+" + std::to_string(i) + ")^2/(1+z*z)+";
+    return out + last;
+  }
+}
+
+BENCHMARK( hash_large ) {
+  const Expr f(generated_expression(200, "x"));
+  const Expr g(generated_expression(200, "y"));
+
+  bench.measure("hash", [&]{ std::size_t h = std::hash<Expr>{}(f); benchmark_keep(h); });
+  bench.measure("compare_unequal", [&]{ bool eq = (f == g); benchmark_keep(eq); });
+  bench.measure("sub_dict", [&]{ Expr r = sub(f, Expr("{x:1, y:2, z:3}")); benchmark_keep(r); });
+
+  //A map keyed by large expressions (as DictRT is)
+  std::unordered_map<Expr, Expr> keyed{{f, Expr("1")}, {g, Expr("2")}};
+  const Expr f2(generated_expression(200, "x"));
+  bench.measure("map_lookup", [&]{ auto it = keyed.find(f2); benchmark_keep(it); });
+}
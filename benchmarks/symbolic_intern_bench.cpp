@@ -0,0 +1,62 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Compares the hash-consed (interned) node path against the plain
+//allocation path for a large generated expression with many
+//repeated subterms.
+
+#include <stator/symbolic/runtime.hpp>
+#include <stator/benchmark.hpp>
+
+using namespace sym;
+
+namespace {
+  //A sum of terms which all repeat the same few subexpressions,
+  //much like the entries of a generated Jacobian.
+  std::string generated_expression(int terms) {
+    std::string out;
+    for (int i(0); i < terms; ++i) {
+      if (i) out += "+";
+      out += "sin(x*y)*exp(z)*(x+" + std::to_string(i) + ")^2/(1+z*z)";
+    }
+    return out;
+  }
+
+  void run(Benchmarks::State& bench, bool intern) {
+    InterningScope scope(intern);
+    const std::string text = generated_expression(200);
+
+    std::size_t before = stator::heap_bytes();
+    Expr f(text);
+    auto x_ptr = VarRT::create("x");
+    Expr df = derivative(f, *x_ptr);
+    bench.record("live_bytes", double(stator::heap_bytes() - before), "B");
+
+    bench.measure("parse", [&]{ Expr g(text); benchmark_keep(g); });
+    bench.measure("simplify", [&]{ Expr g = simplify(df); benchmark_keep(g); });
+    bench.measure("sub", [&]{ Expr g = sub(df, Expr("y=2")); benchmark_keep(g); });
+
+    Expr df2 = derivative(Expr(text), *x_ptr);
+    bench.measure("compare", [&]{ bool eq = (df == df2); benchmark_keep(eq); });
+  }
+}
+
+BENCHMARK( intern_plain ) { run(bench, false); }
+
+BENCHMARK( intern_interned ) { run(bench, true); }
@@ -0,0 +1,54 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Measures the scaling of the container transforms (derivative,
+//simplify and substitution over the elements of an ArrayRT) with the
+//number of threads, from one up to the core count.
+
+#include <stator/symbolic/runtime.hpp>
+#include <stator/benchmark.hpp>
+
+using namespace sym;
+
+BENCHMARK( array_transforms ) {
+  //A Jacobian-like array of many independent element expressions
+  auto A_ptr = ArrayRT::create();
+  for (int i(0); i < 4000; ++i)
+    A_ptr->push_back(Expr("x^" + std::to_string(i % 7 + 2) + "*sin(" + std::to_string(i) + "*y)+exp(x*y)/(" + std::to_string(i + 1) + "+x*y)"));
+  const Expr f(*A_ptr);
+  auto x_ptr = VarRT::create("x");
+  const Expr df = simplify(derivative(f, *x_ptr));
+  const Expr subs("x=2");
+
+  const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  bench.record("cores", cores, "");
+
+  std::vector<std::size_t> threads;
+  for (std::size_t t(1); t < cores; t *= 2)
+    threads.push_back(t);
+  threads.push_back(cores);
+
+  for (std::size_t t : threads) {
+    stator::ParallelScope scope(t, 32);
+    const std::string label = std::to_string(t) + "_threads";
+    bench.measure("derivative/" + label, [&]{ Expr r = derivative(f, *x_ptr); benchmark_keep(r); });
+    bench.measure("simplify/" + label, [&]{ Expr r = simplify(df); benchmark_keep(r); });
+    bench.measure("sub/" + label, [&]{ Expr r = sub(df, subs); benchmark_keep(r); });
+  }
+}
@@ -0,0 +1,146 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Measures the throughput of the expression parser, splitting the
+//cost of tokenizing the input from that of building the expression,
+//the scaling of bulk parsing with the number of threads, the gain
+//from the parse cache, and the cost of rejecting invalid input.
+
+#include <stator/symbolic/parse_records.hpp>
+#include <stator/benchmark.hpp>
+
+#include <chrono>
+#include <thread>
+
+using namespace sym;
+
+namespace {
+  //Many short expressions, as read from a model file
+  std::vector<std::string> short_expressions() {
+    std::vector<std::string> out;
+    for (int i(0); i < 1000; ++i)
+      out.push_back("k" + std::string(1, char('a' + i % 26)) + "*x^" + std::to_string(i % 4) + "+sin(" + std::to_string(i) + ".5*y)/(1+z)");
+    return out;
+  }
+
+  std::string long_expression() {
+    std::string out;
+    for (int i(0); i < 1000; ++i)
+      out += (i ? " + " : "") + std::to_string(i + 1) + "e-3*exp(-x/" + std::to_string(i + 1) + ")*cos(y)^2";
+    return out;
+  }
+
+  std::size_t count_tokens(const std::string& s) {
+    std::size_t n = 0;
+    for (detail::ExprTokenizer tk(s); !tk.empty(); tk.consume())
+      ++n;
+    return n;
+  }
+
+  //Reports the throughput of parsing the expressions, with the
+  //tokenizer alone and the full parse
+  void throughput(Benchmarks::State& bench, const std::vector<std::string>& exprs) {
+    std::size_t bytes = 0, tokens = 0;
+    for (const std::string& s : exprs) {
+      bytes += s.size();
+      tokens += count_tokens(s);
+    }
+    bench.record("tokens", tokens, "");
+
+    auto tokenize = [&]{ std::size_t n = 0; for (const std::string& s : exprs) n += count_tokens(s); benchmark_keep(n); };
+    auto parse = [&]{ for (const std::string& s : exprs) { Expr f(s); benchmark_keep(f); } };
+
+    std::size_t heap = stator::heap_allocation_count();
+    tokenize();
+    bench.record("tokenize/heap_allocations_per_token", double(stator::heap_allocation_count() - heap) / tokens, "");
+    heap = stator::heap_allocation_count();
+    parse();
+    bench.record("parse/heap_allocations_per_token", double(stator::heap_allocation_count() - heap) / tokens, "");
+
+    for (auto& m : {std::make_pair("tokenize", std::function<void()>(tokenize)), std::make_pair("parse", std::function<void()>(parse))}) {
+      typedef std::chrono::steady_clock clock;
+      std::size_t reps = 0;
+      const auto start = clock::now();
+      double elapsed = 0;
+      while (elapsed < 0.2) {
+	m.second();
+	++reps;
+	elapsed = std::chrono::duration<double>(clock::now() - start).count();
+      }
+      bench.record(std::string(m.first) + "/tokens_per_second", tokens * reps / elapsed, "1/s");
+      bench.record(std::string(m.first) + "/bytes_per_second", bytes * reps / elapsed, "B/s");
+    }
+  }
+}
+
+BENCHMARK( parse_short_expressions ) {
+  throughput(bench, short_expressions());
+}
+
+BENCHMARK( parse_long_expression ) {
+  throughput(bench, {long_expression()});
+}
+
+BENCHMARK( parse_records_threads ) {
+  //A model file of newline delimited expressions
+  std::string buffer;
+  for (const std::string& s : short_expressions())
+    for (int i(0); i < 10; ++i)
+      buffer += s + "\n";
+  bench.record("records", split_records(buffer).size(), "");
+
+  const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::size_t> threads;
+  for (std::size_t t(1); t < cores; t *= 2)
+    threads.push_back(t);
+  threads.push_back(cores);
+
+  for (std::size_t t : threads)
+    bench.measure("parse_records/" + std::to_string(t) + "_threads", [&]{ auto r = parse_records(buffer, '\n', t); benchmark_keep(r); });
+}
+
+BENCHMARK( parse_cache_repeated ) {
+  //A service receiving the same few formulas over and over
+  const std::vector<std::string> exprs = short_expressions();
+  ParseCache cache(exprs.size());
+  bench.measure("uncached", [&]{ for (const std::string& s : exprs) { Expr f(s); benchmark_keep(f); } });
+  bench.measure("cached", [&]{ for (const std::string& s : exprs) { Expr f = cache.parse(s); benchmark_keep(f); } });
+  bench.record("hit_rate", double(cache.stats().hits) / (cache.stats().hits + cache.stats().misses), "");
+}
+
+BENCHMARK( validate_invalid ) {
+  //User input where most strings are malformed
+  std::vector<std::string> exprs = short_expressions();
+  for (std::size_t i(0); i < exprs.size(); ++i)
+    if (i % 10)
+      exprs[i] += ((i % 3) ? ")" : "*");
+
+  bench.measure("exceptions", [&]{
+      std::size_t valid = 0;
+      for (const std::string& s : exprs)
+	try { Expr f(s); ++valid; } catch (const stator::Exception&) {}
+      benchmark_keep(valid);
+    });
+  bench.measure("try_parse", [&]{
+      std::size_t valid = 0;
+      for (const std::string& s : exprs)
+	valid += bool(try_parse(s));
+      benchmark_keep(valid);
+    });
+}
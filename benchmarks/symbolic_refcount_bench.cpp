@@ -0,0 +1,74 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Copy and construction heavy workloads, which are dominated by the
+//cost of node allocation and reference counting. This is also built
+//as symbolic_refcount_nonatomic_bench, with STATOR_NONATOMIC_REFCOUNT
+//defined.
+
+#include <stator/symbolic/runtime.hpp>
+#include <stator/benchmark.hpp>
+
+using namespace sym;
+
+BENCHMARK( refcount_nodes ) {
+  //The heap memory held per node, including its reference count
+  const std::size_t nodes = 10000;
+  Expr x("x");
+  std::vector<Expr> store;
+  store.reserve(nodes);
+  const std::size_t before = stator::heap_bytes();
+  for (std::size_t i(0); i < nodes; ++i)
+    store.push_back(Expr(BinaryOp<Expr, detail::Multiply, Expr>::create(x, x)));
+  bench.record("bytes_per_node", double(stator::heap_bytes() - before) / nodes, "B");
+}
+
+BENCHMARK( refcount_workloads ) {
+  const std::string text = "x*x+sin(y)*exp(x*y)-ln(1+x^2)/(y+2)";
+  auto x_ptr = VarRT::create("x");
+  const VarRT& x = *x_ptr;
+  const Expr f(text);
+
+  bench.measure("parse", [&]{ Expr g(text); benchmark_keep(g); });
+
+  bench.measure("derivative", [&]{
+    Expr g = f;
+    for (int i(0); i < 4; ++i)
+      g = derivative(g, x);
+    benchmark_keep(g);
+  });
+
+  const Expr d = derivative(derivative(f, x), x);
+  bench.measure("simplify", [&]{ Expr g = simplify(d); benchmark_keep(g); });
+
+  const Expr rule = Expr("x=2");
+  bench.measure("sub", [&]{ Expr g = sub(d, rule); benchmark_keep(g); });
+
+  //Copying and growing containers of expressions
+  std::vector<Expr> terms;
+  for (int i(0); i < 1000; ++i)
+    terms.push_back(f);
+  bench.measure("copy_vector", [&]{ std::vector<Expr> c(terms); benchmark_keep(c); });
+  bench.measure("grow_vector", [&]{
+    std::vector<Expr> c;
+    for (const Expr& t : terms)
+      c.push_back(t);
+    benchmark_keep(c);
+  });
+}
@@ -0,0 +1,90 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Loading large generated expressions from text, against the binary
+//format, and caching symbolic results on disk.
+
+#include <stator/symbolic/disk_cache.hpp>
+#include <stator/symbolic/sparse_polynomial.hpp>
+#include <stator/benchmark.hpp>
+
+#include <cstdio>
+
+using namespace sym;
+
+namespace {
+  std::string generated_expression(int terms) {
+    std::string out;
+    for (int i(0); i < terms; ++i)
+      out += "sin(x*y)*exp(z)*(x+" + std::to_string(i) + ")^2/(1+z*z)+";
+    return out + "x";
+  }
+
+  void compare_formats(Benchmarks::State& bench, const std::string& label, const Expr& f) {
+    const std::string text = repr(f);
+    const std::string bytes = serialize(f);
+    bench.record(label + "_text_size", double(text.size()), "B");
+    bench.record(label + "_binary_size", double(bytes.size()), "B");
+
+    bench.measure(label + "_parse", [&]{ Expr g(text); benchmark_keep(g); });
+    bench.measure(label + "_serialize", [&]{ std::string b = serialize(f); benchmark_keep(b); });
+    bench.measure(label + "_deserialize", [&]{ Expr g = deserialize(bytes); benchmark_keep(g); });
+
+    const std::string filename = "symbolic_serialize_bench.bin";
+    save(f, filename);
+    bench.measure(label + "_load_file", [&]{ Expr g = load(filename); benchmark_keep(g); });
+    std::remove(filename.c_str());
+  }
+}
+
+BENCHMARK( serialize_generated ) {
+  compare_formats(bench, "generated", Expr(generated_expression(1000)));
+}
+
+BENCHMARK( serialize_expanded ) {
+  //Flattened sums of many products, with shared generators
+  compare_formats(bench, "expanded", expand(Expr("(x+2*y-z+1)^12*sin(x)")));
+}
+
+BENCHMARK( serialize_derivatives ) {
+  //Derivatives share many subexpressions, which the text repeats
+  auto x_ptr = VarRT::create("x");
+  Expr f("sin(x*y)*exp(x)/(1+x^2)");
+  for (int i(0); i < 4; ++i)
+    f = derivative(f, *x_ptr);
+  compare_formats(bench, "derivative", f);
+}
+
+BENCHMARK( disk_cache_warm ) {
+  //The cost of symbolic work, against a warm on-disk cache of it
+  auto x_ptr = VarRT::create("x");
+  Expr f("sin(x*y)*exp(x)/(1+x^2)");
+  for (int i(0); i < 3; ++i)
+    f = derivative(f, *x_ptr);
+  const Expr x("x");
+
+  const std::string directory = "symbolic_serialize_bench.cache";
+  std::filesystem::remove_all(directory);
+  DiskCache cache(directory);
+  bench.measure("simplify", [&]{ Expr g = simplify(f); benchmark_keep(g); });
+  bench.measure("cached_simplify", [&]{ Expr g = cache.simplify(f); benchmark_keep(g); });
+  bench.measure("derivative", [&]{ Expr g = derivative(f, x); benchmark_keep(g); });
+  bench.measure("cached_derivative", [&]{ Expr g = cache.derivative(f, x); benchmark_keep(g); });
+  std::filesystem::remove_all(directory);
+}
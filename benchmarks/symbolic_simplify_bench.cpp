@@ -0,0 +1,111 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Simplification of expressions with heavily shared subtrees, such as
+//the output of repeated differentiation.
+
+#include <stator/symbolic/sparse_polynomial.hpp>
+#include <stator/benchmark.hpp>
+
+using namespace sym;
+
+BENCHMARK( simplify_derivatives ) {
+  auto x_ptr = VarRT::create("x");
+  const VarRT& x = *x_ptr;
+
+  Expr f("sin(x)*exp(x*x)/(1+x)");
+  for (int i(0); i < 4; ++i) {
+    f = derivative(f, x);
+    bench.measure("derivative_" + std::to_string(i + 1), [&]{ Expr g = simplify(f); benchmark_keep(g); });
+  }
+}
+
+BENCHMARK( simplify_shared_dag ) {
+  //Each level reuses the previous one twice, so the tree has 2^depth
+  //leaves but only depth distinct nodes.
+  for (int depth : {10, 16, 20}) {
+    Expr f("x+0");
+    for (int i(0); i < depth; ++i)
+      f = f * f;
+    bench.measure("depth_" + std::to_string(depth), [&]{ Expr g = simplify(f); benchmark_keep(g); });
+  }
+}
+
+BENCHMARK( long_sums ) {
+  //A sum of 10k scaled terms over 100 variables, so like terms merge
+  const std::size_t terms = 10000, variables = 100;
+  std::vector<Expr> vars;
+  for (std::size_t i(0); i < variables; ++i)
+    vars.push_back(Expr(VarRT::create(std::string("v") + char('a' + i / 26) + char('a' + i % 26))));
+
+  Expr f = Expr(1.0);
+  for (std::size_t i(0); i < terms; ++i)
+    f = f + Expr(double(i % 7 + 1)) * vars[i % variables];
+  const Expr flat = flatten(f);
+  bench.record("flat_terms", flat.as<SumRT>()._terms.size(), "");
+
+  const VarSlots slots(vars);
+  std::vector<double> values(variables);
+  for (std::size_t i(0); i < variables; ++i)
+    values[i] = 0.5 + 0.01 * i;
+
+  bench.measure("binary/simplify", [&]{ Expr g = simplify(f); benchmark_keep(g); });
+  bench.measure("binary/fast_sub", [&]{ double r = fast_sub(f, slots, values); benchmark_keep(r); });
+  bench.measure("flatten", [&]{ Expr g = flatten(f); benchmark_keep(g); });
+  bench.measure("flat/simplify", [&]{ Expr g = simplify(flat); benchmark_keep(g); });
+  bench.measure("flat/fast_sub", [&]{ double r = fast_sub(flat, slots, values); benchmark_keep(r); });
+
+  //A sum of 10k distinct terms, which flattens to a single node
+  std::vector<Expr> unique_terms;
+  for (std::size_t i(0); i < terms; ++i)
+    unique_terms.push_back(Expr(double(i + 1)) * pow(vars[i % variables], Expr(double(i / variables + 2))));
+  Expr g = unique_terms[0];
+  for (std::size_t i(1); i < terms; ++i)
+    g = g + unique_terms[i];
+  const Expr flat_g = flatten(g);
+  bench.record("unique/flat_terms", flat_g.as<SumRT>()._terms.size(), "");
+  bench.measure("unique/binary/simplify", [&]{ Expr h = simplify(g); benchmark_keep(h); });
+  bench.measure("unique/binary/fast_sub", [&]{ double r = fast_sub(g, slots, values); benchmark_keep(r); });
+  bench.measure("unique/flatten", [&]{ Expr h = flatten(g); benchmark_keep(h); });
+  bench.measure("unique/flat/simplify", [&]{ Expr h = simplify(flat_g); benchmark_keep(h); });
+  bench.measure("unique/flat/fast_sub", [&]{ double r = fast_sub(flat_g, slots, values); benchmark_keep(r); });
+}
+
+BENCHMARK( expand_products ) {
+  for (int n : {5, 10, 20}) {
+    const Expr f = pow(Expr("1+x+y+z"), Expr(double(n)));
+    bench.record("power_" + std::to_string(n) + "/terms", SparsePolynomial(f).size(), "");
+    bench.measure("power_" + std::to_string(n), [&]{ Expr g = expand(f); benchmark_keep(g); });
+  }
+
+  //The product of two sums of 100 terms, giving 5050 monomials
+  const std::size_t terms = 100;
+  Expr a(1.0), b(2.0);
+  for (std::size_t i(1); i < terms; ++i) {
+    const Expr v(VarRT::create(std::string("v") + char('a' + i / 26) + char('a' + i % 26)));
+    a = a + v;
+    b = b + Expr(double(i)) * v;
+  }
+  const Expr product = a * b;
+  bench.record("sum_product/terms", SparsePolynomial(product).size(), "");
+  bench.measure("sum_product", [&]{ Expr g = expand(product); benchmark_keep(g); });
+
+  const SparsePolynomial pa(a), pb(b);
+  bench.measure("sum_product/polynomial", [&]{ SparsePolynomial p = pa * pb; benchmark_keep(p); });
+}
@@ -95,6 +95,28 @@ PYBIND11_MODULE(core, m)
   m.def("simplify", static_cast<sym::Expr (*)(const sym::Expr&)>(&sym::simplify));
   m.def("sub", +[](const sym::Expr& l, const sym::Expr& r){ return to_python(sym::sub(l, r)); });
   m.def("sub", +[](const sym::Expr& l, const py::dict& r){ return to_python(sym::sub(l, make_Expr(r))); });
+
+  //Engine instrumentation (the counts are all zero unless built with STATOR_STATS)
+  m.attr("stats_enabled") = sym::engine_stats_enabled();
+  m.def("stats", +[]() {
+    const sym::EngineStats s = sym::engine_stats();
+    py::list nodes;
+    for (std::size_t n : s.nodes_created)
+      nodes.append(n);
+    py::dict visitors;
+    for (const auto& v : s.visitor_dispatches)
+      visitors[py::str(v.first)] = v.second;
+    py::dict out;
+    out["nodes_created"] = nodes;
+    out["visitor_dispatches"] = visitors;
+    out["simplify_passes"] = s.simplify_passes;
+    out["simplify_rewrites"] = s.simplify_rewrites;
+    out["hashes"] = s.hashes;
+    out["compares"] = s.compares;
+    out["tokens"] = s.tokens;
+    return out;
+  });
+  m.def("reset_stats", &sym::reset_engine_stats);
   
   py::implicitly_convertible<int, sym::Expr>();
   py::implicitly_convertible<double, sym::Expr>();
@@ -0,0 +1,289 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+/*! \file benchmark.hpp
+  \brief A minimal benchmark harness, in the spirit of unit_test.hpp.
+
+  Benchmarks are registered with the BENCHMARK macro and run in
+  registration order by the main() defined here. Each benchmark
+  reports any number of named measurements.
+
+  \code{.cpp}
+  BENCHMARK( parse_sum ) {
+    bench.measure("parse", [&]{ sym::Expr f("x+y"); });
+  }
+  \endcode
+
+  The executable accepts these options:
+  - --filter=TEXT Only run benchmarks whose name contains TEXT.
+  - --min-time=SECONDS The minimum run time of each measurement (default 0.2).
+  - --json=FILE Also write the results to FILE as JSON, for comparing
+    runs (see benchmarks/compare_bench.py).
+  - --list List the benchmarks, without running them.
+
+  This header also replaces the global operator new/delete to track
+  the live heap size, so it must only be included once in a
+  benchmark executable.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace stator {
+  namespace detail {
+    inline std::atomic<std::size_t>& heap_live_bytes() {
+      static std::atomic<std::size_t> bytes(0);
+      return bytes;
+    }
+
+    inline std::atomic<std::size_t>& heap_allocations() {
+      static std::atomic<std::size_t> count(0);
+      return count;
+    }
+
+    //Allocations are prefixed with their size so that unsized
+    //deletes can also be tracked.
+    constexpr std::size_t heap_header = alignof(std::max_align_t);
+
+    inline const void* volatile benchmark_sink = nullptr;
+  }
+
+  /*! \brief The number of bytes currently allocated via operator new. */
+  inline std::size_t heap_bytes() { return detail::heap_live_bytes().load(); }
+
+  /*! \brief The number of calls to operator new so far. */
+  inline std::size_t heap_allocation_count() { return detail::heap_allocations().load(); }
+}
+
+//The replacements are kept out of line, otherwise GCC inlines them
+//into each other and misreads the size header as an out of bounds
+//access.
+#ifdef __GNUC__
+# define STATOR_BENCHMARK_NOINLINE __attribute__((noinline))
+#else
+# define STATOR_BENCHMARK_NOINLINE
+#endif
+
+STATOR_BENCHMARK_NOINLINE void* operator new(std::size_t size) {
+  void* p = std::malloc(size + stator::detail::heap_header);
+  if (!p) throw std::bad_alloc();
+  *static_cast<std::size_t*>(p) = size;
+  stator::detail::heap_live_bytes() += size;
+  ++stator::detail::heap_allocations();
+  return static_cast<char*>(p) + stator::detail::heap_header;
+}
+
+STATOR_BENCHMARK_NOINLINE void operator delete(void* p) noexcept {
+  if (!p) return;
+  void* base = static_cast<char*>(p) - stator::detail::heap_header;
+  stator::detail::heap_live_bytes() -= *static_cast<std::size_t*>(base);
+  std::free(base);
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+
+class Benchmarks {
+public:
+  /*! \brief The interface handed to each benchmark to take measurements. */
+  class State {
+  public:
+    State(Benchmarks& b): _b(b) {}
+
+    /*! \brief Times the callable, repeating it until the minimum run
+        time is reached, and reports the mean time per call.
+     */
+    template<class F>
+    void measure(const std::string& label, F f) {
+      typedef std::chrono::steady_clock clock;
+      //Warm up, and estimate the cost of a single call
+      auto start = clock::now();
+      f();
+      double single = std::chrono::duration<double>(clock::now() - start).count();
+
+      std::size_t iterations = std::max<std::size_t>(1, std::min<double>(1e9, _b._min_time / std::max(single, 1e-9)));
+      start = clock::now();
+      for (std::size_t i(0); i < iterations; ++i)
+	f();
+      double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+      _b.add_result(label, elapsed / iterations * 1e9, "ns", iterations);
+    }
+
+    /*! \brief Reports an arbitrary measurement. */
+    void record(const std::string& label, double value, const std::string& unit) {
+      _b.add_result(label, value, unit, 0);
+    }
+
+  private:
+    Benchmarks& _b;
+  };
+
+  static Benchmarks& get() {
+    static Benchmarks instance;
+    return instance;
+  }
+
+  void register_benchmark(std::string name, std::function<void(State&)> cb) {
+    _benchmarks.emplace_back(name, cb);
+  }
+
+  int run(int argc, char* argv[]) {
+    std::string filter, json;
+    bool list = false;
+    for (int i(1); i < argc; ++i) {
+      const std::string arg = argv[i];
+      auto value = [&](const std::string& option) { return arg.substr(option.size()); };
+      if (arg.rfind("--filter=", 0) == 0)
+	filter = value("--filter=");
+      else if (arg.rfind("--min-time=", 0) == 0)
+	_min_time = std::atof(value("--min-time=").c_str());
+      else if (arg.rfind("--json=", 0) == 0)
+	json = value("--json=");
+      else if (arg == "--list")
+	list = true;
+      else {
+	std::cerr << "Usage: " << argv[0] << " [--filter=TEXT] [--min-time=SECONDS] [--json=FILE] [--list]" << std::endl;
+	return 1;
+      }
+    }
+
+    State state(*this);
+    for (auto& b : _benchmarks) {
+      if (b.first.find(filter) == std::string::npos)
+	continue;
+      if (list) {
+	std::cout << b.first << "\n";
+	continue;
+      }
+      _running = b.first;
+      b.second(state);
+    }
+
+    if (!json.empty() && !list)
+      return write_json(json);
+    return 0;
+  }
+
+private:
+  Benchmarks(): _min_time(0.2) {}
+
+  struct Result {
+    std::string benchmark;
+    std::string label;
+    double value;
+    std::string unit;
+    std::size_t iterations;
+  };
+
+  void add_result(const std::string& label, double value, const std::string& unit, std::size_t iterations) {
+    std::printf("%-60s %16.6g %s\n", (_running + "/" + label).c_str(), value, unit.c_str());
+    std::fflush(stdout);
+    _results.push_back(Result{_running, label, value, unit, iterations});
+  }
+
+  static std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+      if ((c == '"') || (c == '\\'))
+	out += '\\';
+      if (static_cast<unsigned char>(c) < 0x20)
+	out += ' ';
+      else
+	out += c;
+    }
+    return out + "\"";
+  }
+
+  int write_json(const std::string& filename) const {
+    std::ofstream out(filename);
+    char date[32] = "";
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    out << "{\n  \"context\": {\"date\": " << json_string(date)
+#ifdef __VERSION__
+	<< ", \"compiler\": " << json_string(__VERSION__)
+#endif
+#ifdef NDEBUG
+	<< ", \"ndebug\": true"
+#else
+	<< ", \"ndebug\": false"
+#endif
+	<< ", \"min_time\": " << _min_time << "},\n  \"results\": [";
+    out.precision(17);
+    for (std::size_t i(0); i < _results.size(); ++i) {
+      const Result& r = _results[i];
+      out << (i ? ",\n" : "\n") << "    {\"name\": " << json_string(r.benchmark + "/" + r.label)
+	  << ", \"benchmark\": " << json_string(r.benchmark) << ", \"label\": " << json_string(r.label)
+	  << ", \"value\": " << r.value << ", \"unit\": " << json_string(r.unit)
+	  << ", \"iterations\": " << r.iterations << "}";
+    }
+    out << "\n  ]\n}\n";
+    if (!out) {
+      std::cerr << "Could not write " << filename << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  std::vector<std::pair<std::string, std::function<void(State&)>>> _benchmarks;
+  std::vector<Result> _results;
+  std::string _running;
+  double _min_time;
+};
+
+struct BenchmarkRegisterer {
+  BenchmarkRegisterer(std::string name, std::function<void(Benchmarks::State&)> cb) {
+    Benchmarks::get().register_benchmark(name, cb);
+  }
+};
+
+/*! \brief Prevents the compiler from optimising away an unused result. */
+template<class T>
+inline void benchmark_keep(const T& v) {
+#ifdef __GNUC__
+  asm volatile("" : : "g"(&v) : "memory");
+#else
+  stator::detail::benchmark_sink = &v;
+#endif
+}
+
+#define BENCHMARK(A) void A(Benchmarks::State&); BenchmarkRegisterer A ## _reg(#A, A); void A(Benchmarks::State& bench)
+
+int main(int argc, char* argv[]) {
+  try {
+    return Benchmarks::get().run(argc, argv);
+  } catch (const std::exception& e) {
+    std::cerr << "Benchmarks aborting due to exception:\n" << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,240 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace stator {
+  /*! \brief A pool of worker threads which run queued tasks.
+
+    Workers are started on demand (see \ref reserve) and are only
+    stopped when the pool is destroyed.
+  */
+  class ThreadPool {
+  public:
+    ThreadPool() {}
+
+    ~ThreadPool() {
+      {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_stopping = true;
+      }
+      _wake.notify_all();
+      for (std::thread& t : _workers)
+	t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /*! \brief The pool shared by \ref parallel_for. */
+    static ThreadPool& global() {
+      static ThreadPool instance;
+      return instance;
+    }
+
+    /*! \brief Make sure at least n workers are running. */
+    void reserve(std::size_t n) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      while (_workers.size() < n)
+	_workers.emplace_back([this]{ work(); });
+    }
+
+    /*! \brief The number of worker threads. */
+    std::size_t size() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _workers.size();
+    }
+
+    /*! \brief Queue a task to be run by a worker. */
+    void submit(std::function<void()> task) {
+      {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_tasks.push_back(std::move(task));
+      }
+      _wake.notify_one();
+    }
+
+  private:
+    void work() {
+      for (;;) {
+	std::function<void()> task;
+	{
+	  std::unique_lock<std::mutex> lock(_mutex);
+	  _wake.wait(lock, [this]{ return _stopping || !_tasks.empty(); });
+	  if (_tasks.empty())
+	    return;
+	  task = std::move(_tasks.front());
+	  _tasks.pop_front();
+	}
+	task();
+      }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<std::function<void()>> _tasks;
+    std::vector<std::thread> _workers;
+    bool _stopping = false;
+  };
+
+  namespace detail {
+    struct ParallelSettings {
+      static ParallelSettings& get() {
+	static ParallelSettings instance;
+	return instance;
+      }
+
+      std::atomic<std::size_t> threads{1};
+      std::atomic<std::size_t> grain{16};
+    };
+
+    /*! \brief The shared state of one \ref parallel_for call.
+
+      Chunks of the range are claimed through an atomic counter by
+      the calling thread and by the helper tasks queued on the pool.
+      The caller only ever waits for chunks which have already been
+      claimed (and are therefore running), so nested calls cannot
+      deadlock even when every worker is busy.
+    */
+    struct ParallelRange {
+      std::size_t n, grain, chunks;
+      std::atomic<std::size_t> next{0};
+      std::size_t done = 0;
+      std::exception_ptr error;
+      std::mutex mutex;
+      std::condition_variable finished;
+
+      template<class F>
+      void run(F& f) {
+	for (std::size_t c; (c = next.fetch_add(1)) < chunks;) {
+	  try {
+	    const std::size_t end = std::min(n, (c + 1) * grain);
+	    for (std::size_t i(c * grain); i < end; ++i)
+	      f(i);
+	  } catch (...) {
+	    std::lock_guard<std::mutex> lock(mutex);
+	    if (!error)
+	      error = std::current_exception();
+	  }
+
+	  std::lock_guard<std::mutex> lock(mutex);
+	  if (++done == chunks)
+	    finished.notify_all();
+	}
+      }
+    };
+  }
+
+  /*! \brief Set the number of threads (including the calling thread)
+      and the grain size used by \ref parallel_for.
+
+    Parallelism is off (one thread) by default. The grain is the
+    number of consecutive indices processed as one task, and ranges
+    no larger than the grain are always run serially.
+  */
+  inline void set_parallelism(std::size_t threads, std::size_t grain = 16) {
+    detail::ParallelSettings::get().threads = std::max<std::size_t>(threads, 1);
+    detail::ParallelSettings::get().grain = std::max<std::size_t>(grain, 1);
+  }
+
+  /*! \brief The number of threads used by \ref parallel_for. */
+  inline std::size_t parallel_threads() { return detail::ParallelSettings::get().threads; }
+
+  /*! \brief The grain size used by \ref parallel_for. */
+  inline std::size_t parallel_grain() { return detail::ParallelSettings::get().grain; }
+
+  /*! \brief RAII helper to set the parallelism for a scope. */
+  class ParallelScope {
+  public:
+    ParallelScope(std::size_t threads, std::size_t grain = 16):
+      _threads(parallel_threads()),
+      _grain(parallel_grain())
+    { set_parallelism(threads, grain); }
+
+    ~ParallelScope() { set_parallelism(_threads, _grain); }
+
+    ParallelScope(const ParallelScope&) = delete;
+    ParallelScope& operator=(const ParallelScope&) = delete;
+  private:
+    std::size_t _threads;
+    std::size_t _grain;
+  };
+
+  /*! \brief Call f(i) for each i in [0, n), spreading the calls over
+      the threads of the global \ref ThreadPool.
+
+    The calls must be independent of each other, so that the result
+    does not depend on the order they are made in. If any call
+    throws, the remaining chunks still run and the first exception is
+    rethrown once all have finished.
+
+    Calls are always made serially if STATOR_NONATOMIC_REFCOUNT is
+    defined (see \ref sym::NodePtr).
+
+    \param n The size of the range.
+    \param f The function to call with each index.
+    \param threads The number of threads to use (see \ref set_parallelism).
+    \param grain The number of consecutive indices per task.
+  */
+  template<class F>
+  void parallel_for(std::size_t n, F f, std::size_t threads = parallel_threads(), std::size_t grain = parallel_grain()) {
+    grain = std::max<std::size_t>(grain, 1);
+#ifdef STATOR_NONATOMIC_REFCOUNT
+    //Expressions must not be shared between threads
+    threads = 1;
+#endif
+    if ((threads <= 1) || (n <= grain)) {
+      for (std::size_t i(0); i < n; ++i)
+	f(i);
+      return;
+    }
+
+    auto range = std::make_shared<detail::ParallelRange>();
+    range->n = n;
+    range->grain = grain;
+    range->chunks = (n + grain - 1) / grain;
+
+    //Helpers which start late find no chunks left, and never touch f
+    //once the caller has returned
+    const std::size_t helpers = std::min(threads, range->chunks) - 1;
+    ThreadPool& pool = ThreadPool::global();
+    pool.reserve(helpers);
+    for (std::size_t h(0); h < helpers; ++h)
+      pool.submit([range, &f]{ range->run(f); });
+
+    range->run(f);
+
+    std::unique_lock<std::mutex> lock(range->mutex);
+    range->finished.wait(lock, [&]{ return range->done == range->chunks; });
+    if (range->error)
+      std::rethrow_exception(range->error);
+  }
+}
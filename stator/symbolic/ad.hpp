@@ -23,8 +23,22 @@
 #pragma once
 
 #include <stator/symbolic/runtime.hpp>
+#include <stator/symbolic/compiled.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <unordered_map>
 
 namespace sym {
+  namespace detail {
+    //! \brief The name of a compile-time or runtime variable.
+    template<conststr Name, typename ...Args>
+    constexpr std::string_view var_name(const Var<Name, Args...>& v) { return v.getName(); }
+
+    inline std::string_view var_name(const VarRT& v) { return v._name; }
+  }
+
   template<size_t Nd, typename T, typename Var, typename Arg,
 	   typename = typename std::enable_if<detail::IsConstant<T>::value>::type>
   Eigen::Matrix<double, Nd+1,1> ad(const T& v, const EqualityOp<Var, Arg>&) {
@@ -36,7 +50,7 @@ namespace sym {
   template<size_t Nd, conststr N1, typename Var_t, typename Arg_t>
   Eigen::Matrix<double, Nd+1,1> ad(const Var<N1>& v, const EqualityOp<Var_t, Arg_t>& r) {
     Eigen::Matrix<double, Nd+1,1> result = Eigen::Matrix<double, Nd+1,1>::Zero();
-    if ((v == r._l)) {
+    if (detail::var_name(v) == r._l.getName()) {
       result[0] = r._r;
       if (Nd > 0) result[1] = 1.0;
     } else
@@ -86,6 +100,18 @@ namespace sym {
     return result;
   }
 
+  template<size_t Nd, typename Arg, typename Var_t, typename Arg_t>
+  Eigen::Matrix<double, Nd+1,1> ad(const UnaryOp<Arg, detail::Negate>& op, const EqualityOp<Var_t, Arg_t>& sub) {
+    return -ad<Nd>(op._arg, sub);
+  }
+
+  template<size_t Nd, typename Arg, typename Var_t, typename Arg_t>
+  Eigen::Matrix<double, Nd+1,1> ad(const UnaryOp<Arg, detail::Absolute>& op, const EqualityOp<Var_t, Arg_t>& sub) {
+    Eigen::Matrix<double, Nd+1,1> g = ad<Nd>(op._arg, sub);
+    //Away from zero, |g| is g multiplied by its sign
+    return double((g[0] > 0) - (g[0] < 0)) * g;
+  }
+
   template<size_t Nd, typename Arg, typename Var_t, typename Arg_t>
   Eigen::Matrix<double, Nd+1,1> ad(const UnaryOp<Arg, detail::Exp>& op, const EqualityOp<Var_t, Arg_t>& sub) {
     Eigen::Matrix<double, Nd+1,1> g = ad<Nd>(op._arg, sub);
@@ -229,6 +255,32 @@ namespace sym {
       return detail::ad_pow<Nd>(op._l, op._r, sub);
   }
   
+  template<size_t Nd, typename Var_t, typename Arg_t>
+  Eigen::Matrix<double, Nd+1,1> ad(const SumRT& op, const EqualityOp<Var_t, Arg_t>& sub) {
+    Eigen::Matrix<double, Nd+1,1> result = Eigen::Matrix<double, Nd+1,1>::Zero();
+    result[0] = op._constant;
+    for (const auto& t : op._terms)
+      result += t.second * ad<Nd>(t.first, sub);
+    return result;
+  }
+
+  template<size_t Nd, typename Var_t, typename Arg_t>
+  Eigen::Matrix<double, Nd+1,1> ad(const ProductRT& op, const EqualityOp<Var_t, Arg_t>& sub) {
+    Eigen::Matrix<double, Nd+1,1> result = Eigen::Matrix<double, Nd+1,1>::Zero();
+    result[0] = op._constant;
+    for (const auto& t : op._terms) {
+      const Eigen::Matrix<double, Nd+1,1> f = (t.second == 1) ? ad<Nd>(t.first, sub) : detail::ad_pow<Nd>(t.first, t.second, sub);
+      //The Cauchy product, in place from the highest order down
+      for (size_t k(Nd+1); k-- > 0;) {
+	double sum = 0;
+	for (size_t i(0); i <= k; ++i)
+	  sum += result[i] * f[k-i];
+	result[k] = sum;
+      }
+    }
+    return result;
+  }
+
   namespace detail {
     template<size_t Nd, typename Relation>
     struct ADRT_visitor : VisitorHelper<ADRT_visitor<Nd, Relation>, Eigen::Matrix<double, Nd+1,1>> {
@@ -248,4 +300,528 @@ namespace sym {
     detail::ADRT_visitor<Nd, EqualityOp<Var_t, Arg_t> > visitor(r);
     return f->visit(visitor);
   }
+
+  /*! \brief A value with its gradient, for multi-directional forward
+      mode automatic differentiation (see \ref gradient).
+
+    \tparam N The number of variables, or Eigen::Dynamic if this is
+    only known at runtime.
+   */
+  template<int N = Eigen::Dynamic>
+  struct Gradient {
+    typedef Eigen::Matrix<double, N, 1> Vector;
+
+    //! \brief The value of the expression.
+    double value;
+    //! \brief The partial derivatives with respect to each variable.
+    Vector grad;
+  };
+
+  namespace detail {
+    /*! \brief Binds compile-time variables to values for \ref
+        gradient, assigning each variable the direction of its
+        position in the list. */
+    template<typename ...Rels>
+    struct GradientRelations {
+      static constexpr int N = sizeof...(Rels);
+
+      Eigen::Index size() const { return N; }
+
+      template<typename V>
+      Gradient<N> operator()(const V& v) const {
+	Gradient<N> r{0, Gradient<N>::Vector::Zero()};
+	if (!find<0>(v, r))
+	  stator_throw() << "Unexpected variable " << var_name(v) << " for gradient";
+	return r;
+      }
+
+      template<std::size_t I, typename V>
+      bool find(const V& v, Gradient<N>& r) const {
+	if constexpr (I == sizeof...(Rels))
+	  return false;
+	else {
+	  const auto& rel = std::get<I>(_rels);
+	  if (var_name(v) != rel._l.getName())
+	    return find<I + 1>(v, r);
+	  r.value = double(rel._r);
+	  r.grad[I] = 1;
+	  return true;
+	}
+      }
+
+      std::tuple<const Rels&...> _rels;
+    };
+
+    /*! \brief Binds runtime variables to values through their slots,
+        for \ref gradient. */
+    template<int N>
+    struct GradientSlots {
+      Eigen::Index size() const { return _slots.slots().size(); }
+
+      Gradient<N> operator()(const VarRT& v) const {
+	const std::size_t slot = _slots(v);
+	Gradient<N> r{_values[slot], Gradient<N>::Vector::Zero(size())};
+	r.grad[slot] = 1;
+	return r;
+      }
+
+      SlotCache _slots;
+      const double* _values;
+    };
+
+    template<int N, typename T, typename Binding,
+	     typename = typename std::enable_if<std::is_arithmetic<T>::value || is_C<T>::value>::type>
+    Gradient<N> gradient_eval(const T& v, const Binding& b) {
+      return Gradient<N>{double(v), Gradient<N>::Vector::Zero(b.size())};
+    }
+
+    template<int N, conststr Name, typename ...Args, typename Binding>
+    Gradient<N> gradient_eval(const Var<Name, Args...>& v, const Binding& b) {
+      return b(v);
+    }
+
+    /*! \brief Wraps the binding of a \ref gradient, adding a table
+        of the gradients of the shared nodes of the runtime
+        expressions, so each is only evaluated once. */
+    template<int N, typename Binding>
+    struct GradientMemo {
+      Eigen::Index size() const { return _b.size(); }
+
+      template<typename V>
+      Gradient<N> operator()(const V& v) const { return _b(v); }
+
+      const Binding& _b;
+      mutable std::unordered_map<const RTBase*, Gradient<N>> _memo;
+    };
+
+    template<int N, typename Binding>
+    Gradient<N> gradient_eval(const Expr& f, const Binding& b);
+
+    template<int N, typename Binding>
+    Gradient<N> gradient_eval(const Expr& f, const GradientMemo<N, Binding>& b);
+
+    template<int N, typename Arg, typename Op, typename Binding>
+    Gradient<N> gradient_eval(const UnaryOp<Arg, Op>&, const Binding&) {
+      stator_throw() << "The gradient of " << Op::l_repr() << "..." << Op::r_repr() << " is not implemented";
+    }
+
+    template<int N, typename Arg, typename Binding>
+    Gradient<N> gradient_eval(const UnaryOp<Arg, Sine>& op, const Binding& b) {
+      const Gradient<N> g = gradient_eval<N>(op._arg, b);
+      return Gradient<N>{std::sin(g.value), std::cos(g.value) * g.grad};
+    }
+
+    template<int N, typename Arg, typename Binding>
+    Gradient<N> gradient_eval(const UnaryOp<Arg, Cosine>& op, const Binding& b) {
+      const Gradient<N> g = gradient_eval<N>(op._arg, b);
+      return Gradient<N>{std::cos(g.value), -std::sin(g.value) * g.grad};
+    }
+
+    template<int N, typename Arg, typename Binding>
+    Gradient<N> gradient_eval(const UnaryOp<Arg, Exp>& op, const Binding& b) {
+      const Gradient<N> g = gradient_eval<N>(op._arg, b);
+      const double e = std::exp(g.value);
+      return Gradient<N>{e, e * g.grad};
+    }
+
+    template<int N, typename Arg, typename Binding>
+    Gradient<N> gradient_eval(const UnaryOp<Arg, Log>& op, const Binding& b) {
+      const Gradient<N> g = gradient_eval<N>(op._arg, b);
+      return Gradient<N>{std::log(g.value), g.grad / g.value};
+    }
+
+    template<int N, typename Arg, typename Binding>
+    Gradient<N> gradient_eval(const UnaryOp<Arg, Absolute>& op, const Binding& b) {
+      const Gradient<N> g = gradient_eval<N>(op._arg, b);
+      return Gradient<N>{std::abs(g.value), double((g.value > 0) - (g.value < 0)) * g.grad};
+    }
+
+    template<int N, typename Arg, typename Binding>
+    Gradient<N> gradient_eval(const UnaryOp<Arg, Negate>& op, const Binding& b) {
+      const Gradient<N> g = gradient_eval<N>(op._arg, b);
+      return Gradient<N>{-g.value, -g.grad};
+    }
+
+    template<int N, typename LHS, typename Op, typename RHS, typename Binding>
+    Gradient<N> gradient_eval(const BinaryOp<LHS, Op, RHS>&, const Binding&) {
+      stator_throw() << "The gradient of the " << Op::repr() << " operator is not implemented";
+    }
+
+    template<int N, typename LHS, typename RHS, typename Binding>
+    Gradient<N> gradient_eval(const BinaryOp<LHS, Add, RHS>& op, const Binding& b) {
+      const Gradient<N> l = gradient_eval<N>(op._l, b);
+      const Gradient<N> r = gradient_eval<N>(op._r, b);
+      return Gradient<N>{l.value + r.value, l.grad + r.grad};
+    }
+
+    template<int N, typename LHS, typename RHS, typename Binding>
+    Gradient<N> gradient_eval(const BinaryOp<LHS, Subtract, RHS>& op, const Binding& b) {
+      const Gradient<N> l = gradient_eval<N>(op._l, b);
+      const Gradient<N> r = gradient_eval<N>(op._r, b);
+      return Gradient<N>{l.value - r.value, l.grad - r.grad};
+    }
+
+    template<int N, typename LHS, typename RHS, typename Binding>
+    Gradient<N> gradient_eval(const BinaryOp<LHS, Multiply, RHS>& op, const Binding& b) {
+      const Gradient<N> l = gradient_eval<N>(op._l, b);
+      const Gradient<N> r = gradient_eval<N>(op._r, b);
+      return Gradient<N>{l.value * r.value, r.value * l.grad + l.value * r.grad};
+    }
+
+    template<int N, typename LHS, typename RHS, typename Binding>
+    Gradient<N> gradient_eval(const BinaryOp<LHS, Divide, RHS>& op, const Binding& b) {
+      const Gradient<N> l = gradient_eval<N>(op._l, b);
+      const Gradient<N> r = gradient_eval<N>(op._r, b);
+      const double q = l.value / r.value;
+      return Gradient<N>{q, (l.grad - q * r.grad) / r.value};
+    }
+
+    //! \brief The gradient of a power with a constant exponent.
+    template<int N>
+    Gradient<N> gradient_pow(const Gradient<N>& l, const double e) {
+      return Gradient<N>{std::pow(l.value, e), e * std::pow(l.value, e - 1) * l.grad};
+    }
+
+    template<int N>
+    Gradient<N> gradient_pow(const Gradient<N>& l, const Gradient<N>& r) {
+      const double p = std::pow(l.value, r.value);
+      return Gradient<N>{p, r.value * std::pow(l.value, r.value - 1) * l.grad + p * std::log(l.value) * r.grad};
+    }
+
+    template<int N, typename LHS, typename RHS, typename Binding>
+    Gradient<N> gradient_eval(const BinaryOp<LHS, Power, RHS>& op, const Binding& b) {
+      if constexpr (IsConstant<RHS>::value)
+	return gradient_pow(gradient_eval<N>(op._l, b), double(op._r));
+      else
+	return gradient_pow(gradient_eval<N>(op._l, b), gradient_eval<N>(op._r, b));
+    }
+
+    template<int N, typename Binding>
+    Gradient<N> gradient_eval(const BinaryOp<Expr, Power, Expr>& op, const Binding& b) {
+      //Constant exponents avoid the logarithm, which is undefined for negative bases
+      if (op._r->_type_idx == Type_index<ConstantRT<double>>::value)
+	return gradient_pow(gradient_eval<N>(op._l, b), static_cast<const ConstantRT<double>&>(*op._r).get());
+      else
+	return gradient_pow(gradient_eval<N>(op._l, b), gradient_eval<N>(op._r, b));
+    }
+
+    template<int N, typename Binding>
+    Gradient<N> gradient_eval(const SumRT& op, const Binding& b) {
+      Gradient<N> result{op._constant, Gradient<N>::Vector::Zero(b.size())};
+      for (const auto& t : op._terms) {
+	const Gradient<N> g = gradient_eval<N>(t.first, b);
+	result.value += t.second * g.value;
+	result.grad += t.second * g.grad;
+      }
+      return result;
+    }
+
+    template<int N, typename Binding>
+    Gradient<N> gradient_eval(const ProductRT& op, const Binding& b) {
+      Gradient<N> result{op._constant, Gradient<N>::Vector::Zero(b.size())};
+      for (const auto& t : op._terms) {
+	Gradient<N> g = gradient_eval<N>(t.first, b);
+	if (t.second != 1)
+	  g = gradient_pow(g, t.second);
+	result.grad = g.value * result.grad + result.value * g.grad;
+	result.value *= g.value;
+      }
+      return result;
+    }
+
+    template<int N, typename Binding>
+    struct GradientRT : VisitorHelper<GradientRT<N, Binding>, Gradient<N>> {
+      GradientRT(const Binding& b): _b(b) {}
+
+      template<class T>
+      Gradient<N> apply(const T& v) {
+	stator_throw() << "The gradient of " << repr(v) << " is not implemented";
+      }
+
+      Gradient<N> apply(const double& v) { return gradient_eval<N>(v, _b); }
+
+      Gradient<N> apply(const VarRT& v) { return gradient_eval<N>(v, _b); }
+
+      template<typename Op>
+      Gradient<N> apply(const UnaryOp<Expr, Op>& op) { return gradient_eval<N>(op, _b); }
+
+      template<typename Op>
+      Gradient<N> apply(const BinaryOp<Expr, Op, Expr>& op) { return gradient_eval<N>(op, _b); }
+
+      template<typename Op>
+      Gradient<N> apply(const NaryOp<Op>& op) { return gradient_eval<N>(op, _b); }
+
+      const Binding& _b;
+    };
+
+    template<int N, typename Binding>
+    Gradient<N> gradient_eval(const Expr& f, const Binding& b) {
+      const GradientMemo<N, Binding> memo{b, {}};
+      return gradient_eval<N>(f, memo);
+    }
+
+    template<int N, typename Binding>
+    Gradient<N> gradient_eval(const Expr& f, const GradientMemo<N, Binding>& b) {
+      GradientRT<N, GradientMemo<N, Binding>> visitor(b);
+      //Nodes with a single reference can only be reached once
+      const bool shared = (f.use_count() > 1) && (f->_type_idx != Type_index<VarRT>::value) && (f->_type_idx != Type_index<ConstantRT<double>>::value);
+      if (!shared)
+	return f->visit(visitor);
+
+      auto it = b._memo.find(f.get());
+      if (it != b._memo.end())
+	return it->second;
+      Gradient<N> result = f->visit(visitor);
+      b._memo.emplace(f.get(), result);
+      return result;
+    }
+  }
+
+  /*! \brief Evaluate an expression and its gradient in a single
+      traversal, by multi-directional forward mode automatic
+      differentiation.
+
+    Each node carries its value along with the vector of its partial
+    derivatives with respect to all of the variables, so unlike \ref
+    ad, which follows one variable, the whole gradient is found at
+    once. The gradient has a fixed size, one entry per variable in
+    the order given.
+
+    \code{.cpp}
+    static constexpr char y_name[] = "y";
+    sym::Var<> x;
+    sym::Var<y_name> y;
+    auto g = sym::gradient(x * x * y, x = 2.0, y = 3.0);
+    //g.value = 12, g.grad = {12, 4}
+    \endcode
+
+    \param f The expression, which may be (or contain) an \ref Expr.
+    \param x The variables and their values.
+  */
+  template<typename F, typename ...Vars, typename ...Args>
+  Gradient<sizeof...(Vars)> gradient(const F& f, const EqualityOp<Vars, Args>&... x) {
+    const detail::GradientRelations<EqualityOp<Vars, Args>...> binding{std::tie(x...)};
+    return detail::gradient_eval<sizeof...(Vars)>(f, binding);
+  }
+
+  /*! \brief Evaluate a runtime expression and its gradient in a
+      single traversal (see \ref gradient).
+
+    Shared subexpressions (see \ref cse) are only evaluated once.
+
+    \tparam N The number of variables, if known at compile time, or
+    Eigen::Dynamic.
+
+    \param f The expression.
+    \param slots The slots of the variables of f.
+    \param values Pointer to the values of the variables, in slot order.
+    \return The value and the partial derivatives with respect to the
+    variables, in slot order.
+  */
+  template<int N = Eigen::Dynamic>
+  Gradient<N> gradient(const Expr& f, const VarSlots& slots, const double* values) {
+    if ((N != Eigen::Dynamic) && (std::size_t(N) != slots.size()))
+      stator_throw() << "A gradient of size " << N << " was requested over " << slots.size() << " variables";
+    const detail::GradientSlots<N> binding{slots, values};
+    return detail::gradient_eval<N>(f, binding);
+  }
+
+  /*! \brief Evaluate a runtime expression and its gradient in a
+      single traversal (see \ref gradient).
+
+    \param f The expression.
+    \param slots The slots of the variables of f.
+    \param values The values of the variables, in slot order.
+  */
+  template<int N = Eigen::Dynamic>
+  Gradient<N> gradient(const Expr& f, const VarSlots& slots, const std::vector<double>& values) {
+    if (values.size() != slots.size())
+      stator_throw() << "Expected " << slots.size() << " variable values, but was passed " << values.size();
+    return gradient<N>(f, slots, values.data());
+  }
+
+  /*! \brief A runtime expression compiled into a tape of Taylor
+      series arithmetic, for repeated evaluation of \ref ad.
+
+    The expression is lowered once into the program of a \ref
+    CompiledExpr, and each register of the program is given a
+    preallocated column of Nd+1 Taylor coefficients. Evaluating the
+    series at a new point replays the program over these columns,
+    without walking the tree or allocating memory.
+
+    \code{.cpp}
+    sym::Var<> x;
+    sym::TaylorTape<3> tape(sym::Expr("sin(x)*exp(x)"), sym::Expr(x));
+    for (double t : times) {
+      auto c = tape(t); //The same as sym::ad<3>(f, x = t)
+    }
+    \endcode
+
+    As with \ref ad, the coefficients are d^n f/dt^n / n!. A single
+    instance must not be evaluated on multiple threads at once (copy
+    it instead).
+  */
+  template<size_t Nd>
+  class TaylorTape {
+  public:
+    typedef Eigen::Matrix<double, Nd+1, 1> Coefficients;
+
+    /*! \brief Compile the tape of an expression.
+
+      \param f The expression, which must only contain the functions
+      supported by \ref CompiledExpr.
+      \param var The variable of the series.
+     */
+    TaylorTape(const Expr& f, const Expr& var) {
+      const CompiledExpr compiled(f, {var});
+      _program = compiled.program();
+      _result = compiled.result();
+      _coeffs = Eigen::Matrix<double, Nd+1, Eigen::Dynamic>::Zero(Nd+1, compiled.registers());
+      //The variable t, in register 0, is the series t + 1 h
+      if (Nd > 0)
+	_coeffs(1, 0) = 1;
+      for (const auto& c : compiled.constants())
+	_coeffs(0, c.first) = c.second;
+    }
+
+    /*! \brief Evaluate the Taylor coefficients of the expression.
+
+      \param t The point about which the series is expanded.
+     */
+    Coefficients operator()(const double t) const {
+      _coeffs(0, 0) = t;
+      for (const detail::Instruction& i : _program) {
+	double* out = _coeffs.col(i.dst).data();
+	const double* a = _coeffs.col(i.a).data();
+	const double* b = _coeffs.col(i.b).data();
+	switch (i.op) {
+	case detail::OpCode::Sine:
+	  sincos(a, out, _scratch.col(0).data());
+	  break;
+	case detail::OpCode::Cosine:
+	  sincos(a, _scratch.col(0).data(), out);
+	  break;
+	case detail::OpCode::Log:      log(a, out); break;
+	case detail::OpCode::Exp:      exp(a, out); break;
+	case detail::OpCode::Absolute:
+	  {
+	    const double sign = (a[0] > 0) - (a[0] < 0);
+	    for (size_t k(0); k < Nd+1; ++k)
+	      out[k] = sign * a[k];
+	    break;
+	  }
+	case detail::OpCode::Negate:
+	  for (size_t k(0); k < Nd+1; ++k)
+	    out[k] = -a[k];
+	  break;
+	case detail::OpCode::Add:
+	  for (size_t k(0); k < Nd+1; ++k)
+	    out[k] = a[k] + b[k];
+	  break;
+	case detail::OpCode::Subtract:
+	  for (size_t k(0); k < Nd+1; ++k)
+	    out[k] = a[k] - b[k];
+	  break;
+	case detail::OpCode::Multiply:
+	  multiply(a, b, out);
+	  break;
+	case detail::OpCode::Divide:
+	  out[0] = a[0] / b[0];
+	  for (size_t k(1); k < Nd+1; ++k) {
+	    out[k] = a[k];
+	    for (size_t j(0); j < k; ++j)
+	      out[k] -= out[j] * b[k - j];
+	    out[k] /= b[0];
+	  }
+	  break;
+	case detail::OpCode::Power:
+	  if (_coeffs.col(i.b).tail(Nd).isZero(0)) {
+	    //A constant exponent
+	    const double e = b[0];
+	    if ((a[0] == 0) && (e >= 0) && (e == std::floor(e))) {
+	      //The recurrence below divides by a[0], so a zero base is
+	      //raised by repeated multiplication. Each product shifts the
+	      //series by at least one order, so at most Nd+1 are needed.
+	      double* product = _scratch.col(0).data();
+	      for (size_t k(0); k < Nd+1; ++k)
+		out[k] = (k == 0);
+	      for (double n(0); (n < e) && (n < Nd+1); ++n) {
+		multiply(a, out, product);
+		std::copy(product, product + Nd + 1, out);
+	      }
+	      break;
+	    }
+	    out[0] = std::pow(a[0], e);
+	    for (size_t k(1); k < Nd+1; ++k) {
+	      out[k] = 0;
+	      for (size_t j(1); j <= k; ++j)
+		out[k] += ((e + 1) * j / k - 1) * a[j] * out[k - j];
+	      out[k] /= a[0];
+	    }
+	  } else {
+	    //a^b = exp(b ln(a))
+	    log(a, _scratch.col(0).data());
+	    multiply(b, _scratch.col(0).data(), _scratch.col(1).data());
+	    exp(_scratch.col(1).data(), out);
+	  }
+	  break;
+	}
+      }
+      return _coeffs.col(_result);
+    }
+
+    /*! \brief The number of instructions of the tape. */
+    std::size_t size() const { return _program.size(); }
+
+  private:
+    static void multiply(const double* a, const double* b, double* out) {
+      for (size_t k(0); k < Nd+1; ++k) {
+	out[k] = 0;
+	for (size_t j(0); j <= k; ++j)
+	  out[k] += a[j] * b[k - j];
+      }
+    }
+
+    static void exp(const double* g, double* out) {
+      out[0] = std::exp(g[0]);
+      for (size_t k(1); k < Nd+1; ++k) {
+	out[k] = 0;
+	for (size_t j(1); j <= k; ++j)
+	  out[k] += j * g[j] * out[k - j];
+	out[k] /= k;
+      }
+    }
+
+    static void log(const double* g, double* out) {
+      out[0] = std::log(g[0]);
+      for (size_t k(1); k < Nd+1; ++k) {
+	double sum = 0;
+	for (size_t j(1); j < k; ++j)
+	  sum += j * out[j] * g[k - j];
+	out[k] = (g[k] - sum / k) / g[0];
+      }
+    }
+
+    static void sincos(const double* g, double* sin, double* cos) {
+      sin[0] = std::sin(g[0]);
+      cos[0] = std::cos(g[0]);
+      for (size_t k(1); k < Nd+1; ++k) {
+	sin[k] = 0;
+	cos[k] = 0;
+	for (size_t j(1); j <= k; ++j) {
+	  sin[k] += j * g[j] * cos[k - j];
+	  cos[k] += j * g[j] * sin[k - j];
+	}
+	sin[k] /= k;
+	cos[k] /= -double(k);
+      }
+    }
+
+    std::vector<detail::Instruction> _program;
+    std::uint32_t _result;
+    //The Taylor coefficients of each register, one column per register
+    mutable Eigen::Matrix<double, Nd+1, Eigen::Dynamic> _coeffs;
+    //Intermediate series of the sine/cosine pair and of general powers
+    mutable Eigen::Matrix<double, Nd+1, 2> _scratch;
+  };
 }
@@ -0,0 +1,307 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <stator/symbolic/stats.hpp>
+
+namespace sym {
+  /*! \brief Counters of the memory allocations made for runtime
+      expression nodes (see \ref node_alloc_stats).
+
+    As with \ref EngineStats, the counters are only maintained if
+    STATOR_STATS is defined. Otherwise, every count is zero.
+   */
+  struct NodeAllocStats {
+    //! \brief Node allocations (each node holds its own reference count).
+    std::size_t allocations;
+    //! \brief Allocations which went to the global heap (operator new).
+    std::size_t heap_allocations;
+    //! \brief Allocations served by a \ref NodeArena.
+    std::size_t arena_allocations;
+    //! \brief Node deallocations.
+    std::size_t deallocations;
+  };
+
+  namespace detail {
+#ifdef STATOR_STATS
+    struct NodeAllocCounters {
+      std::atomic<std::size_t> allocations{0};
+      std::atomic<std::size_t> heap_allocations{0};
+      std::atomic<std::size_t> arena_allocations{0};
+      std::atomic<std::size_t> deallocations{0};
+
+      static NodeAllocCounters& get() {
+	static NodeAllocCounters instance;
+	return instance;
+      }
+    };
+
+# define STATOR_STATS_COUNT_ALLOC(COUNTER) ::sym::detail::NodeAllocCounters::get().COUNTER.fetch_add(1, std::memory_order_relaxed)
+#else
+# define STATOR_STATS_COUNT_ALLOC(COUNTER) ((void)0)
+#endif
+
+    /*! \brief A slab allocator for runtime expression nodes.
+
+      Memory is carved out of large chunks with a bump pointer, and
+      freed blocks are kept on one free list per size class for
+      reuse. Chunks are only returned to the heap when the pool is
+      destroyed.
+
+      The pool is reference counted by its handles (see \ref
+      create) and by every block allocated from it, so it is
+      destroyed once its handles are gone and the last node
+      allocated from it has been freed.
+
+      Nodes may be released on a different thread to the one which
+      created them, so the pool is guarded by a mutex.
+     */
+    class NodePool {
+    public:
+      /*! \brief Create a pool, returning a handle which keeps it
+          alive (along with its live blocks). */
+      static std::shared_ptr<NodePool> create(std::size_t chunk_size) {
+	return std::shared_ptr<NodePool>(new NodePool(chunk_size), [](NodePool* p) { p->release(); });
+      }
+
+      NodePool(const NodePool&) = delete;
+      NodePool& operator=(const NodePool&) = delete;
+
+      void acquire() { _refs.fetch_add(1, std::memory_order_relaxed); }
+
+      void release() {
+	if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	  delete this;
+      }
+
+      /*! \brief Allocates a block of memory, or returns nullptr if
+          the block is too large to be pooled. */
+      void* allocate(std::size_t bytes) {
+	const std::size_t cls = size_class(bytes);
+	if (cls >= _classes)
+	  return nullptr;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_free[cls]) {
+	  FreeBlock* block = _free[cls];
+	  _free[cls] = block->next;
+	  return block;
+	}
+
+	const std::size_t block_size = (cls + 1) * _granularity;
+	if (std::size_t(_end - _cursor) < block_size) {
+	  _chunks.push_back(::operator new(_chunk_size));
+	  _cursor = static_cast<char*>(_chunks.back());
+	  _end = _cursor + _chunk_size;
+	}
+
+	void* block = _cursor;
+	_cursor += block_size;
+	return block;
+      }
+
+      void deallocate(void* p, std::size_t bytes) {
+	const std::size_t cls = size_class(bytes);
+	std::lock_guard<std::mutex> lock(_mutex);
+	FreeBlock* block = static_cast<FreeBlock*>(p);
+	block->next = _free[cls];
+	_free[cls] = block;
+      }
+
+      static bool pooled(std::size_t bytes) { return size_class(bytes) < _classes; }
+
+    private:
+      //Every chunk must hold at least one block of the largest size class
+      NodePool(std::size_t chunk_size): _refs(1), _chunk_size(std::max(chunk_size, _classes * _granularity)), _cursor(nullptr), _end(nullptr) {
+	_free.fill(nullptr);
+      }
+
+      ~NodePool() {
+	for (void* chunk : _chunks)
+	  ::operator delete(chunk);
+      }
+
+      struct FreeBlock { FreeBlock* next; };
+
+      static constexpr std::size_t _granularity = alignof(std::max_align_t);
+      static constexpr std::size_t _classes = 16;
+
+      static std::size_t size_class(std::size_t bytes) { return (bytes + _granularity - 1) / _granularity - 1; }
+
+      std::atomic<std::size_t> _refs;
+      std::mutex _mutex;
+      std::size_t _chunk_size;
+      std::vector<void*> _chunks;
+      char* _cursor;
+      char* _end;
+      std::array<FreeBlock*, _classes> _free;
+    };
+
+    /*! \brief The pool used by node allocations on this thread (if any). */
+    inline std::shared_ptr<NodePool>& current_node_pool() {
+      thread_local std::shared_ptr<NodePool> pool;
+      return pool;
+    }
+
+    /*! \brief Allocates the memory for a node from a pool or, if
+        there is none (or the node is too large to pool), from the
+        global heap, in which case pool is set to nullptr. */
+    inline void* allocate_node(std::size_t bytes, NodePool*& pool) {
+      STATOR_STATS_COUNT_ALLOC(allocations);
+      if (pool)
+	if (void* p = pool->allocate(bytes)) {
+	  STATOR_STATS_COUNT_ALLOC(arena_allocations);
+	  pool->acquire();
+	  return p;
+	}
+      pool = nullptr;
+      STATOR_STATS_COUNT_ALLOC(heap_allocations);
+      return ::operator new(bytes);
+    }
+
+    inline void deallocate_node(void* p, std::size_t bytes, NodePool* pool) {
+      STATOR_STATS_COUNT_ALLOC(deallocations);
+      if (pool) {
+	pool->deallocate(p, bytes);
+	pool->release();
+      } else
+	::operator delete(p);
+    }
+
+    /*! \brief Gives \ref make_node access to the protected
+        constructors of the runtime node types. */
+    template<class T>
+    struct NodeConstructor : public T {
+      template<class ...Args>
+      NodeConstructor(Args&& ...args): T(std::forward<Args>(args)...) {}
+    };
+
+    /*! \brief Allocates a runtime node (which holds its own
+        reference count) from the current \ref NodePool of this
+        thread, if any. */
+    template<class T, class ...Args>
+    NodePtr<T> make_node(Args&& ...args) {
+      typedef NodeConstructor<T> Node;
+      NodePool* pool = current_node_pool().get();
+      void* memory = allocate_node(sizeof(Node), pool);
+      Node* node;
+      try {
+	node = ::new (memory) Node(std::forward<Args>(args)...);
+      } catch (...) {
+	deallocate_node(memory, sizeof(Node), pool);
+	throw;
+      }
+      node->_pool = pool;
+      node->_node_size = std::uint32_t(sizeof(Node));
+      STATOR_STATS_COUNT_NODE(node->_type_idx);
+      return NodePtr<T>(node);
+    }
+
+    /*! \brief Destroys a node once its last reference is dropped,
+        returning its memory to where it was allocated from. */
+    inline void destroy_node(const RTBase* node) {
+      NodePool* pool = node->_pool;
+      const std::size_t bytes = node->_node_size;
+      void* memory = const_cast<void*>(dynamic_cast<const void*>(node));
+      node->~RTBase();
+      deallocate_node(memory, bytes, pool);
+    }
+  }
+
+  /*! \brief A memory arena for runtime expression nodes.
+
+    Nodes are normally allocated from the global heap. While a \ref
+    NodeArenaScope is active on a thread, nodes created on that
+    thread are instead carved out of the arena's slabs, which makes
+    allocation and deallocation a free-list operation. This pays off
+    for parser and derivative heavy workloads which create and
+    discard many small nodes.
+
+    Nodes may freely outlive the arena handle and the scope, the
+    arena memory is released once its last node is destroyed.
+
+    \code{.cpp}
+    sym::NodeArena arena;
+    {
+      sym::NodeArenaScope scope(arena);
+      sym::Expr f("x*x+sin(y)");
+    }
+    \endcode
+   */
+  class NodeArena {
+  public:
+    /*! \brief Create an arena which allocates its slabs in chunks of
+        chunk_size bytes (raised, if needed, to fit the largest
+        pooled node). */
+    NodeArena(std::size_t chunk_size = 64 * 1024): _pool(detail::NodePool::create(chunk_size)) {}
+
+  private:
+    friend class NodeArenaScope;
+    std::shared_ptr<detail::NodePool> _pool;
+  };
+
+  /*! \brief RAII helper which directs node allocations on this thread
+      to a \ref NodeArena for its lifetime. Scopes may be nested. */
+  class NodeArenaScope {
+  public:
+    NodeArenaScope(const NodeArena& arena): _previous(detail::current_node_pool()) {
+      detail::current_node_pool() = arena._pool;
+    }
+
+    ~NodeArenaScope() { detail::current_node_pool() = _previous; }
+
+    NodeArenaScope(const NodeArenaScope&) = delete;
+    NodeArenaScope& operator=(const NodeArenaScope&) = delete;
+
+  private:
+    std::shared_ptr<detail::NodePool> _previous;
+  };
+
+  /*! \brief A snapshot of the node allocation counters. */
+  inline NodeAllocStats node_alloc_stats() {
+#ifdef STATOR_STATS
+    auto& c = detail::NodeAllocCounters::get();
+    return NodeAllocStats{c.allocations.load(), c.heap_allocations.load(), c.arena_allocations.load(), c.deallocations.load()};
+#else
+    return NodeAllocStats{};
+#endif
+  }
+
+  /*! \brief Resets the node allocation counters to zero. */
+  inline void reset_node_alloc_stats() {
+#ifdef STATOR_STATS
+    auto& c = detail::NodeAllocCounters::get();
+    c.allocations = 0;
+    c.heap_allocations = 0;
+    c.arena_allocations = 0;
+    c.deallocations = 0;
+#endif
+  }
+}
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <stator/symbolic/symbolic.hpp>
+#include <stator/parallel.hpp>
 #include <iterator> // For std::forward_iterator_tag
 #include <cstddef>  // For std::ptrdiff_t
 
@@ -400,14 +401,11 @@ namespace sym
     auto &out = detail::unwrap(out_ptr);
     out.resize(in.getDimensions());
 
+    //Elements are independent, so are processed in parallel when enabled (see stator::set_parallelism)
     auto outp = out.begin();
     auto inp = in.begin();
-    while (outp != out.end())
-    {
-      *outp = derivative(*inp, x);
-      ++outp;
-      ++inp;
-    }
+    stator::parallel_for(std::distance(outp, out.end()), [&](std::size_t i)
+                         { outp[i] = derivative(inp[i], x); });
     return out_ptr;
   }
 
@@ -559,14 +557,11 @@ namespace sym
     auto &out = detail::unwrap(out_ptr);
     out.resize(in.getDimensions());
 
+    //Elements are independent, so are processed in parallel when enabled (see stator::set_parallelism)
     auto outp = out.begin();
     auto inp = in.begin();
-    while (outp != out.end())
-    {
-      *outp = simplify(*inp);
-      ++outp;
-      ++inp;
-    }
+    stator::parallel_for(std::distance(outp, out.end()), [&](std::size_t i)
+                         { outp[i] = simplify(inp[i]); });
     return out_ptr;
   }
 
@@ -25,7 +25,7 @@
 namespace sym {
   template<>
   class Array<Expr, LinearAddressing<-1u>> : public RTBaseHelper<ArrayRT>, public Addressing<Expr, LinearAddressing<-1u>>, public detail::ArrayBase  {
-    private:
+    protected:
     typedef Addressing<Expr, LinearAddressing<-1u>> Base;
 
     Array(): Base(0) {}
@@ -34,16 +34,16 @@ namespace sym {
 
     Array(const std::initializer_list<Expr>& vals): Base(vals) {}
 
-    typedef std::shared_ptr<Array> ArrayPtr;
+    typedef NodePtr<Array> ArrayPtr;
   public:
     typedef Expr Value;
     
     static auto create(Base::Coords d = 0) {
-      return ArrayPtr(new Array(d));
+      return detail::make_node<Array>(d);
     }
 
     static auto create(const std::initializer_list<Expr>& vals) {
-      return ArrayPtr(new Array(vals));
+      return detail::make_node<Array>(vals);
     }
 
     //We need to force the use of the Addressing operator[], not the RTBaseHelper::operator[], same for ==
@@ -443,27 +443,45 @@ namespace sym {
     return std::make_pair(L, R);
   }
 
+  namespace detail {
+    /*! \brief String representation of a binary operation, given
+        the representations of its operands.
+
+      The result is built by appending to the LHS representation
+      where possible, so long left-deep chains of operations are
+      printed in linear time.
+    */
+    template<class Config, class LHS, class RHS, class Op>
+    inline std::string repr_binary(const sym::BinaryOp<LHS, Op, RHS>& op, std::string LHS_repr, std::string RHS_repr) {
+      const auto this_BP = BP(op);
+      const auto LHS_BP  = BP(op._l);
+      const auto RHS_BP  = BP(op._r);
+
+      //Right associative operators also wrap a LHS of the same
+      //precedence, as (x^2)^3 is not x^2^3
+      if ((LHS_BP.second < this_BP.first) || ((Op::associativity == Associativity::RIGHT) && (LHS_BP.second == this_BP.first)) || Config::Force_parenthesis)
+	LHS_repr = paren_wrap<Config>(std::move(LHS_repr));
+
+      if (((this_BP.second > RHS_BP.first) && !Op::wrapped) || Config::Force_parenthesis)
+	RHS_repr = paren_wrap<Config>(std::move(RHS_repr));
+
+      std::string out = Config::Latex_output ? Op::l_latex_repr() : Op::l_repr();
+      if (out.empty())
+	out = std::move(LHS_repr);
+      else
+	out += LHS_repr;
+      out += Config::Latex_output ? Op::latex_repr() : Op::repr();
+      out += RHS_repr;
+      out += Config::Latex_output ? Op::r_latex_repr() : Op::r_repr();
+      return out;
+    }
+  }
+
   /*! \brief String representation of binary operations.
    */
   template<class Config = DefaultReprConfig, class LHS, class RHS, class Op>
   inline std::string repr(const sym::BinaryOp<LHS, Op, RHS>& op) {
-    const auto this_BP = BP(op);
-    const auto LHS_BP  = BP(op._l);
-    const auto RHS_BP  = BP(op._r);
-
-    std::string LHS_repr = repr<Config>(op._l);
-    if (LHS_BP.second < this_BP.first || Config::Force_parenthesis)
-      LHS_repr = detail::paren_wrap<Config>(LHS_repr);
-
-    std::string RHS_repr = repr<Config>(op._r);
-    if (((this_BP.second > RHS_BP.first) && !Op::wrapped) || Config::Force_parenthesis)
-      RHS_repr = detail::paren_wrap<Config>(RHS_repr);
-
-    return (Config::Latex_output ? Op::l_latex_repr() : Op::l_repr())
-      +  LHS_repr
-      + (Config::Latex_output ? Op::latex_repr() : Op::repr())
-      + RHS_repr
-      + (Config::Latex_output ? Op::r_latex_repr() : Op::r_repr());
+    return detail::repr_binary<Config>(op, repr<Config>(op._l), repr<Config>(op._r));
   }
 }
 
@@ -26,17 +26,30 @@ namespace sym {
   template<typename Op>
   struct BinaryOp<Expr, Op, Expr> : public RTBaseHelper<BinaryOp<Expr, Op, Expr> >, public Dynamic {
   protected:
-    BinaryOp(const Expr& lhs, const Expr& rhs): _l(lhs), _r(rhs) {}
+    BinaryOp(const Expr& lhs, const Expr& rhs): _l(lhs), _r(rhs) {
+      if (_l && _r && _l->_hash_cached && _r->_hash_cached)
+	RTBase::cache_hash(std::hash<BinaryOp>{}(*this));
+    }
     BinaryOp(const BinaryOp& e) = default;
   public:
+    ~BinaryOp() {
+      //Deep expressions are destroyed without recursion
+      detail::release_operand(_l);
+      detail::release_operand(_r);
+    }
 
     static auto create(const Expr& lhs, const Expr& rhs) {
-      return std::shared_ptr<BinaryOp>(new BinaryOp(lhs, rhs));
+      if (interning() && lhs && rhs && detail::InternTable::get().current(*lhs) && detail::InternTable::get().current(*rhs))
+	return detail::InternTable::get().lookup<BinaryOp>(detail::intern_key(detail::Type_index<BinaryOp>::value, lhs.get(), rhs.get()),
+							   [&](const BinaryOp& o) { return (o._l.get() == lhs.get()) && (o._r.get() == rhs.get()); },
+							   [&]() { return detail::make_node<BinaryOp>(lhs, rhs); });
+
+      return detail::make_node<BinaryOp>(lhs, rhs);
     }
     
     bool operator==(const BinaryOp& o) const {
       //Shortcut comparison before proceeding with item by item
-      return (this == &o) || ((_l == o._l) && (_r == o._r));
+      return (this == &o) || detail::equal_operands(*this, o);
     }
     
     Expr getLHS() const {
@@ -0,0 +1,593 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stator/symbolic/cse.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sym {
+  namespace detail {
+    /*! \brief The operations of the \ref CompiledExpr register
+        machine. These share the type indices of the corresponding
+        runtime operator nodes. */
+    enum class OpCode : std::uint8_t {
+      Sine = detail::Sine::type_index,
+      Cosine = detail::Cosine::type_index,
+      Log = detail::Log::type_index,
+      Exp = detail::Exp::type_index,
+      Absolute = detail::Absolute::type_index,
+      Add = detail::Add::type_index,
+      Subtract = detail::Subtract::type_index,
+      Multiply = detail::Multiply::type_index,
+      Divide = detail::Divide::type_index,
+      Power = detail::Power::type_index,
+      Negate = detail::Negate::type_index
+    };
+
+    /*! \brief A single \ref CompiledExpr instruction, which stores
+        op(r[a], r[b]) in register r[dst]. Unary operations ignore
+        b. */
+    struct Instruction {
+      OpCode op;
+      std::uint32_t dst;
+      std::uint32_t a;
+      std::uint32_t b;
+    };
+
+    /*! \brief Lowers an Expr into the \ref CompiledExpr program.
+
+      Each visit returns the register holding the value of the
+      visited node. Variables take the first registers (in the order
+      given), constants are pooled into their own registers, and
+      every operation writes to a fresh register.
+     */
+    struct CompileRT : VisitorHelper<CompileRT, std::uint32_t> {
+      CompileRT(const VarSlots& slots): _slots(slots), _registers(slots.size(), 0.0) {}
+
+      /*! \brief Returns the register of a node, emitting its
+          program on the first visit only. Shared nodes (see \ref
+          cse) are therefore evaluated once. */
+      std::uint32_t visit_child(const Expr& e) {
+	auto it = _nodes.find(e.get());
+	if (it != _nodes.end())
+	  return it->second;
+	const std::uint32_t reg = e->visit(*this);
+	_nodes.emplace(e.get(), reg);
+	return reg;
+      }
+
+      /*! \brief Emits the program of an expression, returning the
+          register of its value.
+
+	The operator nodes are lowered bottom up with \ref
+	post_order, which is also the order their registers are
+	needed in, so each visit finds its operands in _nodes rather
+	than recursing into them. Leaves are lowered by their parents,
+	so constant exponents are not pooled needlessly.
+      */
+      std::uint32_t lower(const Expr& root) {
+	post_order(*root, [&](const RTBase& node) { return !is_leaf(node) && !_nodes.count(&node); },
+		   [&](const RTBase& node, std::size_t) { visit_child(Expr(node)); });
+	return visit_child(root);
+      }
+
+      static bool is_leaf(const RTBase& e) {
+	return (e._type_idx == Type_index<ConstantRT<double>>::value) || (e._type_idx == Type_index<VarRT>::value);
+      }
+
+      //By default, throw an exception!
+      template<class T>
+      std::uint32_t apply(const T& v) { stator_throw() << "CompiledExpr cannot operate on this (" << repr(v) << ") expression"; }
+
+      //Constants are pooled by bit pattern, as -0.0 == 0.0 but they
+      //differ as divisors, and NaN is not equal to itself
+      std::uint32_t apply(const double& v) {
+	std::uint64_t bits;
+	std::memcpy(&bits, &v, sizeof(bits));
+	auto it = _constants.find(bits);
+	if (it != _constants.end())
+	  return it->second;
+	return _constants[bits] = new_register(v);
+      }
+
+      std::uint32_t apply(const VarRT& v) { return std::uint32_t(_slots[v]); }
+
+      template<typename Op>
+      auto apply(const UnaryOp<Expr, Op>& op) -> decltype(double(Op::apply(0.0)), std::uint32_t()) {
+	const std::uint32_t a = visit_child(op.getArg());
+	return emit(OpCode(Op::type_index), a, a);
+      }
+
+      template<typename Op>
+      std::uint32_t apply(const BinaryOp<Expr, Op, Expr>& op) {
+	const std::uint32_t a = visit_child(op.getLHS());
+	const std::uint32_t b = visit_child(op.getRHS());
+	return emit(OpCode(Op::type_index), a, b);
+      }
+
+      //Small positive integer powers are expanded into
+      //multiplications (by squaring), which is much cheaper than pow
+      //and vectorizes in batch evaluation.
+      std::uint32_t apply(const BinaryOp<Expr, detail::Power, Expr>& op) {
+	const std::uint32_t a = visit_child(op.getLHS());
+	if (op.getRHS()->_type_idx == Type_index<ConstantRT<double>>::value)
+	  return power(a, static_cast<const ConstantRT<double>&>(*op.getRHS()).get());
+	const std::uint32_t b = visit_child(op.getRHS());
+	return emit(OpCode::Power, a, b);
+      }
+
+      //Flattened sums and products are lowered to chains of binary
+      //operations
+      std::uint32_t apply(const SumRT& op) {
+	std::uint32_t acc = 0;
+	for (std::size_t i(0); i < op._terms.size(); ++i) {
+	  const std::uint32_t a = visit_child(op._terms[i].first);
+	  const double c = op._terms[i].second;
+	  if (i == 0)
+	    acc = (c == 1) ? a : ((c == -1) ? emit(OpCode::Negate, a, a) : emit(OpCode::Multiply, apply(c), a));
+	  else if ((c == 1) || (c == -1))
+	    acc = emit((c == 1) ? OpCode::Add : OpCode::Subtract, acc, a);
+	  else
+	    acc = emit(OpCode::Add, acc, emit(OpCode::Multiply, apply(c), a));
+	}
+	return (op._constant != 0) ? emit(OpCode::Add, acc, apply(op._constant)) : acc;
+      }
+
+      std::uint32_t apply(const ProductRT& op) {
+	bool empty = (op._constant == 1) || (op._constant == -1);
+	std::uint32_t acc = empty ? 0 : apply(op._constant);
+	//Factors with negative exponents divide the result
+	for (const bool numerator : {true, false})
+	  for (const auto& t : op._terms) {
+	    if ((t.second > 0) != numerator)
+	      continue;
+	    const std::uint32_t a = power(visit_child(t.first), std::abs(t.second));
+	    if (empty)
+	      acc = numerator ? a : emit(OpCode::Divide, apply(1.0), a);
+	    else
+	      acc = emit(numerator ? OpCode::Multiply : OpCode::Divide, acc, a);
+	    empty = false;
+	  }
+	return (op._constant == -1) ? emit(OpCode::Negate, acc, acc) : acc;
+      }
+
+      std::uint32_t power(std::uint32_t a, double n) {
+	if ((n >= 1) && (n <= _max_expanded_power) && (n == std::floor(n)))
+	  return expand_power(a, int(n));
+	return emit(OpCode::Power, a, apply(n));
+      }
+
+      std::uint32_t expand_power(std::uint32_t a, int n) {
+	if (n == 1)
+	  return a;
+	const std::uint32_t half = expand_power(a, n / 2);
+	const std::uint32_t square = emit(OpCode::Multiply, half, half);
+	return (n % 2) ? emit(OpCode::Multiply, square, a) : square;
+      }
+
+      std::uint32_t apply(const BinaryOp<Expr, detail::Equality, Expr>& op) {
+	stator_throw() << "CompiledExpr cannot operate on this (" << repr(op) << ") expression";
+      }
+
+      std::uint32_t apply(const BinaryOp<Expr, detail::ArrayAccess, Expr>& op) {
+	stator_throw() << "CompiledExpr cannot operate on this (" << repr(op) << ") expression";
+      }
+
+      std::uint32_t apply(const BinaryOp<Expr, detail::Units, Expr>& op) {
+	stator_throw() << "CompiledExpr cannot operate on this (" << repr(op) << ") expression";
+      }
+
+      std::uint32_t apply(const BinaryOp<Expr, detail::Uncertainty, Expr>& op) {
+	stator_throw() << "CompiledExpr cannot operate on this (" << repr(op) << ") expression";
+      }
+
+      std::uint32_t new_register(double initial) {
+	_registers.push_back(initial);
+	return std::uint32_t(_registers.size() - 1);
+      }
+
+      std::uint32_t emit(OpCode op, std::uint32_t a, std::uint32_t b) {
+	const std::uint32_t dst = new_register(0);
+	_program.push_back(Instruction{op, dst, a, b});
+	return dst;
+      }
+
+      static constexpr int _max_expanded_power = 16;
+
+      const VarSlots& _slots;
+      std::unordered_map<const RTBase*, std::uint32_t> _nodes;
+      std::unordered_map<std::uint64_t, std::uint32_t> _constants;
+      std::vector<double> _registers;
+      std::vector<Instruction> _program;
+    };
+  }
+
+  /*! \brief An Expr lowered to a flat program for fast, repeated
+      numerical evaluation.
+
+    Evaluating an Expr (e.g., via \ref fast_sub) walks the tree of
+    nodes, paying for a virtual call and type dispatch at every
+    node. A CompiledExpr instead walks the tree once, at
+    construction, and emits a linear program for a simple register
+    machine. Repeated subexpressions are merged (see \ref cse) and
+    evaluated once. Constants are stored in the initial register
+    file, and the variables are copied into the first registers at
+    each evaluation.
+
+    \code{.cpp}
+    sym::CompiledExpr f(sym::Expr("x*sin(y)+2"), {sym::Expr("x"), sym::Expr("y")});
+    double r = f({1.0, 0.5}); //x=1, y=0.5
+    \endcode
+
+    Only expressions of scalar arithmetic and the elementary
+    functions can be compiled, and every variable must appear in the
+    variable list, otherwise the constructor throws.
+
+    Many points may be evaluated at once with \ref batch, and the
+    gradient with respect to all the variables is available by reverse
+    mode differentiation with \ref gradient.
+
+    The register file is held inside the CompiledExpr, thus a single
+    instance must not be evaluated on multiple threads at once (copy
+    it instead).
+   */
+  class CompiledExpr {
+  public:
+    /*! \brief Compile an expression.
+
+      \param f The expression to compile.
+      \param vars The variables of f, in the order their values are passed for evaluation.
+     */
+    CompiledExpr(const Expr& f, const std::vector<Expr>& vars):
+      CompiledExpr(f, VarSlots(vars))
+    {}
+
+    /*! \brief Compile an expression.
+
+      \param f The expression to compile.
+      \param vars The slots of the variables of f.
+     */
+    CompiledExpr(const Expr& f, const VarSlots& vars):
+      _variables(vars.size())
+    {
+      //Repeated subexpressions are merged first, so they are only evaluated once
+      const Expr dag = cse(f).dag;
+      detail::CompileRT compiler(vars);
+      _result = compiler.lower(dag);
+      _registers = std::move(compiler._registers);
+      _program = std::move(compiler._program);
+      for (const auto& c : compiler._constants)
+	_constants.emplace_back(c.second, _registers[c.second]);
+      std::sort(_constants.begin(), _constants.end());
+      _adjoints.resize(_registers.size());
+      allocate_batch_registers();
+    }
+
+    /*! \brief Evaluate the expression.
+
+      \param values Pointer to the values of the variables (in the
+      order given at construction).
+     */
+    double operator()(const double* values) const {
+      double* r = _registers.data();
+      std::copy(values, values + _variables, r);
+      for (const detail::Instruction& i : _program)
+	switch (i.op) {
+	case detail::OpCode::Sine:     r[i.dst] = detail::Sine::apply(r[i.a]); break;
+	case detail::OpCode::Cosine:   r[i.dst] = detail::Cosine::apply(r[i.a]); break;
+	case detail::OpCode::Log:      r[i.dst] = detail::Log::apply(r[i.a]); break;
+	case detail::OpCode::Exp:      r[i.dst] = detail::Exp::apply(r[i.a]); break;
+	case detail::OpCode::Absolute: r[i.dst] = detail::Absolute::apply(r[i.a]); break;
+	case detail::OpCode::Negate:   r[i.dst] = detail::Negate::apply(r[i.a]); break;
+	case detail::OpCode::Add:      r[i.dst] = detail::Add::apply(r[i.a], r[i.b]); break;
+	case detail::OpCode::Subtract: r[i.dst] = detail::Subtract::apply(r[i.a], r[i.b]); break;
+	case detail::OpCode::Multiply: r[i.dst] = detail::Multiply::apply(r[i.a], r[i.b]); break;
+	case detail::OpCode::Divide:   r[i.dst] = detail::Divide::apply(r[i.a], r[i.b]); break;
+	case detail::OpCode::Power:    r[i.dst] = detail::Power::apply(r[i.a], r[i.b]); break;
+	}
+      return r[_result];
+    }
+
+    /*! \brief Evaluate the expression.
+
+      \param values The values of the variables (in the order given at
+      construction).
+     */
+    double operator()(const std::vector<double>& values) const {
+      if (values.size() != _variables)
+	stator_throw() << "CompiledExpr expects " << _variables << " variable values, but was passed " << values.size();
+      return (*this)(values.data());
+    }
+
+    /*! \brief Evaluate the expression and its gradient by reverse
+        mode automatic differentiation.
+
+      The program is the tape: a forward sweep evaluates it, keeping
+      the value of every register, then a single backward sweep
+      accumulates the adjoint of each register. The cost of the whole
+      gradient is therefore a small multiple of one evaluation,
+      whatever the number of variables, and no memory is allocated.
+
+      \param values Pointer to the values of the variables (in the
+      order given at construction).
+      \param gradient Pointer to the array where the partial
+      derivative with respect to each variable is written.
+      \return The value of the expression.
+     */
+    double gradient(const double* values, double* gradient) const {
+      const double value = (*this)(values);
+      const double* r = _registers.data();
+      std::fill(_adjoints.begin(), _adjoints.end(), 0.0);
+      double* adj = _adjoints.data();
+      adj[_result] = 1;
+
+      for (auto it = _program.rbegin(); it != _program.rend(); ++it) {
+	const detail::Instruction& i = *it;
+	const double d = adj[i.dst];
+	switch (i.op) {
+	case detail::OpCode::Sine:     adj[i.a] += d * std::cos(r[i.a]); break;
+	case detail::OpCode::Cosine:   adj[i.a] -= d * std::sin(r[i.a]); break;
+	case detail::OpCode::Log:      adj[i.a] += d / r[i.a]; break;
+	case detail::OpCode::Exp:      adj[i.a] += d * r[i.dst]; break;
+	case detail::OpCode::Absolute: adj[i.a] += d * ((r[i.a] > 0) - (r[i.a] < 0)); break;
+	case detail::OpCode::Negate:   adj[i.a] -= d; break;
+	case detail::OpCode::Add:
+	  adj[i.a] += d;
+	  adj[i.b] += d;
+	  break;
+	case detail::OpCode::Subtract:
+	  adj[i.a] += d;
+	  adj[i.b] -= d;
+	  break;
+	case detail::OpCode::Multiply:
+	  adj[i.a] += d * r[i.b];
+	  adj[i.b] += d * r[i.a];
+	  break;
+	case detail::OpCode::Divide:
+	  adj[i.a] += d / r[i.b];
+	  adj[i.b] -= d * r[i.dst] / r[i.b];
+	  break;
+	case detail::OpCode::Power:
+	  adj[i.a] += d * r[i.b] * std::pow(r[i.a], r[i.b] - 1);
+	  adj[i.b] += d * r[i.dst] * std::log(r[i.a]);
+	  break;
+	}
+      }
+
+      std::copy(adj, adj + _variables, gradient);
+      return value;
+    }
+
+    /*! \brief Evaluate the gradient of the expression (see \ref
+        gradient(const double*, double*) const).
+
+      \param values The values of the variables (in the order given at
+      construction).
+      \return The partial derivative with respect to each variable.
+     */
+    std::vector<double> gradient(const std::vector<double>& values) const {
+      if (values.size() != _variables)
+	stator_throw() << "CompiledExpr expects " << _variables << " variable values, but was passed " << values.size();
+      std::vector<double> out(_variables);
+      gradient(values.data(), out.data());
+      return out;
+    }
+
+    /*! \brief The number of points evaluated together by \ref batch. */
+    static constexpr std::size_t batch_lanes = 512;
+
+    /*! \brief Evaluate the expression over many points.
+
+      The inputs are in structure-of-arrays form, i.e., one array of
+      n values for each variable. The points are processed in blocks
+      of \ref batch_lanes, and each instruction is run as an Eigen
+      array operation over the whole block. This amortizes the
+      instruction dispatch over the block and lets the arithmetic
+      (and, where Eigen supports it, the elementary functions) use
+      SIMD instructions.
+
+      A block holds a column per register, so the batch program
+      reuses the registers of values which are no longer needed (see
+      \ref batch_registers), and constants are loaded into a column
+      just before their first use.
+
+      \param inputs The arrays of values of each variable (in the order given at construction).
+      \param output The array the n results are written to.
+      \param n The number of points.
+     */
+    void batch(const double* const* inputs, double* output, std::size_t n) const {
+      typedef Eigen::Map<const Eigen::ArrayXd> Input;
+
+      _block.resize(batch_lanes, _batch_registers);
+
+      for (std::size_t start(0); start < n; start += batch_lanes) {
+	const Eigen::Index m = std::min(batch_lanes, n - start);
+	auto r = [&](std::uint32_t j) { return _block.col(j).head(m); };
+	auto load = [&](std::size_t step) {
+	  for (std::uint32_t k(_batch_load_offsets[step]); k < _batch_load_offsets[step + 1]; ++k)
+	    r(_batch_loads[k].first).setConstant(_batch_loads[k].second);
+	};
+
+	for (std::size_t j(0); j < _variables; ++j)
+	  r(j) = Input(inputs[j] + start, m);
+
+	for (std::size_t step(0); step < _batch_program.size(); ++step) {
+	  load(step);
+	  const detail::Instruction& i = _batch_program[step];
+	  switch (i.op) {
+	  case detail::OpCode::Sine:     r(i.dst) = r(i.a).sin(); break;
+	  case detail::OpCode::Cosine:   r(i.dst) = r(i.a).cos(); break;
+	  case detail::OpCode::Log:      r(i.dst) = r(i.a).log(); break;
+	  case detail::OpCode::Exp:      r(i.dst) = r(i.a).exp(); break;
+	  case detail::OpCode::Absolute: r(i.dst) = r(i.a).abs(); break;
+	  case detail::OpCode::Negate:   r(i.dst) = -r(i.a); break;
+	  case detail::OpCode::Add:      r(i.dst) = r(i.a) + r(i.b); break;
+	  case detail::OpCode::Subtract: r(i.dst) = r(i.a) - r(i.b); break;
+	  case detail::OpCode::Multiply: r(i.dst) = r(i.a) * r(i.b); break;
+	  case detail::OpCode::Divide:   r(i.dst) = r(i.a) / r(i.b); break;
+	  case detail::OpCode::Power:    r(i.dst) = r(i.a).pow(r(i.b)); break;
+	  }
+	}
+	load(_batch_program.size());
+
+	Eigen::Map<Eigen::ArrayXd>(output + start, m) = r(_batch_result);
+      }
+    }
+
+    /*! \brief Evaluate the expression over many points.
+
+      \param inputs The values of each variable (in the order given at construction), which must all be the same length.
+      \return The value of the expression at each point.
+     */
+    std::vector<double> batch(const std::vector<std::vector<double>>& inputs) const {
+      if (inputs.size() != _variables)
+	stator_throw() << "CompiledExpr expects " << _variables << " variable arrays, but was passed " << inputs.size();
+
+      const std::size_t n = inputs.empty() ? 1 : inputs[0].size();
+      std::vector<const double*> pointers;
+      for (const auto& in : inputs) {
+	if (in.size() != n)
+	  stator_throw() << "CompiledExpr batch inputs must all be the same length";
+	pointers.push_back(in.data());
+      }
+
+      std::vector<double> output(n);
+      batch(pointers.data(), output.data(), n);
+      return output;
+    }
+
+    /*! \brief The number of variables of the expression. */
+    std::size_t variables() const { return _variables; }
+
+    /*! \brief The number of registers used by the program. */
+    std::size_t registers() const { return _registers.size(); }
+
+    /*! \brief The number of registers (i.e., block columns) used by
+        \ref batch, which is the peak number of live values rather
+        than \ref registers. */
+    std::size_t batch_registers() const { return _batch_registers; }
+
+    /*! \brief The instructions of the program. */
+    const std::vector<detail::Instruction>& program() const { return _program; }
+
+    /*! \brief The constant registers of the program, as (register, value) pairs. */
+    const std::vector<std::pair<std::uint32_t, double>>& constants() const { return _constants; }
+
+    /*! \brief The register holding the result once the program has run. */
+    std::uint32_t result() const { return _result; }
+
+  private:
+    /*! \brief Builds the program used by \ref batch.
+
+      The program of the CompiledExpr writes every value to a fresh
+      register, as the reverse sweep of \ref gradient (and \ref
+      TaylorTape) needs them all. A batch block would then need a
+      column per operation, so this pass renames the registers of
+      the batch program, freeing each register after its last use
+      for the following instructions to reuse. The variables keep
+      their registers, and each constant is loaded into a free
+      register before its first use.
+     */
+    void allocate_batch_registers() {
+      const std::size_t none = _program.size() + 1;
+      //The instruction which last reads each register
+      std::vector<std::size_t> last_use(_registers.size(), none);
+      for (std::size_t step(0); step < _program.size(); ++step)
+	last_use[_program[step].a] = last_use[_program[step].b] = step;
+      //The result is read after the last instruction
+      last_use[_result] = _program.size();
+
+      std::vector<bool> constant(_registers.size(), false);
+      for (const auto& c : _constants)
+	constant[c.first] = true;
+
+      const std::uint32_t unassigned = std::uint32_t(-1);
+      std::vector<std::uint32_t> rename(_registers.size(), unassigned);
+      for (std::uint32_t j(0); j < _variables; ++j)
+	rename[j] = j;
+      std::vector<std::uint32_t> free_registers;
+      _batch_registers = _variables;
+      auto allocate = [&]() {
+	if (free_registers.empty())
+	  return std::uint32_t(_batch_registers++);
+	const std::uint32_t reg = free_registers.back();
+	free_registers.pop_back();
+	return reg;
+      };
+      auto operand = [&](std::uint32_t reg) {
+	if (rename[reg] == unassigned) {
+	  rename[reg] = allocate();
+	  _batch_loads.emplace_back(rename[reg], _registers[reg]);
+	}
+	return rename[reg];
+      };
+      auto release = [&](std::uint32_t reg, std::size_t step) {
+	if ((reg >= _variables) && (last_use[reg] == step))
+	  free_registers.push_back(rename[reg]);
+      };
+
+      _batch_program.reserve(_program.size());
+      for (std::size_t step(0); step < _program.size(); ++step) {
+	const detail::Instruction& i = _program[step];
+	_batch_load_offsets.push_back(std::uint32_t(_batch_loads.size()));
+	const std::uint32_t a = operand(i.a);
+	const std::uint32_t b = operand(i.b);
+	//Operands are released before the destination is allocated,
+	//as the operations are elementwise and may write in place
+	release(i.a, step);
+	if (i.b != i.a)
+	  release(i.b, step);
+	rename[i.dst] = allocate();
+	_batch_program.push_back(detail::Instruction{i.op, rename[i.dst], a, b});
+	if (last_use[i.dst] == none)
+	  free_registers.push_back(rename[i.dst]);
+      }
+      _batch_load_offsets.push_back(std::uint32_t(_batch_loads.size()));
+      _batch_result = operand(_result);
+      _batch_load_offsets.push_back(std::uint32_t(_batch_loads.size()));
+    }
+
+    std::size_t _variables;
+    std::uint32_t _result;
+    std::vector<detail::Instruction> _program;
+    std::vector<std::pair<std::uint32_t, double>> _constants;
+    mutable std::vector<double> _registers;
+    //Register adjoints of the reverse sweep
+    mutable std::vector<double> _adjoints;
+    //The program of the batch evaluation, with its registers reused
+    std::vector<detail::Instruction> _batch_program;
+    //The constants loaded before each batch instruction (and before
+    //the result is read), as (register, value) pairs. The loads of
+    //step i are [_batch_load_offsets[i], _batch_load_offsets[i+1]).
+    std::vector<std::pair<std::uint32_t, double>> _batch_loads;
+    std::vector<std::uint32_t> _batch_load_offsets;
+    std::uint32_t _batch_result;
+    std::size_t _batch_registers;
+    //Registers of the batch evaluation, one column per batch register
+    mutable Eigen::ArrayXXd _block;
+  };
+}
@@ -22,11 +22,20 @@
 namespace sym {
   template<typename T>
   class ConstantRT : public RTBaseHelper<ConstantRT<T> > {
-    ConstantRT(const T& v): _val(v) {}
+  protected:
+    ConstantRT(const T& v): _val(v) { RTBase::cache_hash(std::hash<T>{}(_val)); }
     
   public:
     static auto create(const T& val) {
-      return std::shared_ptr<ConstantRT>(new ConstantRT(val));
+      if constexpr (std::is_floating_point<T>::value)
+	//NaN and negative zero are not interned, as identity would
+	//then disagree with their comparison operators
+	if (interning() && (val == val) && !((val == 0) && std::signbit(val)))
+	  return detail::InternTable::get().lookup<ConstantRT>(detail::intern_key(detail::Type_index<ConstantRT>::value, val),
+							       [&](const ConstantRT& o) { return o._val == val; },
+							       [&]() { return detail::make_node<ConstantRT>(val); });
+
+      return detail::make_node<ConstantRT>(val);
     }
     
     template<typename T2>
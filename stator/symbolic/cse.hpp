@@ -0,0 +1,233 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stator/symbolic/runtime.hpp>
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sym {
+  namespace detail {
+    /*! \brief Rebuilds an operator node with each of its arguments
+        mapped through a function, reusing the node if the arguments
+        are unchanged. Other nodes are returned as they are. */
+    template<class F>
+    struct MapChildrenRT : VisitorHelper<MapChildrenRT<F>> {
+      MapChildrenRT(F& f): _f(f) {}
+
+      template<class T>
+      Expr apply(const T&) { return Expr(); }
+
+      template<typename Op>
+      Expr apply(const UnaryOp<Expr, Op>& op) {
+	Expr arg = _f(op._arg);
+	if (arg.get() == op._arg.get())
+	  return Expr();
+	return Expr(UnaryOp<Expr, Op>::create(arg));
+      }
+
+      template<typename Op>
+      Expr apply(const BinaryOp<Expr, Op, Expr>& op) {
+	Expr l = _f(op._l);
+	Expr r = _f(op._r);
+	if ((l.get() == op._l.get()) && (r.get() == op._r.get()))
+	  return Expr();
+	return Expr(BinaryOp<Expr, Op, Expr>::create(l, r));
+      }
+
+      //The terms keep their order, as the mapped terms need not be canonical
+      template<typename Op>
+      Expr apply(const NaryOp<Op>& op) {
+	std::vector<typename NaryOp<Op>::Term> terms;
+	terms.reserve(op._terms.size());
+	bool changed = false;
+	for (const auto& t : op._terms) {
+	  terms.emplace_back(_f(t.first), t.second);
+	  changed = changed || (terms.back().first.get() != t.first.get());
+	}
+	if (!changed)
+	  return Expr();
+	return Expr(NaryOp<Op>::create(op._constant, std::move(terms)));
+      }
+
+      F& _f;
+    };
+
+    template<class F>
+    Expr map_children(const Expr& e, F f) {
+      MapChildrenRT<F> visitor(f);
+      Expr result = e->visit(visitor);
+      return result ? result : e;
+    }
+
+    /*! \brief A letter-only suffix for the n-th symbol (a, b, ...,
+        z, ba, bb, ...), as the parser only accepts letters in
+        variable names. */
+    inline std::string cse_suffix(std::size_t n) {
+      std::string out(1, char('a' + n % 26));
+      for (n /= 26; n; n /= 26)
+	out.insert(out.begin(), char('a' + n % 26));
+      return out;
+    }
+
+    /*! \brief Tests if two nodes may be merged.
+
+      Operator nodes must have the same operand nodes, which are
+      already canonical, and constants the same bit pattern, as -0.0
+      == 0.0 but they are different divisors.
+    */
+    inline bool cse_equal(const RTBase& a, const RTBase& b) {
+      if (a._type_idx != b._type_idx)
+	return false;
+
+      if (a._type_idx == Type_index<ConstantRT<double>>::value) {
+	const double x = static_cast<const ConstantRT<double>&>(a).get();
+	const double y = static_cast<const ConstantRT<double>&>(b).get();
+	return std::memcmp(&x, &y, sizeof(double)) == 0;
+      }
+
+      OperandsRT af, bf;
+      const std::size_t count = a.visit(af);
+      if (!count)
+	return a.compare(Expr(b));
+      if ((count != b.visit(bf)) || (af._constant != bf._constant))
+	return false;
+      for (std::size_t i(0); i < count; ++i)
+	if ((&af.operand(i) != &bf.operand(i)) || (af._terms && (af._terms[i].second != bf._terms[i].second)))
+	  return false;
+      return true;
+    }
+
+    /*! \brief Implementation of \ref cse.
+
+      All maps are keyed by node address, and keep the key node
+      alive, so addresses cannot be reused while the pass runs. Each
+      pass walks the expression with \ref post_order, skipping nodes
+      already in its map, thus deep expressions do not recurse and
+      the results of a node's operands are in the map when it exits.
+    */
+    struct CSEPass {
+      /*! \brief Returns the canonical node structurally equal to e.
+
+	Children are made canonical first, thus two candidate nodes
+	are equal when they have the same type and the same child
+	nodes (see \ref cse_equal).
+      */
+      Expr canonical(const Expr& e) {
+	post_order(*e, [&](const RTBase& node) { return !_canonical.count(&node); }, [&](const RTBase& node, std::size_t) {
+	  const Expr n(node);
+	  Expr c = map_children(n, [&](const Expr& child) { return _canonical.find(child.get())->second.second; });
+
+	  auto range = _table.equal_range(c->hash());
+	  bool found = false;
+	  for (auto jt = range.first; jt != range.second; ++jt)
+	    if (cse_equal(*jt->second, *c)) {
+	      c = jt->second;
+	      found = true;
+	      break;
+	    }
+	  if (!found)
+	    _table.emplace(c->hash(), c);
+
+	  _canonical.emplace(&node, std::make_pair(n, c));
+	});
+	return _canonical.find(e.get())->second.second;
+      }
+
+      //! \brief Count the parents of each node of the canonical DAG.
+      void count(const Expr& e) {
+	post_order(*e, [&](const RTBase& node) { return !_uses[&node]++; }, [](const RTBase&, std::size_t) {});
+      }
+
+      //! \brief Replace nodes with more than one parent by symbols.
+      Expr reduce(const Expr& e) {
+	post_order(*e, [&](const RTBase& node) { return !_reduced.count(&node); }, [&](const RTBase& node, std::size_t) {
+	  Expr r = map_children(Expr(node), [&](const Expr& child) { return _reduced.find(child.get())->second; });
+	  const bool leaf = (node._type_idx == Type_index<ConstantRT<double>>::value) || (node._type_idx == Type_index<VarRT>::value);
+	  if (!leaf && (_uses[&node] > 1)) {
+	    Expr symbol(VarRT::create(_prefix + cse_suffix(_definitions.size())));
+	    _definitions.emplace_back(symbol, r);
+	    r = symbol;
+	  }
+
+	  _reduced.emplace(&node, r);
+	});
+	return _reduced.find(e.get())->second;
+      }
+
+      std::string _prefix;
+      std::unordered_map<const RTBase*, std::pair<Expr, Expr>> _canonical;
+      std::unordered_multimap<std::size_t, Expr> _table;
+      std::unordered_map<const RTBase*, std::size_t> _uses;
+      std::unordered_map<const RTBase*, Expr> _reduced;
+      std::vector<std::pair<Expr, Expr>> _definitions;
+    };
+  }
+
+  /*! \brief The result of common subexpression elimination (see \ref cse). */
+  struct CSEResult {
+    //! \brief The expression with every repeated subexpression held by a single, shared node.
+    Expr dag;
+    /*! \brief Definitions of the repeated subexpressions, as (symbol, value) pairs.
+
+      Values may refer to the symbols of earlier definitions, thus
+      evaluating them in order gives every symbol a value.
+     */
+    std::vector<std::pair<Expr, Expr>> definitions;
+    //! \brief The expression with the repeated subexpressions replaced by their symbols.
+    Expr reduced;
+  };
+
+  /*! \brief Common subexpression elimination.
+
+    Finds the structurally identical subexpressions of f (e.g., the
+    sin(x) repeated through the terms of a derivative) and merges
+    them into single nodes. Evaluators which work on nodes (such as
+    \ref CompiledExpr) then compute each repeated value only once.
+
+    \code{.cpp}
+    auto r = sym::cse(sym::Expr("sin(x)*y+exp(sin(x)*y)"));
+    //r.definitions = {csea=sin(x)*y}
+    //r.reduced = csea+exp(csea)
+    \endcode
+
+    Constants and variables are shared but never given a definition.
+    The elements of arrays and dictionaries are left untouched.
+
+    \param f The expression to process.
+    \param prefix The name prefix of the symbols of the definitions
+    (which are suffixed with a, b, c, ...). These must not clash
+    with the variables of f.
+   */
+  inline CSEResult cse(const Expr& f, const std::string& prefix = "cse") {
+    detail::CSEPass pass;
+    pass._prefix = prefix;
+    CSEResult result;
+    result.dag = pass.canonical(f);
+    pass.count(result.dag);
+    result.reduced = pass.reduce(result.dag);
+    result.definitions = std::move(pass._definitions);
+    return result;
+  }
+}
@@ -19,6 +19,9 @@
 
 #pragma once
 
+#include <stator/parallel.hpp>
+#include <vector>
+
 namespace sym {
 
   template<typename Key, typename Value>
@@ -83,9 +86,19 @@ namespace sym {
   auto simplify(const Dict<Key, Value>& in) {
     auto out_ptr = Dict<decltype(store(simplify(in.begin()->first))), decltype(store(simplify(in.begin()->second)))>::create();
     auto& out = sym::detail::unwrap(out_ptr);
-    
+
+    //The values are simplified in parallel when enabled (see
+    //stator::set_parallelism), then inserted in the original order
+    std::vector<const typename Dict<Key, Value>::const_iterator::value_type*> items;
+    items.reserve(in.size());
     for (const auto& p : in)
-      out[p.first] = simplify(p.second);
+      items.push_back(&p);
+
+    std::vector<decltype(store(simplify(in.begin()->second)))> values(items.size());
+    stator::parallel_for(items.size(), [&](std::size_t i) { values[i] = simplify(items[i]->second); });
+
+    for (std::size_t i(0); i < items.size(); ++i)
+      out[items[i]->first] = values[i];
     return out_ptr;
   }
 
@@ -26,16 +26,17 @@ namespace sym {
 
   template<>
   class Dict<Expr, Expr>: public RTBaseHelper<DictRT>, public DictBase<Expr, Expr> {
+    protected:
       typedef DictBase<Expr, Expr> Base;
 
       Dict() {}
 
       public:
 
-      typedef std::shared_ptr<Dict> DictPtr;
+      typedef NodePtr<Dict> DictPtr;
 
       static auto create() {
-        return DictPtr(new Dict());
+        return detail::make_node<Dict>();
       }
 
       using Base::operator==;
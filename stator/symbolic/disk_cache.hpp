@@ -0,0 +1,294 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stator/symbolic/serialize.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sym {
+  /*! \brief A persistent cache of the results of symbolic operations,
+      held in a directory so that it survives between processes.
+
+    Results are keyed by the structural hash of the expression, the
+    name of the operation, and its arguments, and are stored in the
+    binary \ref ExprImage format. The expression and arguments are
+    stored with the result and compared on lookup, so hash collisions
+    (or a standard library with different hashes) only cause misses.
+
+    The directory is limited in total size and in the number of
+    entries, and the least recently used entries are evicted when
+    either limit is exceeded. Use is tracked through the modification
+    time of the files, so the order carries over between processes.
+    Entries are written to a temporary file and renamed into place,
+    thus several processes may share a directory (although each only
+    accounts for the entries it has seen when enforcing the limits).
+
+    Nothing is cached unless a DiskCache is used explicitly:
+    \code{.cpp}
+    sym::DiskCache cache("model_cache");
+    sym::Expr g = cache.simplify(f);        //As sym::simplify(f)
+    sym::Expr d = cache.derivative(f, x);   //As sym::derivative(f, x)
+    sym::Expr h = cache.apply("my_op", f, {}, [&]{ return my_op(f); });
+    \endcode
+
+    A cache may be used from multiple threads.
+  */
+  class DiskCache {
+  public:
+    struct Stats {
+      std::size_t hits;
+      std::size_t misses;
+      std::size_t stores;
+      std::size_t evictions;
+    };
+
+    static const char* extension() { return ".sexpr"; }
+
+    /*! \brief Open (or create) a cache directory.
+
+      \param max_bytes The maximum total size of the entries.
+      \param max_entries The maximum number of entries.
+    */
+    explicit DiskCache(const std::string& directory, std::uintmax_t max_bytes = std::uintmax_t(256) << 20, std::size_t max_entries = 100000):
+      _directory(directory), _max_bytes(max_bytes), _max_entries(max_entries), _stats{0, 0, 0, 0}, _bytes(0)
+    {
+      std::error_code ec;
+      std::filesystem::create_directories(_directory, ec);
+      if (!std::filesystem::is_directory(_directory))
+	stator_throw() << "Could not create the cache directory " << directory;
+
+      for (const auto& file : std::filesystem::directory_iterator(_directory, ec)) {
+	if (!file.is_regular_file(ec) || (file.path().extension() != extension()))
+	  continue;
+	const Entry e{file.file_size(ec), file.last_write_time(ec)};
+	if (!ec) {
+	  _entries.emplace(file.path().filename().string(), e);
+	  _bytes += e.size;
+	}
+      }
+
+      std::lock_guard<std::mutex> lock(_mutex);
+      evict();
+    }
+
+    /*! \brief The result of an operation, computing and storing it
+        on a miss.
+
+      \param operation The name of the operation, which may only
+      contain letters, digits, and underscores.
+      \param f The expression the operation applies to.
+      \param args Any further arguments of the operation.
+      \param compute Returns the result (as an Expr) on a miss.
+    */
+    template<class F>
+    Expr apply(const std::string& operation, const Expr& f, const std::vector<Expr>& args, F compute) {
+      if (operation.empty() || !std::all_of(operation.begin(), operation.end(), [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || (c == '_'); }))
+	stator_throw() << "Invalid cached operation name \"" << operation << "\"";
+
+      std::size_t key = std::hash<std::string>{}(operation);
+      stator::hash_combine(key, f);
+      for (const Expr& a : args)
+	stator::hash_combine(key, a);
+      std::ostringstream name;
+      name << operation << "-" << std::hex << std::setw(16) << std::setfill('0') << std::uint64_t(key) << extension();
+
+      Expr result = lookup(name.str(), f, args);
+      if (result)
+	return result;
+
+      result = compute();
+      store(name.str(), f, args, result);
+      return result;
+    }
+
+    //! \brief A cached \ref sym::simplify.
+    Expr simplify(const Expr& f) {
+      return apply("simplify", f, {}, [&]() { return sym::simplify(f); });
+    }
+
+    //! \brief A cached \ref sym::derivative.
+    Expr derivative(const Expr& f, const Expr& x) {
+      return apply("derivative", f, {x}, [&]() { return sym::derivative(f, x); });
+    }
+
+    //! \brief The total size of the entries, in bytes.
+    std::uintmax_t bytes() const {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _bytes;
+    }
+
+    //! \brief The number of entries.
+    std::size_t size() const {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _entries.size();
+    }
+
+    Stats stats() const {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _stats;
+    }
+
+    //! \brief Remove every entry.
+    void clear() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      std::error_code ec;
+      for (const auto& e : _entries)
+	std::filesystem::remove(_directory / e.first, ec);
+      _entries.clear();
+      _bytes = 0;
+    }
+
+  private:
+    struct Entry {
+      std::uintmax_t size;
+      std::filesystem::file_time_type used;
+    };
+
+    Expr lookup(const std::string& name, const Expr& f, const std::vector<Expr>& args) {
+      const std::filesystem::path path = _directory / name;
+      Expr record;
+      try {
+	record = load(path.string());
+      } catch (const stator::Exception&) {
+	//Missing or unreadable (e.g., from another version) entries are misses
+      }
+
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (record && valid(record, f, args)) {
+	++_stats.hits;
+	//Mark the entry as recently used
+	std::error_code ec;
+	const auto now = std::filesystem::file_time_type::clock::now();
+	std::filesystem::last_write_time(path, now, ec);
+	auto it = _entries.find(name);
+	if (it != _entries.end())
+	  it->second.used = now;
+	return record.as<ArrayRT>().getStore().back();
+      }
+
+      ++_stats.misses;
+      return Expr();
+    }
+
+    static bool valid(const Expr& record, const Expr& f, const std::vector<Expr>& args) {
+      if (record->_type_idx != detail::Type_index<ArrayRT>::value)
+	return false;
+      const auto& entry = record.as<ArrayRT>().getStore();
+      if ((entry.size() != args.size() + 2) || !entry.back() || !(entry[0] == f))
+	return false;
+      for (std::size_t i(0); i < args.size(); ++i)
+	if (!(entry[i + 1] == args[i]))
+	  return false;
+      return true;
+    }
+
+    void store(const std::string& name, const Expr& f, const std::vector<Expr>& args, const Expr& result) {
+      //The record holds the key, so collisions are detected
+      auto record_ptr = ArrayRT::create(args.size() + 2);
+      auto& record = *record_ptr;
+      record[0] = f;
+      for (std::size_t i(0); i < args.size(); ++i)
+	record[i + 1] = args[i];
+      record[args.size() + 1] = result;
+      const std::string bytes = serialize(Expr(record_ptr));
+      if (bytes.size() > _max_bytes)
+	return;
+
+      const std::filesystem::path path = _directory / name;
+      std::filesystem::path temp = path;
+      temp += ".tmp" + std::to_string(process_id()) + "." + std::to_string(_next_temp++);
+      {
+	std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+	out.write(bytes.data(), std::streamsize(bytes.size()));
+	if (!out)
+	  return;
+      }
+      std::error_code ec;
+      std::filesystem::rename(temp, path, ec);
+      if (ec) {
+	std::filesystem::remove(temp, ec);
+	return;
+      }
+
+      std::lock_guard<std::mutex> lock(_mutex);
+      ++_stats.stores;
+      const Entry e{bytes.size(), std::filesystem::last_write_time(path, ec)};
+      auto it = _entries.find(name);
+      if (it != _entries.end()) {
+	_bytes -= it->second.size;
+	it->second = e;
+      } else
+	_entries.emplace(name, e);
+      _bytes += e.size;
+      evict();
+    }
+
+    //! \brief Remove the least recently used entries until within the limits.
+    void evict() {
+      if ((_bytes <= _max_bytes) && (_entries.size() <= _max_entries))
+	return;
+
+      std::vector<std::pair<std::filesystem::file_time_type, std::string>> order;
+      order.reserve(_entries.size());
+      for (const auto& e : _entries)
+	order.emplace_back(e.second.used, e.first);
+      std::sort(order.begin(), order.end());
+
+      std::error_code ec;
+      for (const auto& o : order) {
+	if ((_bytes <= _max_bytes) && (_entries.size() <= _max_entries))
+	  break;
+	std::filesystem::remove(_directory / o.second, ec);
+	auto it = _entries.find(o.second);
+	_bytes -= it->second.size;
+	_entries.erase(it);
+	++_stats.evictions;
+      }
+    }
+
+    //! \brief Distinguishes the temporary files of different processes.
+    static std::uint64_t process_id() {
+      static const std::uint64_t id = (std::uint64_t(std::random_device{}()) << 32) | std::random_device{}();
+      return id;
+    }
+
+    const std::filesystem::path _directory;
+    const std::uintmax_t _max_bytes;
+    const std::size_t _max_entries;
+    mutable std::mutex _mutex;
+    Stats _stats;
+    std::uintmax_t _bytes;
+    std::unordered_map<std::string, Entry> _entries;
+    std::atomic<std::uint64_t> _next_temp{0};
+  };
+}
@@ -0,0 +1,177 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stator/hash.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+namespace sym {
+  namespace detail {
+    /*! \brief The unique table used to hash-cons (intern) runtime
+        expression nodes.
+
+      When interning is enabled, the create() factories of the
+      immutable runtime types (constants, variables, and the unary
+      and binary operators) look up an existing node with the same
+      type and the same children before allocating a new one. As
+      the children of an interned node are themselves interned,
+      structurally equal expressions are then held by a single node,
+      and equality of two interned nodes is a pointer comparison.
+
+      Nodes are keyed on their type index and the identity (address)
+      of their children, so looking up a node never walks the
+      expression tree. The table does not hold references, thus it
+      never extends the lifetime of an expression, and a node removes
+      itself from the table when its last reference is dropped.
+
+      The mutable container types (ArrayRT and DictRT) are never
+      interned, and neither is any node which holds one.
+    */
+    class InternTable {
+    public:
+      static InternTable& get() {
+	//Never destroyed, as nodes held in static variables may be
+	//released after it would be
+	static InternTable* instance = new InternTable();
+	return *instance;
+      }
+
+      bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+      void enable(bool on) { _enabled.store(on, std::memory_order_relaxed); }
+
+      /*! \brief Returns an existing interned node of type T, or
+          interns the node returned by make().
+
+	\param key The hash of the node type and its child identities.
+	\param match Callable returning true if a candidate node of type T is equivalent.
+	\param make Callable returning a newly allocated node (as a NodePtr<T>).
+       */
+      template<class T, class Match, class Make>
+      NodePtr<T> lookup(std::size_t key, Match match, Make make) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto range = _table.equal_range(key);
+	for (auto it = range.first; it != range.second; ++it) {
+	  //Nodes whose count has dropped to zero are being destroyed,
+	  //and wait on the mutex to remove themselves
+	  const RTBase* candidate = it->second;
+	  if ((candidate->_type_idx == Type_index<T>::value) && match(static_cast<const T&>(*candidate)) && candidate->_refs.acquire_if_alive())
+	    return NodePtr<T>(const_cast<T*>(static_cast<const T*>(candidate)), false);
+	}
+
+	NodePtr<T> node = make();
+	node->_interned = true;
+	node->_intern_key = key;
+	node->_intern_generation = _generation.load(std::memory_order_relaxed);
+	_table.emplace(key, node.get());
+	return node;
+      }
+
+      /*! \brief Remove a node, whose last reference has been
+          dropped, from the table. */
+      void erase(const RTBase* node) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto range = _table.equal_range(node->_intern_key);
+	for (auto it = range.first; it != range.second; ++it)
+	  if (it->second == node) {
+	    _table.erase(it);
+	    return;
+	  }
+      }
+
+      /*! \brief The number of live interned nodes. */
+      std::size_t size() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _table.size();
+      }
+
+      /*! \brief Forget all interned nodes.
+
+	This starts a new generation of the table. Existing nodes
+	remain valid, but new nodes are no longer shared with them,
+	so equality between nodes of different generations is tested
+	structurally rather than by identity. Nodes are only interned
+	if their children are of the current generation.
+
+	It should not be called while other threads are creating
+	nodes.
+       */
+      void clear() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_table.clear();
+	_generation.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      //! \brief Test if a node is interned in the current generation.
+      bool current(const RTBase& node) const {
+	return node._interned && (node._intern_generation == _generation.load(std::memory_order_relaxed));
+      }
+
+    private:
+      InternTable(): _enabled(false) {}
+
+      std::mutex _mutex;
+      std::unordered_multimap<std::size_t, const RTBase*> _table;
+      std::atomic<bool> _enabled;
+      std::atomic<std::uint32_t> _generation{0};
+    };
+
+    /*! \brief Hash key for interned nodes built from a type index and
+        the node's identifying values (the addresses of its children,
+        a constant's value, or a variable's name). */
+    template<class ...Keys>
+    std::size_t intern_key(int type_idx, const Keys& ...keys) {
+      std::size_t seed = type_idx;
+      (stator::hash_combine(seed, keys), ...);
+      return seed;
+    }
+  }
+
+  /*! \brief Enable (or disable) hash-consing of runtime expression nodes.
+
+    Interning is off by default. While it is on, structurally
+    identical expressions built from the create() factories (which
+    includes parsing, simplification and substitution) share a
+    single node. This reduces memory use for large generated
+    expressions and makes equality checks between them a pointer
+    comparison. The mode may be toggled at any time, nodes created
+    while it is disabled are simply not shared.
+   */
+  inline void set_interning(bool on) { detail::InternTable::get().enable(on); }
+
+  /*! \brief Test if hash-consing of runtime nodes is enabled. */
+  inline bool interning() { return detail::InternTable::get().enabled(); }
+
+  /*! \brief RAII helper to enable (or disable) interning for a scope. */
+  class InterningScope {
+  public:
+    InterningScope(bool on = true): _previous(interning()) { set_interning(on); }
+    ~InterningScope() { set_interning(_previous); }
+
+    InterningScope(const InterningScope&) = delete;
+    InterningScope& operator=(const InterningScope&) = delete;
+  private:
+    bool _previous;
+  };
+}
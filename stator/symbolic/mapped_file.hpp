@@ -0,0 +1,92 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stator/exception.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# define STATOR_HAVE_MMAP
+#endif
+
+namespace sym {
+  /*! \brief A read-only file mapped into memory (or, where mmap is
+      unavailable, read into memory), e.g., to view an \ref
+      ExprImage or parse a file of records without copying it.
+  */
+  class MappedFile {
+  public:
+    explicit MappedFile(const std::string& filename) {
+#ifdef STATOR_HAVE_MMAP
+      const int fd = ::open(filename.c_str(), O_RDONLY);
+      if (fd < 0)
+	stator_throw() << "Could not open " << filename;
+      struct stat st;
+      if (::fstat(fd, &st)) {
+	::close(fd);
+	stator_throw() << "Could not stat " << filename;
+      }
+      _size = std::size_t(st.st_size);
+      if (_size) {
+	void* p = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED)
+	  stator_throw() << "Could not map " << filename;
+	_data = static_cast<const char*>(p);
+      } else
+	::close(fd);
+#else
+      std::ifstream in(filename, std::ios::binary);
+      if (!in)
+	stator_throw() << "Could not open " << filename;
+      _buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+      _data = _buffer.data();
+      _size = _buffer.size();
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef STATOR_HAVE_MMAP
+      if (_data)
+	::munmap(const_cast<char*>(_data), _size);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view bytes() const { return std::string_view(_data, _size); }
+
+  private:
+    const char* _data = nullptr;
+    std::size_t _size = 0;
+#ifndef STATOR_HAVE_MMAP
+    std::string _buffer;
+#endif
+  };
+}
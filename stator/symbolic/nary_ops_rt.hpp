@@ -0,0 +1,400 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sym {
+  /*! \brief A flattened runtime sum or product of any number of
+      terms.
+
+    A \ref SumRT (NaryOp<detail::Add>) holds c + a1*t1 + a2*t2 + ...
+    and a \ref ProductRT (NaryOp<detail::Multiply>) holds c * t1^a1 *
+    t2^a2 * ..., where c is the numeric constant and each term ti has
+    a numeric coefficient (or integer exponent) ai. Non-integer
+    powers are factors of their own, Power nodes with an exponent
+    of one.
+
+    Nodes are only built in canonical form, through \ref
+    detail::NaryBuilder (e.g., by \ref flatten). Like terms are
+    merged (unless that would change the value, see \ref
+    detail::NaryBuilder), terms are never constants or nodes of the
+    same kind, and the terms are sorted by their hash. Equal sums (or products)
+    therefore have equal nodes and hashes whatever order their terms
+    were written in, and a sum of n terms is one node rather than a
+    chain of n-1 BinaryOp nodes.
+  */
+  template<typename Op>
+  struct NaryOp : public RTBaseHelper<NaryOp<Op> >, public Dynamic {
+    //! \brief A term and its coefficient (for sums) or exponent (for products).
+    typedef std::pair<Expr, double> Term;
+
+  protected:
+    NaryOp(double constant, std::vector<Term> terms): _constant(constant), _terms(std::move(terms)) {
+      if (std::all_of(_terms.begin(), _terms.end(), [](const Term& t) { return t.first->_hash_cached; }))
+	RTBase::cache_hash(std::hash<NaryOp>{}(*this));
+    }
+    NaryOp(const NaryOp& e) = default;
+
+  public:
+    ~NaryOp() {
+      //Deep expressions are destroyed without recursion
+      for (Term& t : _terms)
+	detail::release_operand(t.first);
+    }
+
+    /*! \brief Create a node from terms which are already in
+        canonical form (see \ref detail::NaryBuilder). */
+    static auto create(double constant, std::vector<Term> terms) {
+      if (interning() && std::all_of(terms.begin(), terms.end(), [](const Term& t) { return detail::InternTable::get().current(*t.first); })) {
+	std::size_t key = detail::intern_key(detail::Type_index<NaryOp>::value, constant);
+	for (const Term& t : terms) {
+	  stator::hash_combine(key, t.first.get());
+	  stator::hash_combine(key, t.second);
+	}
+
+	return detail::InternTable::get().lookup<NaryOp>(key,
+							 [&](const NaryOp& o) {
+							   return (o._constant == constant) && std::equal(o._terms.begin(), o._terms.end(), terms.begin(), terms.end(),
+													  [](const Term& a, const Term& b) { return (a.first.get() == b.first.get()) && (a.second == b.second); });
+							 },
+							 [&]() { return detail::make_node<NaryOp>(constant, std::move(terms)); });
+      }
+
+      return detail::make_node<NaryOp>(constant, std::move(terms));
+    }
+
+    bool operator==(const NaryOp& o) const {
+      return (this == &o) || detail::equal_operands(*this, o);
+    }
+
+    double _constant;
+    std::vector<Term> _terms;
+  };
+
+  typedef NaryOp<detail::Add> SumRT;
+  typedef NaryOp<detail::Multiply> ProductRT;
+
+  namespace detail {
+    template<> struct Type_index<SumRT> { static const int value = 20; };
+    template<> struct Type_index<ProductRT> { static const int value = 21; };
+
+    /*! \brief Accumulates terms into the canonical form of a \ref
+        NaryOp.
+
+      Nested nodes of the same kind are merged into the result, and
+      \ref finish sorts the terms and merges the like ones. Products
+      only distribute integer exponents over their factors, and only
+      through integer powers (as (x^2)^(1/2) is |x|, and (x^(1/2))^2
+      is NaN for x < 0, not x).
+
+      By default, the result has the same value as the terms
+      wherever they are defined. Like factors are only merged if
+      their exponents have the same sign, as x/x is NaN at x=0, not
+      1, terms whose coefficients cancel are kept (with a zero
+      coefficient), as ln(x)-ln(x) is NaN for x < 0, and a zero
+      constant does not absorb the factors of a product. If cancel
+      is set (as in \ref simplify), these are all cancelled.
+    */
+    template<typename Op>
+    class NaryBuilder {
+    public:
+      typedef typename NaryOp<Op>::Term Term;
+      static constexpr bool is_sum = std::is_same<Op, Add>::value;
+
+      explicit NaryBuilder(bool cancel = false): _constant(is_sum ? 0 : 1), _cancel(cancel), _cancelled(false) {}
+
+      //! \brief Add a*e to a sum, or multiply a product by e^a.
+      void add(const Expr& e, double a = 1) {
+	const int idx = e->_type_idx;
+	if (idx == Type_index<ConstantRT<double> >::value) {
+	  const double v = static_cast<const ConstantRT<double>&>(*e).get();
+	  if constexpr (is_sum)
+	    _constant += a * v;
+	  else
+	    _constant *= (a == 1) ? v : std::pow(v, a);
+	  return;
+	}
+
+	//Non-integer powers are held as Power nodes, so the factors
+	//of a product are never products themselves
+	if (!is_sum && !is_integer(a))
+	  return add(Expr(BinaryOp<Expr, Power, Expr>::create(e, Expr(a))), 1);
+
+	if (idx == Type_index<NaryOp<Op> >::value) {
+	  const NaryOp<Op>& n = static_cast<const NaryOp<Op>&>(*e);
+	  if constexpr (is_sum)
+	    _constant += a * n._constant;
+	  else
+	    _constant *= std::pow(n._constant, a);
+	  for (const Term& t : n._terms)
+	    _terms.emplace_back(t.first, a * t.second);
+	  return;
+	}
+
+	if (idx == Type_index<UnaryOp<Expr, Negate> >::value) {
+	  const Expr& arg = static_cast<const UnaryOp<Expr, Negate>&>(*e)._arg;
+	  if constexpr (is_sum)
+	    return add(arg, -a);
+	  else {
+	    _constant *= std::pow(-1.0, a);
+	    return add(arg, a);
+	  }
+	}
+
+	if constexpr (is_sum) {
+	  //Numeric factors of products become the coefficient of the term
+	  if (idx == Type_index<ProductRT>::value) {
+	    const ProductRT& p = static_cast<const ProductRT&>(*e);
+	    if (p._constant != 1) {
+	      _terms.emplace_back(unit_product(p), a * p._constant);
+	      return;
+	    }
+	  }
+	} else {
+	  if (idx == Type_index<BinaryOp<Expr, Power, Expr> >::value) {
+	    const auto& p = static_cast<const BinaryOp<Expr, Power, Expr>&>(*e);
+	    if ((p._r->_type_idx == Type_index<ConstantRT<double> >::value) && is_integer(static_cast<const ConstantRT<double>&>(*p._r).get()))
+	      return add(p._l, a * static_cast<const ConstantRT<double>&>(*p._r).get());
+	  }
+	}
+
+	_terms.emplace_back(e, a);
+      }
+
+      //! \brief The canonical expression of the accumulated terms.
+      Expr finish() {
+	std::sort(_terms.begin(), _terms.end(), [](const Term& a, const Term& b) {
+	  const std::size_t ha = a.first->hash(), hb = b.first->hash();
+	  if (ha != hb)
+	    return ha < hb;
+	  //Unequal terms with the same hash are rare, and ordered by their representation
+	  return !(a.first == b.first) && (repr(a.first) < repr(b.first));
+	});
+
+	//Merge the runs of like terms
+	std::size_t out = 0;
+	for (std::size_t i(0); i < _terms.size();) {
+	  std::size_t j = i + 1;
+	  while ((j < _terms.size()) && (_terms[j].first->hash() == _terms[i].first->hash()) && (_terms[j].first == _terms[i].first))
+	    ++j;
+	  double positive = 0, negative = 0;
+	  for (std::size_t k(i); k < j; ++k)
+	    ((_terms[k].second > 0) ? positive : negative) += _terms[k].second;
+
+	  Expr term = std::move(_terms[i].first);
+	  if (is_sum || _cancel) {
+	    const double a = positive + negative;
+	    _cancelled = _cancelled || (_cancel && (is_sum ? (a == 0) : (positive && negative)));
+	    if ((a != 0) || (is_sum && !_cancel))
+	      _terms[out++] = Term(std::move(term), a);
+	  } else {
+	    if (positive)
+	      _terms[out++] = Term(term, positive);
+	    if (negative)
+	      _terms[out++] = Term(std::move(term), negative);
+	  }
+	  i = j;
+	}
+	_terms.resize(out);
+
+	if constexpr (is_sum) {
+	  if (_terms.empty())
+	    return Expr(_constant);
+
+	  //A single scaled term is a product
+	  if ((_constant == 0) && (_terms.size() == 1)) {
+	    if (_terms[0].second == 1)
+	      return _terms[0].first;
+	    NaryBuilder<Multiply> product(_cancel);
+	    product.add(Expr(_terms[0].second));
+	    product.add(_terms[0].first);
+	    return product.finish();
+	  }
+
+	  return Expr(SumRT::create(_constant, std::move(_terms)));
+	} else {
+	  if (_terms.empty())
+	    return Expr(_constant);
+
+	  if ((_constant == 0) && _cancel) {
+	    _cancelled = true;
+	    return Expr(_constant);
+	  }
+
+	  if ((_constant == 1) && (_terms.size() == 1) && (_terms[0].second == 1))
+	    return _terms[0].first;
+
+	  return Expr(ProductRT::create(_constant, std::move(_terms)));
+	}
+      }
+
+      /*! \brief Test if \ref finish cancelled any terms (only if
+          cancel is set), so the result may differ from a node built
+          from the same terms without cancelling. */
+      bool cancelled() const { return _cancelled; }
+
+    private:
+      static bool is_integer(double a) { return a == std::floor(a); }
+
+      //! \brief The product p without its numeric constant.
+      static Expr unit_product(const ProductRT& p) {
+	if ((p._terms.size() == 1) && (p._terms[0].second == 1))
+	  return p._terms[0].first;
+	return Expr(ProductRT::create(1, p._terms));
+      }
+
+      double _constant;
+      std::vector<Term> _terms;
+      const bool _cancel;
+      bool _cancelled;
+    };
+  }
+
+  /*! \brief Returns the binding powers of a flattened sum or
+      product, which are those of the operator it is printed with.
+  */
+  template<typename Op>
+  std::pair<int, int> BP(const NaryOp<Op>& v) {
+    if constexpr (std::is_same<Op, detail::Multiply>::value) {
+      if (v._constant < 0)
+	return std::make_pair(0, detail::Negate::BP);
+      if ((v._constant == 1) && (v._terms.size() == 1) && (v._terms[0].second > 0))
+	return std::make_pair(detail::Power::leftBindingPower, detail::RBP<detail::Power>());
+    }
+    return std::make_pair(Op::leftBindingPower, detail::RBP<Op>());
+  }
+
+  namespace detail {
+    /*! \brief String representation of a flattened sum, given the
+        representations of its terms.
+
+      Terms are printed in their canonical order, followed by the
+      constant.
+    */
+    template<class Config>
+    std::string repr_nary(const SumRT& op, std::string* terms) {
+      std::string out;
+      for (std::size_t i(0); i < op._terms.size(); ++i) {
+	const double a = op._terms[i].second;
+	std::string term = std::move(terms[i]);
+	if (std::abs(a) != 1) {
+	  //Products in sums always have a unit constant, so can be extended by the coefficient
+	  const bool product = op._terms[i].first->_type_idx == Type_index<ProductRT>::value;
+	  if ((!product && (BP(op._terms[i].first).first < RBP<Multiply>())) || Config::Force_parenthesis)
+	    term = paren_wrap<Config>(std::move(term));
+	  term = repr<Config>(std::abs(a)) + (Config::Latex_output ? Multiply::latex_repr() : Multiply::repr()) + term;
+	} else if ((BP(op._terms[i].first).first < RBP<Add>()) || Config::Force_parenthesis)
+	  term = paren_wrap<Config>(std::move(term));
+
+	if (a < 0)
+	  out += i ? (Config::Latex_output ? Subtract::latex_repr() : Subtract::repr()) : (Config::Latex_output ? Negate::l_latex_repr() : Negate::l_repr());
+	else if (i)
+	  out += Config::Latex_output ? Add::latex_repr() : Add::repr();
+	out += term;
+      }
+
+      if (op._constant != 0) {
+	out += (op._constant < 0) ? (Config::Latex_output ? Subtract::latex_repr() : Subtract::repr()) : (Config::Latex_output ? Add::latex_repr() : Add::repr());
+	out += repr<Config>(std::abs(op._constant));
+      }
+      return out;
+    }
+
+    /*! \brief String representation of a flattened product, given
+        the representations of its terms.
+
+      Factors with negative exponents are printed as divisors, so
+      the output parses back into an equivalent expression.
+    */
+    template<class Config>
+    std::string repr_nary(const ProductRT& op, std::string* terms) {
+      const std::string times = Config::Latex_output ? Multiply::latex_repr() : Multiply::repr();
+      std::string numerator, denominator;
+      for (std::size_t i(0); i < op._terms.size(); ++i) {
+	const double a = op._terms[i].second;
+	std::string factor = std::move(terms[i]);
+	const auto factor_BP = BP(op._terms[i].first);
+	if (std::abs(a) != 1) {
+	  //Power is right associative, so powers are wrapped too
+	  if ((factor_BP.second <= Power::leftBindingPower) || Config::Force_parenthesis)
+	    factor = paren_wrap<Config>(std::move(factor));
+	  factor += Config::Latex_output ? Power::latex_repr() : Power::repr();
+	  factor += repr<Config>(std::abs(a));
+	  factor += Config::Latex_output ? Power::r_latex_repr() : Power::r_repr();
+	} else if ((factor_BP.first < RBP<Multiply>()) || (factor_BP.second < Multiply::leftBindingPower) || Config::Force_parenthesis)
+	  factor = paren_wrap<Config>(std::move(factor));
+
+	std::string& side = (a > 0) ? numerator : denominator;
+	if (!side.empty())
+	  side += (a > 0) || Config::Latex_output ? times : Divide::repr();
+	side += factor;
+      }
+
+      std::string out;
+      if (numerator.empty())
+	out = repr<Config>(op._constant);
+      else if (op._constant == -1)
+	out = (Config::Latex_output ? Negate::l_latex_repr() : Negate::l_repr()) + numerator;
+      else if (op._constant != 1)
+	out = repr<Config>(op._constant) + times + numerator;
+      else
+	out = std::move(numerator);
+
+      if (!denominator.empty()) {
+	if (Config::Latex_output)
+	  return Divide::l_latex_repr() + out + Divide::latex_repr() + denominator + Divide::r_latex_repr();
+	out += Divide::repr() + denominator;
+      }
+      return out;
+    }
+  }
+
+  /*! \brief String representation of a flattened sum or product.
+   */
+  template<class Config = DefaultReprConfig, typename Op>
+  std::string repr(const NaryOp<Op>& op) {
+    std::vector<std::string> terms;
+    for (const auto& t : op._terms)
+      terms.push_back(repr<Config>(t.first));
+    return detail::repr_nary<Config>(op, terms.data());
+  }
+}
+
+namespace std
+{
+  template<typename Op> struct hash<sym::NaryOp<Op> >
+  {
+    std::size_t operator()(sym::NaryOp<Op> const& v) const noexcept
+    {
+      std::size_t seed = sym::detail::Type_index<sym::NaryOp<Op> >::value;
+      stator::hash_combine(seed, v._constant);
+      for (const auto& t : v._terms) {
+	stator::hash_combine(seed, std::hash<sym::Expr>{}(t.first));
+	stator::hash_combine(seed, t.second);
+      }
+      return seed;
+    }
+  };
+}
@@ -0,0 +1,279 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stator/symbolic/compiled.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+namespace sym {
+  namespace detail {
+    inline std::string getenv_or(const char* name, const std::string& fallback) {
+      const char* value = std::getenv(name);
+      return (value && *value) ? std::string(value) : fallback;
+    }
+
+    /*! \brief The default directory for the \ref NativeExpr cache.
+
+      This is $STATOR_CACHE_DIR if set, otherwise the stator
+      directory in the user's cache ($XDG_CACHE_HOME or ~/.cache),
+      falling back to the system temporary directory.
+    */
+    inline std::string native_cache_dir() {
+      std::string dir = getenv_or("STATOR_CACHE_DIR", "");
+      if (!dir.empty())
+	return dir;
+
+      dir = getenv_or("XDG_CACHE_HOME", "");
+      if (!dir.empty())
+	return dir + "/stator";
+
+      dir = getenv_or("HOME", "");
+      if (!dir.empty())
+	return dir + "/.cache/stator";
+
+      return (std::filesystem::temp_directory_path() / "stator").string();
+    }
+
+    /*! \brief A C literal for a double constant.
+
+      Finite values are written as hexadecimal floating literals,
+      which are exact and always floating point (a decimal "-0"
+      would be the integer zero, losing the sign of -0.0).
+    */
+    inline std::string c_literal(double v) {
+      if (std::isnan(v))
+	return "NAN";
+      if (std::isinf(v))
+	return (v < 0) ? "-INFINITY" : "INFINITY";
+      char buffer[32];
+      std::snprintf(buffer, sizeof(buffer), "%a", v);
+      return buffer;
+    }
+
+    inline std::string read_file(const std::string& path) {
+      std::ifstream in(path, std::ios::binary);
+      return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+  }
+
+  /*! \brief Generate the C source of a compiled expression.
+
+    The program of the CompiledExpr is written out one statement per
+    instruction, as a function taking the array of variable values
+    (in slot order) and returning the value of the expression.
+
+    \param f The compiled expression.
+    \param name The name of the generated function.
+   */
+  inline std::string ccode(const CompiledExpr& f, const std::string& name = "stator_expr") {
+    std::ostringstream os;
+    os << "#include <math.h>\n\n"
+       << "double " << name << "(const double* x) {\n";
+
+    for (std::size_t j(0); j < f.variables(); ++j)
+      os << "  const double r" << j << " = x[" << j << "];\n";
+
+    for (const auto& c : f.constants())
+      os << "  const double r" << c.first << " = " << detail::c_literal(c.second) << ";\n";
+
+    for (const detail::Instruction& i : f.program()) {
+      const std::string a = "r" + std::to_string(i.a);
+      const std::string b = "r" + std::to_string(i.b);
+      os << "  const double r" << i.dst << " = ";
+      switch (i.op) {
+      case detail::OpCode::Sine:     os << "sin(" << a << ")"; break;
+      case detail::OpCode::Cosine:   os << "cos(" << a << ")"; break;
+      case detail::OpCode::Log:      os << "log(" << a << ")"; break;
+      case detail::OpCode::Exp:      os << "exp(" << a << ")"; break;
+      case detail::OpCode::Absolute: os << "fabs(" << a << ")"; break;
+      case detail::OpCode::Negate:   os << "-" << a; break;
+      case detail::OpCode::Add:      os << a << " + " << b; break;
+      case detail::OpCode::Subtract: os << a << " - " << b; break;
+      case detail::OpCode::Multiply: os << a << " * " << b; break;
+      case detail::OpCode::Divide:   os << a << " / " << b; break;
+      case detail::OpCode::Power:    os << "pow(" << a << ", " << b << ")"; break;
+      }
+      os << ";\n";
+    }
+
+    os << "  return r" << f.result() << ";\n"
+       << "}\n";
+    return os.str();
+  }
+
+  /*! \brief Options for building a \ref NativeExpr. */
+  struct NativeOptions {
+    NativeOptions():
+      compiler(detail::getenv_or("STATOR_CC", "cc")),
+      flags("-O2 -shared -fPIC"),
+      cache_dir(detail::native_cache_dir())
+    {}
+
+    //! \brief The C compiler command ($STATOR_CC, or cc by default).
+    std::string compiler;
+    //! \brief The flags to build a shared library with.
+    std::string flags;
+    //! \brief The directory where built libraries are cached.
+    std::string cache_dir;
+  };
+
+  /*! \brief An Expr compiled to native code by the system C compiler.
+
+    The expression is lowered to a \ref CompiledExpr, written out as
+    C source (see \ref ccode), built into a shared library and
+    loaded with dlopen. The resulting function pointer may be called
+    concurrently from any thread.
+
+    Libraries are cached on disk, keyed by the structural hash of
+    the expression and its variable list (and the compiler command),
+    so a later run which builds the same expression loads the
+    existing library instead of invoking the compiler. The source of
+    each cached library is stored alongside it and compared before
+    reuse, so hash collisions are detected and get their own entry.
+
+    \code{.cpp}
+    sym::NativeExpr f(sym::Expr("x*sin(y)+2"), {sym::Expr("x"), sym::Expr("y")});
+    double r = f({1.0, 0.5}); //x=1, y=0.5
+    \endcode
+
+    This requires a POSIX system (for dlopen) with a C compiler.
+   */
+  class NativeExpr {
+  public:
+    typedef double (*Function)(const double*);
+
+    /*! \brief Compile (or load from the cache) an expression.
+
+      \param f The expression to compile.
+      \param vars The variables of f, in the order their values are passed for evaluation.
+      \param options The compiler and cache configuration.
+     */
+    NativeExpr(const Expr& f, const std::vector<Expr>& vars, const NativeOptions& options = NativeOptions()):
+      _variables(vars.size()),
+      _cached(false)
+    {
+      const std::string command = options.compiler + " " + options.flags;
+      const std::string source = "/* " + command + " */\n" + ccode(CompiledExpr(f, vars));
+
+      std::size_t key = std::hash<Expr>{}(f);
+      for (const Expr& v : vars)
+	stator::hash_combine(key, std::hash<Expr>{}(v));
+      stator::hash_combine(key, std::hash<std::string>{}(command));
+
+      std::filesystem::create_directories(options.cache_dir);
+      const std::string base = (std::filesystem::path(options.cache_dir) / stator::string_format("%016zx", key)).string();
+
+      for (int attempt(0);; ++attempt) {
+	const std::string stem = base + (attempt ? "-" + std::to_string(attempt) : std::string());
+	if (std::filesystem::exists(stem + ".so") && std::filesystem::exists(stem + ".c")) {
+	  if (detail::read_file(stem + ".c") != source)
+	    continue; //A hash collision, try the next entry
+
+	  _cached = true;
+	} else
+	  build(source, stem, command);
+
+	_library = stem + ".so";
+	break;
+      }
+
+      void* handle = dlopen(_library.c_str(), RTLD_NOW | RTLD_LOCAL);
+      if (!handle)
+	stator_throw() << "Failed to load " << _library << ": " << dlerror();
+      _handle = std::shared_ptr<void>(handle, [](void* h) { dlclose(h); });
+
+      _function = reinterpret_cast<Function>(dlsym(handle, "stator_expr"));
+      if (!_function)
+	stator_throw() << "Failed to find the expression function in " << _library;
+    }
+
+    /*! \brief Evaluate the expression.
+
+      \param values Pointer to the values of the variables (in the
+      order given at construction).
+     */
+    double operator()(const double* values) const { return _function(values); }
+
+    /*! \brief Evaluate the expression.
+
+      \param values The values of the variables (in the order given at
+      construction).
+     */
+    double operator()(const std::vector<double>& values) const {
+      if (values.size() != _variables)
+	stator_throw() << "NativeExpr expects " << _variables << " variable values, but was passed " << values.size();
+      return _function(values.data());
+    }
+
+    /*! \brief The compiled function. It is valid while this NativeExpr (or a copy) exists. */
+    Function function() const { return _function; }
+
+    /*! \brief The number of variables of the expression. */
+    std::size_t variables() const { return _variables; }
+
+    /*! \brief True if the library was loaded from the cache rather than compiled. */
+    bool cached() const { return _cached; }
+
+    /*! \brief The path of the shared library. */
+    const std::string& library() const { return _library; }
+
+  private:
+    /*! \brief Compile the source into stem.so (and keep the source as stem.c).
+
+      The files are first written under temporary names and then
+      renamed into place, so concurrent processes never load a
+      partially written library.
+    */
+    static void build(const std::string& source, const std::string& stem, const std::string& command) {
+      const std::string tmp = stem + "." + std::to_string(::getpid());
+      {
+	std::ofstream out(tmp + ".c", std::ios::binary);
+	out << source;
+	if (!out)
+	  stator_throw() << "Failed to write the expression source to " << tmp << ".c";
+      }
+
+      const std::string cmd = command + " -o '" + tmp + ".so' '" + tmp + ".c' -lm";
+      if (std::system(cmd.c_str()) != 0) {
+	std::filesystem::remove(tmp + ".c");
+	stator_throw() << "Failed to compile the expression with \"" << cmd << "\"";
+      }
+
+      std::filesystem::rename(tmp + ".so", stem + ".so");
+      std::filesystem::rename(tmp + ".c", stem + ".c");
+    }
+
+    std::shared_ptr<void> _handle;
+    Function _function;
+    std::size_t _variables;
+    bool _cached;
+    std::string _library;
+  };
+}
@@ -0,0 +1,218 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#if !defined(STATOR_NONATOMIC_REFCOUNT) && defined(__has_include)
+#if __has_include(<sys/single_threaded.h>)
+#include <sys/single_threaded.h>
+#define STATOR_SINGLE_THREADED_CHECK
+#endif
+#endif
+
+namespace sym {
+  class RTBase;
+
+  namespace detail {
+#ifdef STATOR_NONATOMIC_REFCOUNT
+    /*! \brief The reference count embedded in each runtime node.
+
+      This is the single-threaded variant (selected by defining
+      STATOR_NONATOMIC_REFCOUNT), which avoids the cost of atomic
+      operations but means expressions must never be shared between
+      threads. \ref stator::parallel_for is then always serial.
+    */
+    class RefCount {
+    public:
+      RefCount(): _count(0) {}
+      //Copies of a node start with no references
+      RefCount(const RefCount&): _count(0) {}
+      RefCount& operator=(const RefCount&) { return *this; }
+
+      void acquire() { ++_count; }
+
+      //! \brief Acquire a reference, unless the count has already dropped to zero.
+      bool acquire_if_alive() {
+	if (!_count)
+	  return false;
+	++_count;
+	return true;
+      }
+
+      //! \brief Drop a reference, returning true if it was the last.
+      bool release() { return --_count == 0; }
+
+      std::size_t count() const { return _count; }
+
+    private:
+      std::uint32_t _count;
+    };
+#else
+    /*! \brief The reference count embedded in each runtime node.
+
+      Expressions may be shared between threads, thus the count is
+      atomic. Define STATOR_NONATOMIC_REFCOUNT for a cheaper,
+      single-threaded count.
+
+      As in libstdc++'s shared_ptr, the atomic read-modify-write
+      operations are skipped (where the C library can tell) while
+      the process has only ever had one thread.
+    */
+    class RefCount {
+    public:
+      RefCount(): _count(0) {}
+      //Copies of a node start with no references
+      RefCount(const RefCount&): _count(0) {}
+      RefCount& operator=(const RefCount&) { return *this; }
+
+      void acquire() {
+	if (single_threaded())
+	  _count.store(_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	else
+	  _count.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      //! \brief Acquire a reference, unless the count has already dropped to zero.
+      bool acquire_if_alive() {
+	std::uint32_t c = _count.load(std::memory_order_relaxed);
+	while (c)
+	  if (_count.compare_exchange_weak(c, c + 1, std::memory_order_acquire, std::memory_order_relaxed))
+	    return true;
+	return false;
+      }
+
+      //! \brief Drop a reference, returning true if it was the last.
+      bool release() {
+	if (single_threaded()) {
+	  const std::uint32_t c = _count.load(std::memory_order_relaxed);
+	  _count.store(c - 1, std::memory_order_relaxed);
+	  return c == 1;
+	}
+	return _count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+      }
+
+      std::size_t count() const { return _count.load(std::memory_order_relaxed); }
+
+    private:
+      static bool single_threaded() {
+#ifdef STATOR_SINGLE_THREADED_CHECK
+	return __libc_single_threaded;
+#else
+	return false;
+#endif
+      }
+
+      std::atomic<std::uint32_t> _count;
+    };
+#endif
+
+    void node_acquire(const RTBase* node);
+    void node_release(const RTBase* node);
+    std::size_t node_use_count(const RTBase* node);
+  }
+
+  /*! \brief An intrusive, reference counting smart pointer to a
+      runtime node.
+
+    The count is held inside the node (see \ref RTBase), so a node
+    and its count are a single allocation, and a pointer to any node
+    may be turned back into an owning reference (e.g., \ref Expr has
+    a constructor from RTBase&). It is otherwise used like a
+    std::shared_ptr, but has no weak references.
+  */
+  template<class T>
+  class NodePtr {
+  public:
+    typedef T element_type;
+
+    NodePtr() noexcept: _p(nullptr) {}
+
+    NodePtr(std::nullptr_t) noexcept: _p(nullptr) {}
+
+    /*! \brief Take a reference to a node.
+
+      \param add_ref If false, a reference which has already been
+      counted is adopted instead.
+     */
+    explicit NodePtr(T* p, bool add_ref = true): _p(p) {
+      if (_p && add_ref)
+	detail::node_acquire(_p);
+    }
+
+    NodePtr(const NodePtr& o) noexcept: _p(o._p) {
+      if (_p)
+	detail::node_acquire(_p);
+    }
+
+    NodePtr(NodePtr&& o) noexcept: _p(o._p) { o._p = nullptr; }
+
+    template<class U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+    NodePtr(const NodePtr<U>& o) noexcept: _p(o._p) {
+      if (_p)
+	detail::node_acquire(_p);
+    }
+
+    template<class U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+    NodePtr(NodePtr<U>&& o) noexcept: _p(o._p) { o._p = nullptr; }
+
+    ~NodePtr() {
+      if (_p)
+	detail::node_release(_p);
+    }
+
+    NodePtr& operator=(const NodePtr& o) {
+      NodePtr(o).swap(*this);
+      return *this;
+    }
+
+    NodePtr& operator=(NodePtr&& o) noexcept {
+      NodePtr(std::move(o)).swap(*this);
+      return *this;
+    }
+
+    T* get() const noexcept { return _p; }
+    T& operator*() const noexcept { return *_p; }
+    T* operator->() const noexcept { return _p; }
+    explicit operator bool() const noexcept { return _p != nullptr; }
+
+    //! \brief The number of references to the node (zero if empty).
+    long use_count() const { return _p ? long(detail::node_use_count(_p)) : 0; }
+
+    void reset() noexcept { NodePtr().swap(*this); }
+
+    void swap(NodePtr& o) noexcept { std::swap(_p, o._p); }
+
+  private:
+    template<class U> friend class NodePtr;
+
+    T* _p;
+  };
+
+  template<class T, class U>
+  NodePtr<T> static_pointer_cast(const NodePtr<U>& p) { return NodePtr<T>(static_cast<T*>(p.get())); }
+
+  template<class T, class U>
+  NodePtr<T> dynamic_pointer_cast(const NodePtr<U>& p) { return NodePtr<T>(dynamic_cast<T*>(p.get())); }
+}
@@ -0,0 +1,180 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+//This header is included by parser.hpp, once detail::parse is defined
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace sym {
+  /*! \brief A bounded cache of parsed expressions, keyed by their
+      input string.
+
+    Runtime expressions are immutable, so a cached result is handed
+    out as another reference to the same nodes rather than a copy.
+    When the cache is full, the least recently used entry is evicted.
+    Strings which fail to parse are not cached (the error is thrown
+    each time).
+
+    A cache may be used explicitly:
+    \code{.cpp}
+    sym::ParseCache cache(1000);
+    sym::Expr f = cache.parse("x^2 + sin(x)");   //As sym::Expr("x^2 + sin(x)")
+    \endcode
+
+    or the global cache, which is disabled (has no capacity) by
+    default, may be enabled to cache every Expr(const std::string&)
+    constructed (see \ref set_parse_cache_capacity).
+
+    A cache may be used from multiple threads (but not if
+    STATOR_NONATOMIC_REFCOUNT is defined, see \ref sym::NodePtr). Two
+    threads parsing the same (uncached) string at once may both parse
+    it.
+  */
+  class ParseCache {
+  public:
+    struct Stats {
+      std::size_t hits;
+      std::size_t misses;
+      std::size_t evictions;
+    };
+
+    /*! \brief Create a cache.
+
+      \param capacity The maximum number of entries. A cache with no
+      capacity parses every string.
+    */
+    explicit ParseCache(std::size_t capacity = 4096):
+      _capacity(capacity), _stats{0, 0, 0}
+    {}
+
+    ParseCache(const ParseCache&) = delete;
+    ParseCache& operator=(const ParseCache&) = delete;
+
+    /*! \brief The cache used by Expr(const std::string&).
+
+      It is never destroyed, as expressions held in static variables
+      may be released after it would be.
+    */
+    static ParseCache& global() {
+      static ParseCache* instance = new ParseCache(0);
+      return *instance;
+    }
+
+    //! \brief The parsed (and simplified) expression of a string.
+    Expr parse(std::string_view str) {
+      if (!_capacity.load(std::memory_order_relaxed))
+	return detail::parse(str);
+
+      {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _index.find(str);
+	if (it != _index.end()) {
+	  ++_stats.hits;
+	  //Mark the entry as the most recently used
+	  _entries.splice(_entries.begin(), _entries, it->second);
+	  return it->second->second;
+	}
+	++_stats.misses;
+      }
+
+      Expr result = detail::parse(str);
+
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_index.find(str) == _index.end()) {
+	_entries.emplace_front(std::string(str), result);
+	//The key views the string held by the list entry, which never moves
+	_index.emplace(_entries.front().first, _entries.begin());
+	evict();
+      }
+      return result;
+    }
+
+    //! \brief The maximum number of entries.
+    std::size_t capacity() const { return _capacity.load(std::memory_order_relaxed); }
+
+    //! \brief Change the maximum number of entries, evicting any excess.
+    void set_capacity(std::size_t capacity) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _capacity.store(capacity, std::memory_order_relaxed);
+      evict();
+    }
+
+    //! \brief The number of entries.
+    std::size_t size() const {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _entries.size();
+    }
+
+    Stats stats() const {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _stats;
+    }
+
+    //! \brief Reset the hit, miss and eviction counts to zero.
+    void reset_stats() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stats = Stats{0, 0, 0};
+    }
+
+    //! \brief Remove every entry.
+    void clear() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _index.clear();
+      _entries.clear();
+    }
+
+  private:
+    //! \brief Remove the least recently used entries until within the capacity.
+    void evict() {
+      while (_entries.size() > _capacity.load(std::memory_order_relaxed)) {
+	_index.erase(_entries.back().first);
+	_entries.pop_back();
+	++_stats.evictions;
+      }
+    }
+
+    typedef std::list<std::pair<std::string, Expr>> Entries;
+
+    std::atomic<std::size_t> _capacity;
+    mutable std::mutex _mutex;
+    Stats _stats;
+    //! \brief The entries, most recently used first.
+    Entries _entries;
+    std::unordered_map<std::string_view, Entries::iterator> _index;
+  };
+
+  /*! \brief Set the capacity of the global \ref ParseCache used by
+      Expr(const std::string&).
+
+    The global cache has no capacity (and so is disabled) by
+    default. Setting the capacity to zero disables it again and
+    empties it.
+  */
+  inline void set_parse_cache_capacity(std::size_t capacity) {
+    ParseCache::global().set_capacity(capacity);
+  }
+}
@@ -0,0 +1,142 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stator/symbolic/runtime.hpp>
+#include <stator/symbolic/mapped_file.hpp>
+#include <stator/parallel.hpp>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sym {
+  /*! \brief The reason a record of \ref parse_records could not be
+      parsed.
+  */
+  struct RecordError {
+    //! \brief The index of the record (counting from zero).
+    std::size_t record;
+    //! \brief The offset of the start of the record in the buffer.
+    std::size_t offset;
+    //! \brief The parser's message, including its parserLoc() context.
+    std::string message;
+  };
+
+  /*! \brief Split a buffer into records at each delimiter.
+
+    A final delimiter does not start an empty record, and a trailing
+    carriage return is removed from each record, so files with
+    Windows line endings split as expected. The records are views
+    into the buffer.
+  */
+  inline std::vector<std::string_view> split_records(std::string_view buffer, char delimiter = '\n') {
+    std::vector<std::string_view> records;
+    std::size_t start = 0;
+    while (start < buffer.size()) {
+      std::size_t end = buffer.find(delimiter, start);
+      if (end == std::string_view::npos)
+	end = buffer.size();
+      std::string_view record = buffer.substr(start, end - start);
+      if (!record.empty() && (record.back() == '\r') && (delimiter != '\r'))
+	record.remove_suffix(1);
+      records.push_back(record);
+      start = end + 1;
+    }
+    return records;
+  }
+
+  /*! \brief Parse every delimited record of a buffer.
+
+    The records are parsed over the threads of \ref stator::parallel_for,
+    but the results are always in the order of the records in the
+    buffer. Records which fail to parse (including blank records) are
+    left as an empty Expr, and an entry is added to errors for each,
+    in record order.
+
+    \param buffer The records, separated by the delimiter.
+    \param errors Receives the failures (it is cleared first).
+    \param delimiter The character separating the records.
+    \param threads The number of threads to use (see \ref stator::set_parallelism).
+  */
+  inline std::vector<Expr> parse_records(std::string_view buffer, std::vector<RecordError>& errors, char delimiter = '\n', std::size_t threads = stator::parallel_threads()) {
+    const std::vector<std::string_view> records = split_records(buffer, delimiter);
+    std::vector<Expr> results(records.size());
+    std::vector<std::string> messages(records.size());
+
+    stator::parallel_for(records.size(), [&](std::size_t i) {
+	const ParseResult r = try_parse(records[i]);
+	if (r)
+	  results[i] = *r;
+	else
+	  messages[i] = r.message();
+      }, threads);
+
+    errors.clear();
+    for (std::size_t i(0); i < records.size(); ++i)
+      if (!messages[i].empty())
+	errors.push_back(RecordError{i, std::size_t(records[i].data() - buffer.data()), std::move(messages[i])});
+    return results;
+  }
+
+  /*! \brief Parse every delimited record of a buffer, throwing if
+      any fail.
+
+    As the other \ref parse_records overload, but the error of the
+    first failing record is thrown, with the record index and the
+    number of other records which failed.
+  */
+  inline std::vector<Expr> parse_records(std::string_view buffer, char delimiter = '\n', std::size_t threads = stator::parallel_threads()) {
+    std::vector<RecordError> errors;
+    std::vector<Expr> results = parse_records(buffer, errors, delimiter, threads);
+    if (!errors.empty())
+      stator_throw() << "Failed to parse record " << errors.front().record
+		     << " (at offset " << errors.front().offset << ")"
+		     << ((errors.size() > 1) ? " and " + std::to_string(errors.size() - 1) + " other records" : std::string())
+		     << ":\n" << errors.front().message;
+    return results;
+  }
+
+  /*! \brief Parse every delimited record of a file, throwing if any
+      fail (see \ref parse_records).
+  */
+  inline std::vector<Expr> parse_file(const std::string& path, char delimiter = '\n', std::size_t threads = stator::parallel_threads()) {
+    MappedFile file(path);
+    return parse_records(file.bytes(), delimiter, threads);
+  }
+
+  /*! \brief Parse every delimited record of a file, collecting the
+      failures (see \ref parse_records).
+  */
+  inline std::vector<Expr> parse_file(const std::string& path, std::vector<RecordError>& errors, char delimiter = '\n', std::size_t threads = stator::parallel_threads()) {
+    MappedFile file(path);
+    return parse_records(file.bytes(), errors, delimiter, threads);
+  }
+
+  /*! \brief Gather expressions (such as those from \ref
+      parse_records) into a one dimensional ArrayRT.
+  */
+  inline Expr make_array(const std::vector<Expr>& exprs) {
+    auto ret = ArrayRT::create(exprs.size());
+    std::copy(exprs.begin(), exprs.end(), ret->getStore().begin());
+    return ret;
+  }
+}
@@ -22,13 +22,59 @@
 #include <stator/symbolic/runtime.hpp>
 #include <stator/exception.hpp>
 #include <algorithm>
-#include <iostream>
+#include <array>
+#include <charconv>
 #include <cctype>
-#include <map>
+#include <cstdlib>
+#include <iostream>
 #include <sstream>
+#include <string_view>
+#include <vector>
 
 namespace sym
 {
+	/*! \brief The kinds of error found when parsing an expression
+	    string (see \ref try_parse).
+	*/
+	enum class ParseErrorCode
+	{
+		none,
+		//! \brief A character which does not start any token.
+		unrecognised_token,
+		//! \brief A second decimal point, or one in an exponent.
+		misplaced_decimal_point,
+		//! \brief An exponent without digits.
+		malformed_exponent,
+		//! \brief A number with two exponents.
+		double_exponent,
+		//! \brief A token other than the one required, e.g., a missing closing parenthesis.
+		unexpected_token,
+		//! \brief The expression ended where an operand was required.
+		unexpected_end,
+		//! \brief A token which cannot be an operand.
+		invalid_token,
+		//! \brief An operand where an operator was required.
+		expected_operator,
+		//! \brief Input left over after a complete expression.
+		trailing_input,
+		//! \brief A dictionary key which is not a variable.
+		invalid_dict_key,
+		//! \brief The expression could not be built from the parsed tokens.
+		invalid_expression
+	};
+
+	/*! \brief The location and kind of a parsing error. */
+	struct ParseError
+	{
+		ParseErrorCode code = ParseErrorCode::none;
+		//! \brief The offset of the offending token in the input.
+		std::size_t offset = 0;
+		//! \brief The length of the offending token.
+		std::size_t length = 0;
+		//! \brief The token required, for unexpected_token errors (empty for the end of the expression).
+		std::string_view expected;
+	};
+
 	namespace detail
 	{
 		/*! \brief Implementation of expression tokenization and parsing into Expr types.
@@ -45,7 +91,7 @@ namespace sym
       href="http://www.engr.mun.ca/~theo/Misc/pratt_parsing.htm">here</a>.
       
       The algorithm is implemented over four key functions:
-        1. Initialisation of all operator definitions takes place in the constructor ExprTokenizer::ExprTokenizer.
+        1. Initialisation of all operator definitions takes place (once) in the constructor of ExprTokenizer::OperatorTable.
         2. Expression strings are first broken down into tokens. Tokens are substrings such as "2", "*", "sin", or "(". ExprTokenizer::next yields the current token, and the system is moved onto the next using ExprTokenizer::consume (where the actual tokenization takes place).
 	    3. Parsing of "leaves" of the Abstract Syntax Tree (AST), such as variables, numbers, including functions/prefix-operators are handled via ExprTokenizer::parseToken. Functions and prefix-operators may contain sub-trees and these are parsed recursively. 
 	    4. Full expression strings/trees are parsed via \ref ExprTokenizer::parseExpression. Its main purpose is to resolve binary operator precedence.
@@ -59,104 +105,131 @@ namespace sym
 		class ExprTokenizer
 		{
 		public:
-			ExprTokenizer(const std::string &str) : _str(str),
+			struct LeftOperatorBase;
+			struct RightOperatorBase;
+			struct OperatorTable;
+
+			/*! \brief Tokenizes a string, which must outlive the tokenizer
+			    as the tokens are views into it.
+
+			  \param throws If false, errors are not thrown but recorded
+			  (see \ref error) and the parse stops with an empty Expr.
+			*/
+			explicit ExprTokenizer(std::string_view str, bool throws = true) : _str(str),
 													_start(0),
-													_end(0)
+													_end(0),
+													_throws(throws),
+													_operators(OperatorTable::get())
 			{
-				//This is a discussion of parsing precedence and how it works.
-
-				//Left operators are variables, numbers, functions, etc. They
-				//are potentially the left operand of a binary operation.
-
-				//Right operators always come after left operators, they can
-				//be binary operators like "+" or they can be other things
-				//like closing parenthesis.
-
-				//Complex operations like the parenthetical grouping operator
-				//"()" start with a left operator "(", then finish with a
-				//right operator ")". On the other hand, array access starts
-				//with a right operator "[" as it needs to bind to something
-				//on the left and right of the "[", and it finishes with a
-				//right operator "]".
-
-				// Binding powers set which operator will bind to a
-				// token. Right operators have two binding powers (left and
-				// right), while left operators only have a right binding
-				// power. The way Pratt parsing works is that it climbs up the
-				// binding power in a loop, while recursing down in binding
-				// power.  Ignoring the implementation details, lets look at an example
-
-				//Token           :  sin  x    +    2    +    3
-				//Handedness      :   L   L    R    L    R    L
-				//Binding powers  :  inf     10#11     10#11
-				//Parsed Tree     :  (((sin  x) + 2) + 3)
-				//
-				// Sin has a very high (inf) binding power, as we want it to
-				// grab whatever is to its right. Plus has a stronger right
-				// binding power than left as we want it to be left
-				// associative. To see this, we assigning tokens to the
-				// operators either side of them with the highest binding
-				// power which gives the resulting parse.
-
-				_right_operators["="].reset(new BinaryOpToken<detail::Equality>());
-				_right_operators["+"].reset(new BinaryOpToken<detail::Add>());
-				_right_operators["-"].reset(new BinaryOpToken<detail::Subtract>());
-				_right_operators["*"].reset(new BinaryOpToken<detail::Multiply>());
-				_right_operators["/"].reset(new BinaryOpToken<detail::Divide>());
-				_right_operators["^"].reset(new BinaryOpToken<detail::Power>());
-				_right_operators["{"].reset(new BinaryOpToken<detail::Units>());
-				_right_operators["±"].reset(new BinaryOpToken<detail::Uncertainty>());
-
-				//The unary operators, slightly higher binding power than addition/subtraction
-				_left_operators["+"].reset(new SkipToken<detail::Add::leftBindingPower + 1>());
-				_left_operators["-"].reset(new UnaryNegative<detail::Add::leftBindingPower + 1>());
-
-				_left_operators["("].reset(new ParenthesisToken);
-				//A halt token stops parseExpression processing. The right
-				//parenthesis should be handled by the previous entry.
-				_right_operators[")"].reset(new HaltToken);
-
-				//Array construction token (i.e. [1,2, x + y])
-				_left_operators["["].reset(new ArrayToken);
-
-				//To allow commas to delimit statements/expressions i.e. in a list or dictionary.
-				_right_operators[","].reset(new HaltToken);
-
-				//Array access token (i.e. x[1])
-				_right_operators["["].reset(new BinaryOpToken<detail::ArrayAccess>());
-
-				//Halt token for list access AND list construction
-				_right_operators["]"].reset(new HaltToken);
-
-				//Dictionary construction
-				_left_operators["{"].reset(new DictToken);
-				_right_operators[":"].reset(new HaltToken);
-				_right_operators["}"].reset(new HaltToken);
-
-				//Most unary operators have high binding powers to grab the very next argument
-				_left_operators["sin"].reset(new UnaryOpToken<detail::Sine>());
-				_left_operators["cos"].reset(new UnaryOpToken<detail::Cosine>());
-				_left_operators["exp"].reset(new UnaryOpToken<detail::Exp>());
-				_left_operators["ln"].reset(new UnaryOpToken<detail::Log>());
-
 				//The actual tokenisation is done in the consume() member
 				//function. The first call starts the process and clears the "end" state.
 				consume();
 			}
 
-			std::string next()
+			ExprTokenizer(const char *str) : ExprTokenizer(std::string_view(str)) {}
+
+			//The tokens would outlive a temporary string
+			ExprTokenizer(std::string &&) = delete;
+
+			std::string_view next() const
 			{
-				return empty() ? "" : _str.substr(_start, _end - _start);
+				return _str.substr(_start, _end - _start);
 			}
 
-			void expect(std::string token)
+			void expect(std::string_view token)
 			{
 				if (next() != token)
-					stator_throw() << "Expected " << ((token.empty()) ? "end of expression" : ("\"" + token + "\"")) << " but found " << (empty() ? "the end of expression" : next()) << "\" instead?\n"
-								   << parserLoc();
+				{
+					fail(ParseErrorCode::unexpected_token, _start, _end, token);
+					return;
+				}
 				consume();
 			}
 
+			/*! \brief Report an error at the characters [start, end) of
+			    the input.
+
+			  Only the first error is recorded. Unless the tokenizer
+			  throws, the rest of the input is skipped so that the parse
+			  unwinds, and an empty Expr is returned for the callers to
+			  pass up.
+			*/
+			Expr fail(ParseErrorCode code, std::size_t start, std::size_t end, std::string_view expected = {})
+			{
+				if (!failed())
+					_error = ParseError{code, start, end - start, expected};
+				if (_throws)
+					stator_throw() << describe(_error, _str);
+				_start = _end = _str.size();
+				return Expr();
+			}
+
+			bool failed() const
+			{
+				return _error.code != ParseErrorCode::none;
+			}
+
+			//! \brief The first error found, if the tokenizer does not throw.
+			const ParseError &error() const
+			{
+				return _error;
+			}
+
+			//! \brief The offset of the current token in the input.
+			std::size_t position() const
+			{
+				return _start;
+			}
+
+			//! \brief The diagnostic message of an error in the input.
+			static std::string describe(const ParseError &e, std::string_view input)
+			{
+				const std::string_view token = input.substr(std::min(e.offset, input.size()), e.length);
+				std::ostringstream os;
+				switch (e.code)
+				{
+				case ParseErrorCode::none:
+					return "";
+				case ParseErrorCode::unrecognised_token:
+					os << "Unrecognised token \"" << token << "\"";
+					break;
+				case ParseErrorCode::misplaced_decimal_point:
+					os << "Unexpected decimal point?";
+					break;
+				case ParseErrorCode::malformed_exponent:
+					os << "Malformed exponent?";
+					break;
+				case ParseErrorCode::double_exponent:
+					os << "Double exponent?";
+					break;
+				case ParseErrorCode::unexpected_token:
+					os << "Expected " << (e.expected.empty() ? "end of expression" : "\"" + std::string(e.expected) + "\"")
+					   << " but found " << (token.empty() ? "the end of expression" : "\"" + std::string(token) + "\"") << " instead?";
+					break;
+				case ParseErrorCode::unexpected_end:
+					os << "Unexpected end of expression?";
+					break;
+				case ParseErrorCode::invalid_token:
+					os << "Could not parse \"" << token << "\" as a valid token?";
+					break;
+				case ParseErrorCode::expected_operator:
+					os << "Expected right operator but got \"" << token << "\"?";
+					break;
+				case ParseErrorCode::trailing_input:
+					os << "Parsing terminated unexpectedly early?";
+					break;
+				case ParseErrorCode::invalid_dict_key:
+					os << "Dictionary keys must be variables, but found \"" << token << "\"?";
+					break;
+				case ParseErrorCode::invalid_expression:
+					os << "Invalid expression?";
+					break;
+				}
+				os << "\n"
+				   << location(input, e.offset, e.offset + e.length);
+				return os.str();
+			}
+
 			bool empty() const
 			{
 				return _start == _str.size();
@@ -167,7 +240,7 @@ namespace sym
 				_start = _end;
 
 				//Skip whitespace
-				while ((_str[_start] == ' ') && (_start < _str.size()))
+				while ((_start < _str.size()) && (_str[_start] == ' '))
 					++_start;
 
 				_end = _start;
@@ -176,6 +249,8 @@ namespace sym
 				if (empty())
 					return;
 
+				STATOR_STATS_COUNT(tokens);
+
 				//Not at end of sequence so at least one character in symbol
 				_end = _start + 1;
 
@@ -199,21 +274,13 @@ namespace sym
 				//Now parse non-alpha single character operators as longer operators are strings and caught above.
 				//One issue is that unicode is actually two characters, so here we look for the start byte of UTF-8 
 				//characters we want to parse. This needs extension if we want generality.
-				if ((_str[_start] == '\xc2') || (_str[_start] == '\xc3')) 
+				if (((_str[_start] == '\xc2') || (_str[_start] == '\xc3')) && (_start + 1 < _str.size()))
 					_end = _start + 2;
 				
-				if (_right_operators.find(_str.substr(_start, _end - _start)) != _right_operators.end())
-					return;
-
-				if (_left_operators.find(_str.substr(_start,  _end - _start)) != _left_operators.end())
+				if (_operators.right(next()) || _operators.left(next()))
 					return;
 
-				//We also allow some unicode
-
-
-
-				stator_throw() << "Unrecognised token \"" << _str.substr(_start, _end) << "\"\n"
-							   << parserLoc();
+				fail(ParseErrorCode::unrecognised_token, _start, _end);
 			}
 
 			void consumeFloat()
@@ -233,8 +300,8 @@ namespace sym
 						}
 						else
 						{
-							stator_throw() << "Unexpected decimal point?\n"
-										   << parserLoc();
+							fail(ParseErrorCode::misplaced_decimal_point, _start, _end);
+							return;
 						}
 					}
 
@@ -246,27 +313,23 @@ namespace sym
 							decimal = true; //Don't allow decimals in the exponent
 							++_end;
 
-							if (_end == _str.size())
-								stator_throw() << "String ended during parsing of exponent\n"
-											   << parserLoc();
-
 							//Eat the exponent sign if present
-							if ((_str[_end] == '+') || (_str[_end] == '-'))
+							if ((_end != _str.size()) && ((_str[_end] == '+') || (_str[_end] == '-')))
 								++_end;
 
-							if (_end == _str.size())
-								stator_throw() << "String ended during parsing of exponent\n"
-											   << parserLoc();
-
-							if (!std::isdigit(_str[_end]))
-								stator_throw() << "Malformed exponent?\n"
-											   << parserLoc();
+							if ((_end == _str.size()) || !std::isdigit(_str[_end]))
+							{
+								fail(ParseErrorCode::malformed_exponent, _start, _end);
+								return;
+							}
 
 							continue;
 						}
 						else
-							stator_throw() << "Double exponent?\n"
-										   << parserLoc();
+						{
+							fail(ParseErrorCode::double_exponent, _start, _end);
+							return;
+						}
 					}
 
 					if (std::isdigit(_str[_end]))
@@ -279,9 +342,15 @@ namespace sym
 				}
 			}
 
-			std::string parserLoc()
+			std::string parserLoc() const
 			{
-				return _str + "\n" + std::string(_start, ' ') + std::string((_start < _end) ? _end - _start - 1 : 0, '-') + "^";
+				return location(_str, _start, _end);
+			}
+
+			//! \brief The input with the characters [start, end) marked below it.
+			static std::string location(std::string_view input, std::size_t start, std::size_t end)
+			{
+				return std::string(input) + "\n" + std::string(start, ' ') + std::string((start < end) ? end - start - 1 : 0, '-') + "^";
 			}
 
 			struct RightOperatorBase
@@ -315,12 +384,17 @@ namespace sym
 				Expr apply(Expr l, ExprTokenizer &tk) const
 				{
 					if constexpr (!Op::wrapped)
-						return Op::apply(l, tk.parseExpression(detail::RBP<Op>()));
+					{
+						Expr r = tk.parseExpression(detail::RBP<Op>());
+						return tk.failed() ? Expr() : Op::apply(l, r);
+					}
 
 					//For wrapped RHS args, we bind everything till the Halt token
-					Expr retval = Op::apply(l, tk.parseExpression(0));
-					tk.expect(Op::r_repr());
-					return retval;
+					static const std::string close = Op::r_repr();
+					Expr r = tk.parseExpression(0);
+					if (!tk.failed())
+						tk.expect(close);
+					return tk.failed() ? Expr() : Op::apply(l, r);
 				}
 
 				int LBP() const { return Op::leftBindingPower; }
@@ -341,8 +415,9 @@ namespace sym
 				Expr apply(ExprTokenizer &tk) const
 				{
 					Expr arg = tk.parseExpression(BP());
-					tk.expect(")");
-					return arg;
+					if (!tk.failed())
+						tk.expect(")");
+					return tk.failed() ? Expr() : arg;
 				}
 
 				//Parenthesis bind the whole following expression
@@ -367,13 +442,17 @@ namespace sym
 					while (true)
 					{
 						auto e = tk.parseExpression(BP());
+						if (tk.failed())
+							return Expr();
 						a->push_back(e);
 						if (tk.next() == "]")
 							break;
 						tk.expect(",");
+						if (tk.failed())
+							return Expr();
 					}
 
-					tk.expect("]");
+					tk.consume();
 					return a;
 				}
 
@@ -399,18 +478,29 @@ namespace sym
 
 					while (true)
 					{
+						const std::size_t key_start = tk.position();
 						Expr key_expr = tk.parseExpression(BP());
-						const VarRT &key = key_expr.as<VarRT>();
+						if (tk.failed())
+							return Expr();
+						const VarRT *key = dynamic_cast<const VarRT *>(key_expr.get());
+						if (!key)
+							return tk.fail(ParseErrorCode::invalid_dict_key, key_start, tk.position());
 
 						tk.expect(":");
+						if (tk.failed())
+							return Expr();
 						Expr value = tk.parseExpression(BP());
-						a[key] = value;
+						if (tk.failed())
+							return Expr();
+						a[*key] = value;
 						if (tk.next() == "}")
 							break;
 						tk.expect(",");
+						if (tk.failed())
+							return Expr();
 					}
 
-					tk.expect("}");
+					tk.consume();
 					return a_ptr;
 				}
 
@@ -426,7 +516,8 @@ namespace sym
 			{
 				Expr apply(ExprTokenizer &tk) const
 				{
-					return Op::apply(tk.parseExpression(BP()));
+					Expr arg = tk.parseExpression(BP());
+					return tk.failed() ? Expr() : Op::apply(arg);
 				}
 
 				int BP() const
@@ -464,7 +555,8 @@ namespace sym
 				Expr apply(ExprTokenizer &tk) const
 				{
 					Visitor v;
-					return tk.parseExpression(BP())->visit(v);
+					Expr arg = tk.parseExpression(BP());
+					return tk.failed() ? Expr() : arg->visit(v);
 				}
 
 				int BP() const
@@ -473,47 +565,187 @@ namespace sym
 				}
 			};
 
-			std::map<std::string, shared_ptr<LeftOperatorBase>> _left_operators;
-			std::map<std::string, shared_ptr<RightOperatorBase>> _right_operators;
+			/*! \brief The operators of the grammar, built once on first use
+			    and then shared (read only) by every parse and thread.
+
+			  Single byte operators are found directly from their byte,
+			  the few longer ones (function names and UTF-8 symbols) by a
+			  short scan.
+			*/
+			struct OperatorTable
+			{
+				static const OperatorTable &get()
+				{
+					static const OperatorTable table;
+					return table;
+				}
+
+				const LeftOperatorBase *left(std::string_view token) const
+				{
+					return find(_left_chars, _left_words, token);
+				}
+
+				const RightOperatorBase *right(std::string_view token) const
+				{
+					return find(_right_chars, _right_words, token);
+				}
+
+			private:
+				template <class Op>
+				using Words = std::vector<std::pair<std::string_view, const Op *>>;
+
+				template <class Op>
+				using Chars = std::array<const Op *, 256>;
+
+				OperatorTable() : _left_chars{}, _right_chars{}
+				{
+					//This is a discussion of parsing precedence and how it works.
+
+					//Left operators are variables, numbers, functions, etc. They
+					//are potentially the left operand of a binary operation.
+
+					//Right operators always come after left operators, they can
+					//be binary operators like "+" or they can be other things
+					//like closing parenthesis.
+
+					//Complex operations like the parenthetical grouping operator
+					//"()" start with a left operator "(", then finish with a
+					//right operator ")". On the other hand, array access starts
+					//with a right operator "[" as it needs to bind to something
+					//on the left and right of the "[", and it finishes with a
+					//right operator "]".
+
+					// Binding powers set which operator will bind to a
+					// token. Right operators have two binding powers (left and
+					// right), while left operators only have a right binding
+					// power. The way Pratt parsing works is that it climbs up the
+					// binding power in a loop, while recursing down in binding
+					// power.  Ignoring the implementation details, lets look at an example
+
+					//Token           :  sin  x    +    2    +    3
+					//Handedness      :   L   L    R    L    R    L
+					//Binding powers  :  inf     10#11     10#11
+					//Parsed Tree     :  (((sin  x) + 2) + 3)
+					//
+					// Sin has a very high (inf) binding power, as we want it to
+					// grab whatever is to its right. Plus has a stronger right
+					// binding power than left as we want it to be left
+					// associative. To see this, we assigning tokens to the
+					// operators either side of them with the highest binding
+					// power which gives the resulting parse.
+
+					add<BinaryOpToken<detail::Equality>>(_right_chars, _right_words, "=");
+					add<BinaryOpToken<detail::Add>>(_right_chars, _right_words, "+");
+					add<BinaryOpToken<detail::Subtract>>(_right_chars, _right_words, "-");
+					add<BinaryOpToken<detail::Multiply>>(_right_chars, _right_words, "*");
+					add<BinaryOpToken<detail::Divide>>(_right_chars, _right_words, "/");
+					add<BinaryOpToken<detail::Power>>(_right_chars, _right_words, "^");
+					add<BinaryOpToken<detail::Units>>(_right_chars, _right_words, "{");
+					add<BinaryOpToken<detail::Uncertainty>>(_right_chars, _right_words, "±");
+
+					//The unary operators, slightly higher binding power than addition/subtraction
+					add<SkipToken<detail::Add::leftBindingPower + 1>>(_left_chars, _left_words, "+");
+					add<UnaryNegative<detail::Add::leftBindingPower + 1>>(_left_chars, _left_words, "-");
+
+					add<ParenthesisToken>(_left_chars, _left_words, "(");
+					//A halt token stops parseExpression processing. The right
+					//parenthesis should be handled by the previous entry.
+					add<HaltToken>(_right_chars, _right_words, ")");
+
+					//Array construction token (i.e. [1,2, x + y])
+					add<ArrayToken>(_left_chars, _left_words, "[");
+
+					//To allow commas to delimit statements/expressions i.e. in a list or dictionary.
+					add<HaltToken>(_right_chars, _right_words, ",");
+
+					//Array access token (i.e. x[1])
+					add<BinaryOpToken<detail::ArrayAccess>>(_right_chars, _right_words, "[");
+
+					//Halt token for list access AND list construction
+					add<HaltToken>(_right_chars, _right_words, "]");
+
+					//Dictionary construction
+					add<DictToken>(_left_chars, _left_words, "{");
+					add<HaltToken>(_right_chars, _right_words, ":");
+					add<HaltToken>(_right_chars, _right_words, "}");
+
+					//Most unary operators have high binding powers to grab the very next argument
+					add<UnaryOpToken<detail::Sine>>(_left_chars, _left_words, "sin");
+					add<UnaryOpToken<detail::Cosine>>(_left_chars, _left_words, "cos");
+					add<UnaryOpToken<detail::Exp>>(_left_chars, _left_words, "exp");
+					add<UnaryOpToken<detail::Log>>(_left_chars, _left_words, "ln");
+				}
+
+				//The operator tokens are stateless, so one instance of each is shared
+				template <class Token, class Op>
+				static void add(Chars<Op> &chars, Words<Op> &words, std::string_view token)
+				{
+					static const Token instance;
+					if (token.size() == 1)
+						chars[static_cast<unsigned char>(token[0])] = &instance;
+					else
+						words.emplace_back(token, &instance);
+				}
+
+				template <class Op>
+				static const Op *find(const Chars<Op> &chars, const Words<Op> &words, std::string_view token)
+				{
+					if (token.size() == 1)
+						return chars[static_cast<unsigned char>(token[0])];
+					for (const auto &w : words)
+						if (w.first == token)
+							return w.second;
+					return nullptr;
+				}
+
+				Chars<LeftOperatorBase> _left_chars;
+				Chars<RightOperatorBase> _right_chars;
+				Words<LeftOperatorBase> _left_words;
+				Words<RightOperatorBase> _right_words;
+			};
 
 			/*!\brief Parses a single token (unary/prefix op, variable, or
          number), where precedence issues do not arise.
        */
 			Expr parseToken()
 			{
-				std::string token = next();
+				const std::size_t start = _start;
+				const std::string_view token = next();
 				consume();
 
 				if (token.empty())
-					stator_throw() << "Unexpected end of expression?\n"
-								   << parserLoc();
+					return fail(ParseErrorCode::unexpected_end, start, start);
 
 				//Parse numbers
 				if (std::isdigit(token[0]))
-				{
-					std::stringstream ss;
-					ss << token;
-					double val;
-					ss >> val;
-					return Expr(val);
-				}
+					return Expr(parseNumber(token));
 
 				//Parse left operators
-				auto it = _left_operators.find(token);
-				if (it != _left_operators.end())
-				{
-					return it->second->apply(*this);
-				}
+				if (const LeftOperatorBase *op = _operators.left(token))
+					return op->apply(*this);
 
 				//Its not a prefix operator or a number, if it is a single
 				//alpha character, then assume its a variable!
 
 				for (const char &c : token)
 					if (!std::isalpha(c))
-						stator_throw() << "Could not parse \"" + token + "\" as a valid token?\n"
-									   << parserLoc();
+						return fail(ParseErrorCode::invalid_token, start, start + token.size());
 
-				return VarRT::create(token);
+				return VarRT::create(std::string(token));
+			}
+
+			static double parseNumber(std::string_view token)
+			{
+				double val = 0;
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+				const auto result = std::from_chars(token.data(), token.data() + token.size(), val);
+				//Overflow and underflow are left to strtod, which rounds to infinity or zero
+				if (result.ec == std::errc::result_out_of_range)
+					val = std::strtod(std::string(token).c_str(), nullptr);
+#else
+				std::istringstream(std::string(token)) >> val;
+#endif
+				return val;
 			}
 
 			/*!\brief Main parsing entry function.
@@ -567,6 +799,8 @@ namespace sym
 				//function). Unary/prefix operators are handled directly by
 				//parseToken()
 				Expr t = parseToken();
+				if (failed())
+					return Expr();
 
 				//maxLBP is only allowed to decrease as it ensures the while
 				//loop climbs down the precedence tree (up the AST) to the
@@ -574,19 +808,18 @@ namespace sym
 				int maxLBP = std::numeric_limits<int>::max();
 				while (true)
 				{
-					std::string token = next();
+					const std::string_view token = next();
 
 					//Handle the special case of end of string
 					if (token.empty())
 						break;
 
 					//Determine the type of operator found
-					auto it = _right_operators.find(token);
+					const RightOperatorBase *op = _operators.right(token);
 
 					//If there is no match, then return an error
-					if (it == _right_operators.end())
-						stator_throw() << "Expected right operator but got \"" << token << "\"?\n"
-									   << parserLoc();
+					if (!op)
+						return fail(ParseErrorCode::expected_operator, _start, _end);
 
 					//If the operator has a lower binding power than what this
 					//call can collect (as limited by minLBP), then return. If
@@ -594,37 +827,139 @@ namespace sym
 					//binding power (stored in maxLBP) doesn't allow it to
 					//collect this operator, then exit and allow the calling
 					//function to handle this operator.
-					if ((minLBP > it->second->LBP()) || (it->second->LBP() > maxLBP))
+					if ((minLBP > op->LBP()) || (op->LBP() > maxLBP))
 						break;
 
 					consume();
-					t = it->second->apply(t, *this);
-					maxLBP = it->second->NBP();
+					t = op->apply(t, *this);
+					if (failed())
+						return Expr();
+					maxLBP = op->NBP();
 				}
 
 				return t;
 			}
 
 		private:
-			std::string _str;
+			std::string_view _str;
 			std::size_t _start;
 			std::size_t _end;
+			bool _throws;
+			ParseError _error;
+			const OperatorTable &_operators;
 		};
+
+		/*! \brief Parse and simplify an expression held in a string
+		    view, throwing if it is not a complete expression.
+		*/
+		inline Expr parse(std::string_view str)
+		{
+			ExprTokenizer tokenizer(str);
+			auto parsed = tokenizer.parseExpression();
+
+			//Check that the full string was parsed
+			if (!tokenizer.empty())
+				tokenizer.fail(ParseErrorCode::trailing_input, tokenizer.position(), str.size());
+			return simplify(parsed);
+		}
 	}
+}
+
+#include <stator/symbolic/parse_cache.hpp>
 
+namespace sym
+{
 	inline Expr::Expr(const std::string &str)
 	{
-		auto tokenizer = detail::ExprTokenizer(str);
-		auto parsed = tokenizer.parseExpression();
-		auto simplified = simplify(parsed);
-
-		*this = simplified;
-
-		//Check that the full string was parsed
-		if (!tokenizer.empty())
-			stator_throw() << "Parsing terminated unexpectedly early?\n"
-						   << tokenizer.parserLoc();
+		*this = ParseCache::global().parse(str);
 	}
 
 	inline Expr::Expr(const char *str) : Expr(std::string(str)) {}
+
+	/*! \brief The result of \ref try_parse, holding either the
+	    parsed expression or the error which stopped the parse.
+
+	  The diagnostic message of an error is only built when
+	  message() is called. A failed result keeps a copy of its input
+	  for this, so it may outlive the string which was parsed.
+	*/
+	class ParseResult
+	{
+	public:
+		ParseResult(Expr value) : _value(value) {}
+
+		ParseResult(const ParseError &error, std::string_view input, std::string message = std::string()) : _error(error), _input(input), _message(std::move(message)) {}
+
+		bool ok() const { return _error.code == ParseErrorCode::none; }
+
+		explicit operator bool() const { return ok(); }
+
+		//! \brief The parsed expression, throwing the error if there was one.
+		const Expr &value() const
+		{
+			if (!ok())
+				stator_throw() << message();
+			return _value;
+		}
+
+		const Expr &operator*() const { return value(); }
+
+		const ParseError &error() const { return _error; }
+
+		ParseErrorCode code() const { return _error.code; }
+
+		//! \brief The offset in the input of the error.
+		std::size_t offset() const { return _error.offset; }
+
+		//! \brief The diagnostic message of the error (empty if there was none).
+		std::string message() const
+		{
+			if (!_message.empty())
+				return _message;
+			return detail::ExprTokenizer::describe(_error, _input);
+		}
+
+	private:
+		Expr _value;
+		ParseError _error;
+		//! \brief A copy of the input, if the parse failed.
+		std::string _input;
+		std::string _message;
+	};
+
+	/*! \brief Parse (and simplify) an expression string, without
+	    throwing on syntax errors.
+
+	  This is intended for validating many strings where failures
+	  are expected, as no exception is raised and no message is built
+	  for an invalid string. Errors arising while building the parsed
+	  expression (reported as ParseErrorCode::invalid_expression)
+	  are still thrown internally, but these are rare.
+
+	  \code{.cpp}
+	  sym::ParseResult r = sym::try_parse(input);
+	  if (!r)
+	    std::cerr << "Error at " << r.offset() << "\n" << r.message();
+	  \endcode
+	*/
+	inline ParseResult try_parse(std::string_view str)
+	{
+		detail::ExprTokenizer tokenizer(str, false);
+		try
+		{
+			Expr parsed = tokenizer.parseExpression();
+
+			//Check that the full string was parsed
+			if (!tokenizer.failed() && !tokenizer.empty())
+				tokenizer.fail(ParseErrorCode::trailing_input, tokenizer.position(), str.size());
+
+			if (tokenizer.failed())
+				return ParseResult(tokenizer.error(), str);
+			return ParseResult(simplify(parsed));
+		}
+		catch (const std::exception &e)
+		{
+			return ParseResult(ParseError{ParseErrorCode::invalid_expression, std::min(tokenizer.position(), str.size()), 0, {}}, str, e.what());
+		}
+	}
 }
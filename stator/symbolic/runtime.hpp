@@ -20,7 +20,11 @@
 #pragma once
 
 #include <stator/symbolic/symbolic.hpp>
+#include <stator/symbolic/node_ptr.hpp>
+#include <stator/symbolic/stats.hpp>
 
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <sstream>
 #include <vector>
@@ -56,11 +60,12 @@ namespace sym
   simply resolve to the compile-time functions by determining types
   and calling the specialised versions.
 
-  Runtime types MUST be held in a shared_ptr, as expressions may reuse
-  parts of another for speed (for example the derivative of f*g can
-  reuse f and g in its result). This means they cannot be constructed,
-  only ::create()ed. This also allows some tricks regarding varying
-  the returned type depending on arguments.
+  Runtime types MUST be held in a reference counted NodePtr (or
+  Expr), as expressions may reuse parts of another for speed (for
+  example the derivative of f*g can reuse f and g in its result).
+  This means they cannot be constructed, only ::create()ed. This
+  also allows some tricks regarding varying the returned type
+  depending on arguments.
 
   Types generally have to be immutable then to allow expression reuse,
   so we might need to revist this for List and Dict types later.
@@ -83,6 +88,8 @@ namespace sym
   struct UnaryOp<Expr, Op>;
   template <class Op>
   struct BinaryOp<Expr, Op, Expr>;
+  template <class Op>
+  struct NaryOp;
   template <class T>
   class ConstantRT;
   template <>
@@ -93,6 +100,8 @@ namespace sym
   {
     template <class RetType>
     struct VisitorInterface;
+
+    class NodePool;
   }
 
   /*! \brief Abstract interface class for all runtime symbolic
@@ -102,10 +111,10 @@ namespace sym
       can be held by \ref Expr. Most actual functionality is
       implemented using the \ref VisitorInterface via \ref visit.
   */
-  class RTBase : public std::enable_shared_from_this<RTBase>
+  class RTBase
   {
   public:
-    inline RTBase(int idx) : _type_idx(idx) {}
+    inline RTBase(int idx) : _type_idx(idx), _interned(false), _hash_cached(false), _hash(0), _pool(nullptr), _node_size(0), _intern_key(0), _intern_generation(0) {}
 
     inline virtual ~RTBase() {}
 
@@ -126,8 +135,53 @@ namespace sym
 
     const int _type_idx;
 
+    /*! \brief Set if this node is held in the intern table (see
+        \ref set_interning), in which case it is the only node
+        structurally equal to itself.
+    */
+    bool _interned;
+
+    /*! \brief Set if the structural hash of this node is stored in
+        _hash.
+
+	Immutable nodes compute their hash once, on construction, from
+	the stored hashes of their children. The mutable containers
+	(ArrayRT and DictRT) do not, and are hashed on request, and so
+	neither are the nodes above them, as a stored hash would go
+	stale when a container below is changed.
+    */
+    bool _hash_cached;
+
+    std::size_t _hash;
+
+    /*! \brief The number of \ref NodePtr (and \ref Expr) references
+        to this node. */
+    mutable detail::RefCount _refs;
+
+    /*! \brief The pool this node was allocated from (if any), and
+        its allocated size (see \ref detail::make_node). */
+    detail::NodePool *_pool;
+    std::uint32_t _node_size;
+
+    /*! \brief The key of this node in the intern table, if _interned. */
+    std::size_t _intern_key;
+
+    /*! \brief The generation of the intern table this node was
+        interned in (see \ref detail::InternTable::clear). */
+    std::uint32_t _intern_generation;
+
+    /*! \brief The structural hash of this node (as std::hash<Expr>). */
+    std::size_t hash() const;
+
     template <class RetType>
     RetType visit(detail::VisitorInterface<RetType> &c) const;
+
+  protected:
+    void cache_hash(std::size_t h)
+    {
+      _hash = h;
+      _hash_cached = true;
+    }
   };
 
   /*! \brief The generic holder/smart pointer for a runtime Abstract
@@ -138,21 +192,29 @@ namespace sym
     formula strings) into runtime forms. It also inherits from
     SymbolicOperator and can be used in compile-time expressions.
   */
-  struct Expr : public shared_ptr<const RTBase>, public SymbolicOperator<Expr>
+  struct Expr : public NodePtr<const RTBase>, public SymbolicOperator<Expr>
   {
-    typedef shared_ptr<const RTBase> Base;
+    typedef NodePtr<const RTBase> Base;
 
     inline Expr() {}
-    inline Expr(const std::shared_ptr<RTBase> &p) : Base(p) {}
     inline Expr(const Expr &p) : Base(p) {}
+    inline Expr(Expr &&p) noexcept : Base(std::move(p)) {}
     Expr &operator=(const Expr &v)
     {
       Base::operator=(v);
       return *this;
     }
+    Expr &operator=(Expr &&v) noexcept
+    {
+      Base::operator=(std::move(v));
+      return *this;
+    }
+
+    template <class T, typename = typename std::enable_if<std::is_base_of<RTBase, T>::value>::type>
+    inline Expr(const NodePtr<T> &p) : Base(p) {}
 
     template <class T, typename = typename std::enable_if<std::is_base_of<RTBase, T>::value>::type>
-    inline Expr(const std::shared_ptr<T> &p) : Base(p) {}
+    inline Expr(NodePtr<T> &&p) : Base(std::move(p)) {}
 
     Expr(const char *);
     Expr(const std::string &);
@@ -215,7 +277,7 @@ namespace sym
 namespace stator
 {
   template <class T, typename = typename std::enable_if<std::is_base_of<sym::RTBase, T>::value>::type>
-  auto store(const std::shared_ptr<T> &val)
+  auto store(const sym::NodePtr<T> &val)
   {
     return sym::Expr(val);
   }
@@ -262,6 +324,8 @@ namespace sym
       virtual RetType visit(const ArrayRT &) = 0;
       virtual RetType visit(const DictRT &) = 0;
       virtual RetType visit(const UnaryOp<Expr, detail::Negate> &) = 0;
+      virtual RetType visit(const NaryOp<detail::Add> &) = 0;
+      virtual RetType visit(const NaryOp<detail::Multiply> &) = 0;
     };
 
     /*! \brief A CRTP helper base class which transforms the visitor
@@ -274,78 +338,94 @@ namespace sym
     template <class Derived, class RetType = Expr>
     struct VisitorHelper : public VisitorInterface<RetType>
     {
-      inline virtual RetType visit(const double &x) { return static_cast<Derived *>(this)->apply(x); }
-      inline virtual RetType visit(const VarRT &x) { return static_cast<Derived *>(this)->apply(x); }
+      inline virtual RetType visit(const double &x) { return dispatch(x); }
+      inline virtual RetType visit(const VarRT &x) { return dispatch(x); }
       inline virtual RetType visit(const UnaryOp<Expr, detail::Sine> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const UnaryOp<Expr, detail::Cosine> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const UnaryOp<Expr, detail::Log> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const UnaryOp<Expr, detail::Exp> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const UnaryOp<Expr, detail::Absolute> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const UnaryOp<Expr, detail::Arbsign> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const BinaryOp<Expr, detail::Add, Expr> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const BinaryOp<Expr, detail::Subtract, Expr> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const BinaryOp<Expr, detail::Multiply, Expr> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const BinaryOp<Expr, detail::Divide, Expr> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const BinaryOp<Expr, detail::Power, Expr> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const BinaryOp<Expr, detail::Equality, Expr> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const BinaryOp<Expr, detail::ArrayAccess, Expr> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const BinaryOp<Expr, detail::Units, Expr> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const BinaryOp<Expr, detail::Uncertainty, Expr> &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const ArrayRT &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const DictRT &x)
       {
-        return static_cast<Derived *>(this)->apply(x);
+        return dispatch(x);
       }
       inline virtual RetType visit(const UnaryOp<Expr, detail::Negate> &x)
       {
+        return dispatch(x);
+      }
+      inline virtual RetType visit(const NaryOp<detail::Add> &x)
+      {
+        return dispatch(x);
+      }
+      inline virtual RetType visit(const NaryOp<detail::Multiply> &x)
+      {
+        return dispatch(x);
+      }
+
+    private:
+      template <class T>
+      RetType dispatch(const T &x)
+      {
+        STATOR_STATS_COUNT_VISIT(Derived);
         return static_cast<Derived *>(this)->apply(x);
       }
     };
@@ -353,6 +433,8 @@ namespace sym
 
   namespace detail
   {
+    inline bool equal_operands(const RTBase &l, const RTBase &r);
+
     /*! \brief Comparison visitor.
 
       This visitor completes type determinations for operator==
@@ -396,6 +478,16 @@ namespace sym
 
     virtual bool compare(const Expr &rhs) const
     {
+      STATOR_STATS_COUNT(compares);
+      //Interned nodes are unique within a generation of the intern
+      //table, so equality is identity
+      if (RTBase::_interned && rhs->_interned && (RTBase::_intern_generation == rhs->_intern_generation))
+        return this == rhs.get();
+
+      //Nodes of the same type which are equal have equal hashes
+      if (RTBase::_hash_cached && rhs->_hash_cached && (RTBase::_type_idx == rhs->_type_idx) && (RTBase::_hash != rhs->_hash))
+        return false;
+
       const Derived &lhs(*static_cast<const Derived *>(this));
       detail::ComparisonVisitor<Derived> visitor(lhs);
       return rhs->visit(visitor);
@@ -423,8 +515,48 @@ namespace sym
     detail::BPVisitor vis;
     return v->visit(vis);
   }
+
+  namespace detail
+  {
+    /*! \brief Release an operand of a node which is being destroyed.
+
+      Dropping the last reference to a deep expression would destroy
+      it recursively, one stack frame per level of the tree. Instead,
+      operands which would be destroyed while another release is
+      running on this thread are moved onto that release's list,
+      which it drains in a loop.
+    */
+    inline void release_operand(Expr &e)
+    {
+      //Shared operands only lose a reference
+      if (e.use_count() != 1)
+        return;
+
+      thread_local std::vector<Expr> *pending = nullptr;
+      if (pending)
+      {
+        pending->emplace_back();
+        pending->back().swap(e);
+        return;
+      }
+
+      std::vector<Expr> local;
+      pending = &local;
+      e.reset();
+      while (!local.empty())
+      {
+        Expr next;
+        next.swap(local.back());
+        local.pop_back();
+        next.reset();
+      }
+      pending = nullptr;
+    }
+  }
 }
 
+#include <stator/symbolic/allocator.hpp>
+#include <stator/symbolic/intern.hpp>
 #include <stator/symbolic/binary_ops_rt.hpp>
 #include <stator/symbolic/variable_rt.hpp>
 
@@ -432,6 +564,19 @@ namespace sym
 {
   namespace detail
   {
+    inline void node_acquire(const RTBase *node) { node->_refs.acquire(); }
+
+    inline void node_release(const RTBase *node)
+    {
+      if (!node->_refs.release())
+        return;
+      if (node->_interned)
+        InternTable::get().erase(node);
+      destroy_node(node);
+    }
+
+    inline std::size_t node_use_count(const RTBase *node) { return node->_refs.count(); }
+
     struct HashRT : VisitorHelper<HashRT, std::size_t>
     {
       HashRT() {}
@@ -453,21 +598,34 @@ namespace std
   {
     std::size_t operator()(sym::Expr const &f) const noexcept
     {
-      sym::detail::HashRT vis;
-      return f->visit(vis);
+      return f->hash();
     }
   };
 }
 
+namespace sym
+{
+  inline std::size_t RTBase::hash() const
+  {
+    STATOR_STATS_COUNT(hashes);
+    if (_hash_cached)
+      return _hash;
+    detail::HashRT vis;
+    return visit(vis);
+  }
+}
+
 #include <stator/symbolic/constants_rt.hpp>
 #include <stator/symbolic/unary_ops_rt.hpp>
 #include <stator/symbolic/array_rt.hpp>
 #include <stator/symbolic/dict_rt.hpp>
+#include <stator/symbolic/nary_ops_rt.hpp>
+#include <stator/symbolic/traversal.hpp>
 
 namespace sym
 {
 
-  inline Expr::Expr(const RTBase &v) : Base(v.shared_from_this()) {}
+  inline Expr::Expr(const RTBase &v) : Base(&v) {}
 
   inline Expr::Expr(const double &v) : Base(ConstantRT<double>::create(v)) {}
 
@@ -483,7 +641,7 @@ namespace sym
   template <conststr N1>
   Expr::Expr(const Var<N1> &v) : Base(VarRT::create(v)) {}
 
-  inline Expr::Expr(const VarRT &v) : Base(v.shared_from_this()) {}
+  inline Expr::Expr(const VarRT &v) : Base(&v) {}
 
   template <class... Args>
   Expr::Expr(const Array<Args...> &in)
@@ -503,8 +661,8 @@ namespace sym
     }
   }
 
-  Expr::Expr(const ArrayRT &v) : Base(v.shared_from_this()) {}
-  Expr::Expr(const DictRT &v) : Base(v.shared_from_this()) {}
+  Expr::Expr(const ArrayRT &v) : Base(&v) {}
+  Expr::Expr(const DictRT &v) : Base(&v) {}
 
   template <class T>
   const T &Expr::as() const
@@ -566,6 +724,40 @@ namespace sym
 
     struct SimplifyRT : VisitorHelper<SimplifyRT>
     {
+      /*! \brief Simplify a child expression.
+
+        Expressions are DAGs, as operations (e.g., derivative) reuse
+        their arguments, so the same node may be reached many times.
+        Each distinct node is simplified only once per simplify call,
+        and its result reused, which also preserves the sharing in
+        the output. The memo holds the node, so its address cannot be
+        reused by another node while the table is alive.
+      */
+      Expr visit_child(const Expr &e)
+      {
+        //Leaves are cheaper to visit than to look up
+        if (is_leaf(*e))
+          return e->visit(*this);
+
+        auto it = _memo.find(e.get());
+        if (it != _memo.end())
+          return it->second.second;
+
+        Expr result = e->visit(*this);
+        if (result)
+          STATOR_STATS_COUNT(simplify_rewrites);
+        _memo.emplace(e.get(), std::make_pair(e, result));
+        return result;
+      }
+
+      static bool is_leaf(const RTBase &e)
+      {
+        return (e._type_idx == detail::Type_index<ConstantRT<double>>::value) || (e._type_idx == detail::Type_index<VarRT>::value);
+      }
+
+      //! \brief Simplified results (empty if unchanged) of the nodes visited so far.
+      std::unordered_map<const RTBase *, std::pair<Expr, Expr>> _memo;
+
       /*! 
 	    \brief Default action is to return the original expression. 
       */
@@ -593,13 +785,13 @@ namespace sym
       Expr apply(const BinaryOp<Expr, Op, Expr> &op)
       {
         //First we try to simplify the LHS
-        Expr l = op.getLHS()->visit(*this);
+        Expr l = visit_child(op.getLHS());
         bool lchanged = !!l;
         if (!l)
           l = op._l;
 
         //Now try to simplify the RHS
-        Expr r = op.getRHS()->visit(*this);
+        Expr r = visit_child(op.getRHS());
         bool rchanged = !!r;
         if (!r)
           r = op._r;
@@ -614,6 +806,25 @@ namespace sym
         if (r == typename Op::right_identity())
           return Expr(l);
 
+        //Operations on flattened sums and products are merged into them
+        if constexpr (std::is_same<Op, detail::Add>::value || std::is_same<Op, detail::Subtract>::value)
+          if ((l->_type_idx == Type_index<SumRT>::value) || (r->_type_idx == Type_index<SumRT>::value))
+          {
+            NaryBuilder<detail::Add> sum(true);
+            sum.add(l);
+            sum.add(r, std::is_same<Op, detail::Add>::value ? 1 : -1);
+            return sum.finish();
+          }
+
+        if constexpr (std::is_same<Op, detail::Multiply>::value || std::is_same<Op, detail::Divide>::value)
+          if ((l->_type_idx == Type_index<ProductRT>::value) || (r->_type_idx == Type_index<ProductRT>::value))
+          {
+            NaryBuilder<detail::Multiply> product(true);
+            product.add(l);
+            product.add(r, std::is_same<Op, detail::Multiply>::value ? 1 : -1);
+            return product.finish();
+          }
+
         //Try direct simplification via application
         DoubleDispatch1<SimplifyRT, Op> visitor(r, *this);
         Expr ret = l->visit(visitor);
@@ -691,6 +902,30 @@ namespace sym
         return Expr();
       }
 
+      /*! \brief Simplify a flattened sum or product.
+
+        Each term is simplified, and the results are merged back into
+        canonical form, cancelling terms (e.g., x/x is 1).
+      */
+      template <typename Op>
+      Expr apply(const NaryOp<Op> &op)
+      {
+        NaryBuilder<Op> builder(true);
+        builder.add(Expr(op._constant));
+        bool changed = false;
+        for (const auto &t : op._terms)
+        {
+          Expr term = visit_child(t.first);
+          changed = changed || term;
+          builder.add(term ? term : t.first, t.second);
+        }
+
+        //The node is already canonical if none of its terms changed
+        //and none cancelled
+        Expr result = builder.finish();
+        return (changed || builder.cancelled()) ? result : Expr();
+      }
+
       //////// Handling of UnaryOp simplification
       template <class Op>
       struct UnaryEval : VisitorHelper<UnaryEval<Op>>
@@ -704,7 +939,7 @@ namespace sym
       Expr apply(const UnaryOp<Expr, Op> &op)
       {
         //Simplify the argument
-        Expr arg = op.getArg()->visit(*this);
+        Expr arg = visit_child(op.getArg());
         //Try evaluating the unary expression
         UnaryEval<Op> visitor;
         Expr ret = (arg ? arg : op.getArg())->visit(visitor);
@@ -719,14 +954,81 @@ namespace sym
 
   inline Expr simplify(const Expr &f)
   {
+    STATOR_STATS_COUNT(simplify_passes);
     detail::SimplifyRT visitor;
-    Expr result = f->visit(visitor);
+    //Operands are simplified first, bottom up, so that the visit of
+    //each node finds the results of its operands in the memo rather
+    //than recursing into them
+    detail::post_order(
+        *f, [&](const RTBase &node)
+        { return !visitor.is_leaf(node) && !visitor._memo.count(&node); },
+        [&](const RTBase &node, std::size_t)
+        { visitor.visit_child(Expr(node)); });
+    Expr result = visitor.visit_child(f);
     return result ? result : f;
   }
 
   namespace detail
   {
-    struct SubstituteRT : VisitorHelper<SubstituteRT>
+    /*! \brief Transform the elements of an array.
+
+      \param f Returns the transformed element, or an empty Expr if
+      it is unchanged. It is called in parallel when enabled (see
+      stator::set_parallelism).
+      \return The new array, or an empty Expr if no element changed.
+    */
+    template <class F>
+    Expr map_elements(const ArrayRT &v, F f)
+    {
+      const auto &in = v.getStore();
+      std::vector<Expr> results(in.size());
+      stator::parallel_for(in.size(), [&](std::size_t i)
+                           { results[i] = f(in[i]); });
+
+      if (std::none_of(results.begin(), results.end(), [](const Expr &e)
+                       { return bool(e); }))
+        return Expr();
+
+      auto ret_ptr = ArrayRT::create();
+      auto &ret = *ret_ptr;
+      ret.resize(v.getDimensions());
+      auto &out = ret.getStore();
+      for (std::size_t i(0); i < in.size(); ++i)
+        out[i] = results[i] ? results[i] : in[i];
+      return ret_ptr;
+    }
+  }
+
+  namespace detail
+  {
+    /*! \brief Rebuild a flattened sum or product with some of its
+        terms replaced.
+
+      \param f Returns the replacement of the i-th term, or an empty
+      Expr if it is unchanged.
+      \return The new expression, or an empty Expr if no term changed.
+    */
+    template <typename Op, class F>
+    Expr rebuild_nary(const NaryOp<Op> &op, F f)
+    {
+      std::vector<Expr> terms(op._terms.size());
+      bool changed = false;
+      for (std::size_t i(0); i < terms.size(); ++i)
+      {
+        terms[i] = f(i);
+        changed = changed || terms[i];
+      }
+      if (!changed)
+        return Expr();
+
+      NaryBuilder<Op> builder;
+      builder.add(Expr(op._constant));
+      for (std::size_t i(0); i < terms.size(); ++i)
+        builder.add(terms[i] ? terms[i] : op._terms[i].first, op._terms[i].second);
+      return builder.finish();
+    }
+
+    struct SubstituteRT : PostOrderHelper<SubstituteRT, Expr>
     {
       SubstituteRT(const VarRT &var, Expr replacement) : _var(var), _replacement(replacement) {}
 
@@ -748,57 +1050,23 @@ namespace sym
       //Variable matching
       Expr apply(const ArrayRT &v)
       {
-        auto ret_ptr = ArrayRT::create();
-        auto &ret = *ret_ptr;
-        bool _replaced = false; //We only start regenerating the list when needed
-
-        auto iptr = v.begin();
-        auto jptr = ret.begin();
-
-        while (iptr != v.end())
-        {
-          Expr t = (*iptr)->visit(*this);
-
-          if (bool(t) && (!_replaced))
-          {
-            //We're starting replacements, so copy everything skipped over so far
-            ret.resize(v.getDimensions());
-            jptr = ret.begin();
-            auto iiptr = v.begin();
-            while (iiptr != iptr)
-            {
-              *jptr = *iiptr;
-              ++iiptr;
-              ++jptr;
-            }
-            _replaced = true;
-          }
-
-          if (_replaced)
-          {
-            //continue the copy where required
-            *jptr = (t) ? t : *iptr;
-            ++jptr;
-          }
-
-          ++iptr;
-        }
-
-        return (_replaced) ? ret_ptr : Expr();
+        //Each element is traversed by its own copy of the visitor, as they may run in parallel
+        return map_elements(v, [&](const Expr &e)
+                            { auto visitor = *this; return visitor.traverse(e); });
       }
 
       template <typename Op>
       Expr apply(const UnaryOp<Expr, Op> &op)
       {
-        Expr arg = op.getArg()->visit(*this);
-        return arg ? Expr(Op::apply(arg)) : op.shared_from_this();
+        const Expr &arg = operand(0);
+        return arg ? Expr(Op::apply(arg)) : Expr(static_cast<const RTBase &>(op));
       }
 
       template <typename Op>
       Expr apply(const BinaryOp<Expr, Op, Expr> &op)
       {
-        Expr l = op.getLHS()->visit(*this);
-        Expr r = op.getRHS()->visit(*this);
+        const Expr &l = operand(0);
+        const Expr &r = operand(1);
 
         if (l || r)
           return Expr(Op::apply(l ? l : op._l, r ? r : op._r));
@@ -806,6 +1074,12 @@ namespace sym
           return Expr();
       }
 
+      template <typename Op>
+      Expr apply(const NaryOp<Op> &op)
+      {
+        return rebuild_nary(op, [&](std::size_t i) -> const Expr & { return operand(i); });
+      }
+
       const VarRT &_var;
       Expr _replacement;
     };
@@ -813,7 +1087,7 @@ namespace sym
 
   namespace detail
   {
-    struct SubstituteDictRT : VisitorHelper<SubstituteDictRT>
+    struct SubstituteDictRT : PostOrderHelper<SubstituteDictRT, Expr>
     {
       SubstituteDictRT(const DictRT &replacement) : _replacement(replacement)
       {
@@ -840,57 +1114,23 @@ namespace sym
       //Variable matching
       Expr apply(const ArrayRT &v)
       {
-        auto ret_ptr = ArrayRT::create();
-        auto &ret = *ret_ptr;
-
-        bool _replaced = false; //We only start regenerating the list when needed
-        auto iptr = v.begin();
-        auto jptr = ret.begin();
-
-        while (iptr != v.end())
-        {
-          Expr t = (*iptr)->visit(*this);
-
-          if (bool(t) && !_replaced)
-          {
-            //We're starting replacements, so copy everything skipped over so far
-            ret.resize(v.getDimensions());
-            jptr = ret.begin();
-            auto iiptr = v.begin();
-            while (iiptr != iptr)
-            {
-              *jptr = *iiptr;
-              ++iiptr;
-              ++jptr;
-            }
-            _replaced = true;
-          }
-
-          if (_replaced)
-          {
-            //continue the copy where required
-            *jptr = (t) ? t : *iptr;
-            ++jptr;
-          }
-
-          ++iptr;
-        }
-
-        return (_replaced) ? ret_ptr : Expr();
+        //Each element is traversed by its own copy of the visitor, as they may run in parallel
+        return map_elements(v, [&](const Expr &e)
+                            { auto visitor = *this; return visitor.traverse(e); });
       }
 
       template <typename Op>
       Expr apply(const UnaryOp<Expr, Op> &op)
       {
-        Expr arg = op.getArg()->visit(*this);
+        const Expr &arg = operand(0);
         return arg ? Expr(Op::apply(arg)) : Expr();
       }
 
       template <typename Op>
       Expr apply(const BinaryOp<Expr, Op, Expr> &op)
       {
-        Expr l = op.getLHS()->visit(*this);
-        Expr r = op.getRHS()->visit(*this);
+        const Expr &l = operand(0);
+        const Expr &r = operand(1);
 
         if (l || r)
           return Expr(Op::apply(l ? l : op._l, r ? r : op._r));
@@ -898,6 +1138,12 @@ namespace sym
           return Expr();
       }
 
+      template <typename Op>
+      Expr apply(const NaryOp<Op> &op)
+      {
+        return rebuild_nary(op, [&](std::size_t i) -> const Expr & { return operand(i); });
+      }
+
       const DictRT &_replacement;
     };
 
@@ -908,14 +1154,14 @@ namespace sym
   {
     auto v_ptr = VarRT::create(op._l);
     detail::SubstituteRT visitor(*v_ptr, Expr(op._r));
-    Expr result = f->visit(visitor);
+    Expr result = visitor.traverse(f);
     return (result) ? result : f;
   }
 
   Expr sub(const Expr &f, const DictRT &rep)
   {
     detail::SubstituteDictRT visitor(rep);
-    Expr result = f->visit(visitor);
+    Expr result = visitor.traverse(f);
     return (result) ? result : f;
   }
 
@@ -941,7 +1187,7 @@ namespace sym
       {
         const VarRT &v = op._l.as<VarRT>();
         detail::SubstituteRT visitor(v, op._r);
-        Expr result = _f->visit(visitor);
+        Expr result = visitor.traverse(_f);
         return (result) ? result : _f;
       }
 
@@ -956,6 +1202,363 @@ namespace sym
     return (result) ? result : f;
   }
 
+  inline Expr flatten(const Expr &f);
+
+  namespace detail
+  {
+    /*! \brief Converts sums and products into flattened \ref NaryOp
+        nodes (see \ref flatten).
+
+      A chain of sums (or products) is gathered from the top down on
+      an explicit stack, rather than flattening each level of the
+      chain and merging them, which would be quadratic in the length
+      of the chain. The ends of the chain, and the operands of other
+      nodes, are flattened first (see \ref flatten) and their results
+      found in a memo, as for \ref SimplifyRT, so shared nodes are
+      only flattened once and nothing recurses.
+    */
+    struct FlattenRT : VisitorHelper<FlattenRT>
+    {
+      /*! \brief The flattened child, or an empty Expr if it is
+          unchanged. Operator nodes are taken from the memo if they
+          have been flattened already. */
+      Expr flattened(const Expr &e)
+      {
+        if (SimplifyRT::is_leaf(*e))
+          return e->visit(*this);
+
+        auto it = _memo.find(e.get());
+        if (it != _memo.end())
+          return it->second.second;
+
+        Expr result = e->visit(*this);
+        _memo.emplace(e.get(), std::make_pair(e, result));
+        return result;
+      }
+
+      Expr visit_child(const Expr &e)
+      {
+        Expr result = flattened(e);
+        return result ? result : e;
+      }
+
+      //! \brief Flattened results (empty if unchanged) of the nodes visited so far.
+      std::unordered_map<const RTBase *, std::pair<Expr, Expr>> _memo;
+
+      //By default, return an empty Expr as the expression is unchanged
+      template <class T>
+      Expr apply(const T &)
+      {
+        return Expr();
+      }
+
+      Expr apply(const ArrayRT &v)
+      {
+        return map_elements(v, [](const Expr &e)
+                            { Expr r = flatten(e); return (r.get() == e.get()) ? Expr() : r; });
+      }
+
+      template <typename Op>
+      Expr apply(const UnaryOp<Expr, Op> &op)
+      {
+        Expr arg = visit_child(op._arg);
+        if (arg.get() == op._arg.get())
+          return Expr();
+        return Expr(UnaryOp<Expr, Op>::create(arg));
+      }
+
+      template <typename Op>
+      Expr apply(const BinaryOp<Expr, Op, Expr> &op)
+      {
+        Expr l = visit_child(op._l);
+        Expr r = visit_child(op._r);
+        if ((l.get() == op._l.get()) && (r.get() == op._r.get()))
+          return Expr();
+        return Expr(BinaryOp<Expr, Op, Expr>::create(l, r));
+      }
+
+      Expr apply(const UnaryOp<Expr, detail::Negate> &op) { return gather<detail::Add>(op); }
+      Expr apply(const BinaryOp<Expr, detail::Add, Expr> &op) { return gather<detail::Add>(op); }
+      Expr apply(const BinaryOp<Expr, detail::Subtract, Expr> &op) { return gather<detail::Add>(op); }
+      Expr apply(const BinaryOp<Expr, detail::Multiply, Expr> &op) { return gather<detail::Multiply>(op); }
+      Expr apply(const BinaryOp<Expr, detail::Divide, Expr> &op) { return gather<detail::Multiply>(op); }
+
+      Expr apply(const BinaryOp<Expr, detail::Power, Expr> &op)
+      {
+        if (integer_power(op))
+          return gather<detail::Multiply>(op);
+        Expr l = visit_child(op._l);
+        Expr r = visit_child(op._r);
+        if ((l.get() == op._l.get()) && (r.get() == op._r.get()))
+          return Expr();
+        return Expr(BinaryOp<Expr, detail::Power, Expr>::create(l, r));
+      }
+
+      template <typename Op>
+      Expr apply(const NaryOp<Op> &op)
+      {
+        return rebuild_nary(op, [&](std::size_t i)
+                            { return flattened(op._terms[i].first); });
+      }
+
+      /*! \brief The weight of a node of a chain, accumulated over the
+          paths to it, with the positive and negative contributions
+          kept apart (see \ref NaryBuilder). */
+      struct ChainWeight
+      {
+        ChainWeight scaled(double m) const { return (m < 0) ? ChainWeight{negative * m, positive * m} : ChainWeight{positive * m, negative * m}; }
+
+        ChainWeight &operator+=(const ChainWeight &o)
+        {
+          positive += o.positive;
+          negative += o.negative;
+          return *this;
+        }
+
+        double positive;
+        double negative;
+      };
+
+      /*! \brief Calls f(op, m) for each link op*m of a chain of
+          operations of the kind Op, if node continues the chain,
+          returning false otherwise.
+
+        Products only continue through integer powers, thus
+        (x*y)^(1/2) and (x^(1/2))^2 are left as single factors.
+      */
+      template <typename Op, class F>
+      static bool links(const RTBase &node, F f)
+      {
+        static constexpr bool is_sum = std::is_same<Op, detail::Add>::value;
+        const int idx = node._type_idx;
+        if (is_sum && (idx == Type_index<BinaryOp<Expr, detail::Add, Expr>>::value))
+        {
+          const auto &op = static_cast<const BinaryOp<Expr, detail::Add, Expr> &>(node);
+          f(*op._l, 1.0);
+          f(*op._r, 1.0);
+        }
+        else if (is_sum && (idx == Type_index<BinaryOp<Expr, detail::Subtract, Expr>>::value))
+        {
+          const auto &op = static_cast<const BinaryOp<Expr, detail::Subtract, Expr> &>(node);
+          f(*op._l, 1.0);
+          f(*op._r, -1.0);
+        }
+        else if (is_sum && (idx == Type_index<UnaryOp<Expr, detail::Negate>>::value))
+          f(*static_cast<const UnaryOp<Expr, detail::Negate> &>(node)._arg, -1.0);
+        else if (!is_sum && (idx == Type_index<BinaryOp<Expr, detail::Multiply, Expr>>::value))
+        {
+          const auto &op = static_cast<const BinaryOp<Expr, detail::Multiply, Expr> &>(node);
+          f(*op._l, 1.0);
+          f(*op._r, 1.0);
+        }
+        else if (!is_sum && (idx == Type_index<BinaryOp<Expr, detail::Divide, Expr>>::value))
+        {
+          const auto &op = static_cast<const BinaryOp<Expr, detail::Divide, Expr> &>(node);
+          f(*op._l, 1.0);
+          f(*op._r, -1.0);
+        }
+        else if (!is_sum && (idx == Type_index<BinaryOp<Expr, detail::Power, Expr>>::value) && integer_power(static_cast<const BinaryOp<Expr, detail::Power, Expr> &>(node)))
+        {
+          const auto &op = static_cast<const BinaryOp<Expr, detail::Power, Expr> &>(node);
+          f(*op._l, static_cast<const ConstantRT<double> &>(*op._r).get());
+        }
+        else
+          return false;
+        return true;
+      }
+
+      /*! \brief Calls end(node, weight) for each end of the chain of
+          operations of the kind Op starting at root.
+
+        The links of the chain are expanded from the top down. A link
+        with more than one reference may be reached along many paths
+        (e.g., f*f), so its weight is accumulated from all of its
+        parents in the chain before it is expanded, once. The ends are
+        called once per link leading to them.
+      */
+      template <typename Op, class End>
+      static void chain(const RTBase &root, End end)
+      {
+        auto is_shared = [](const RTBase &node)
+        { return node_use_count(&node) > 1; };
+        auto is_link = [](const RTBase &node)
+        { return links<Op>(node, [](const RTBase &, double) {}); };
+
+        //Count the parents in the chain of each shared link
+        std::unordered_map<const RTBase *, std::pair<std::size_t, ChainWeight>> shared;
+        Scratch<const RTBase *> stack;
+        stack->push_back(&root);
+        while (!stack->empty())
+        {
+          const RTBase &node = *stack->back();
+          stack->pop_back();
+          links<Op>(node, [&](const RTBase &child, double)
+                    {
+            if (!is_link(child))
+              return;
+            if (is_shared(child) && (shared[&child].first++ != 0))
+              return;
+            stack->push_back(&child); });
+        }
+
+        //Push the weights down the chain, in topological order
+        Scratch<std::pair<const RTBase *, ChainWeight>> weights;
+        weights->emplace_back(&root, ChainWeight{1, 0});
+        while (!weights->empty())
+        {
+          const RTBase &node = *weights->back().first;
+          const ChainWeight w = weights->back().second;
+          weights->pop_back();
+          links<Op>(node, [&](const RTBase &child, double m)
+                    {
+            const ChainWeight cw = w.scaled(m);
+            auto it = shared.find(&child);
+            if (!is_link(child))
+              end(child, cw);
+            else if (it == shared.end())
+              weights->emplace_back(&child, cw);
+            else {
+              it->second.second += cw;
+              if (--it->second.first == 0)
+                weights->emplace_back(&child, it->second.second);
+            } });
+        }
+      }
+
+      /*! \brief Flatten the chain of operations of the kind Op
+          starting at root. */
+      template <typename Op>
+      Expr gather(const RTBase &root)
+      {
+        NaryBuilder<Op> builder;
+        chain<Op>(root, [&](const RTBase &node, const ChainWeight &w)
+                  {
+          const Expr e = visit_child(Expr(node));
+          if (w.positive != 0)
+            builder.add(e, w.positive);
+          if (w.negative != 0)
+            builder.add(e, w.negative);
+          if ((w.positive == 0) && (w.negative == 0))
+            builder.add(e, 0); });
+        return builder.finish();
+      }
+
+      /*! \brief Calls f with each node whose flattened result is
+          needed to flatten node, i.e., the ends of the chain it
+          starts or otherwise its operands. */
+      template <class F>
+      static void dependencies(const RTBase &node, F f)
+      {
+        auto end = [&](const RTBase &e, const ChainWeight &)
+        { f(e); };
+        if (links<detail::Add>(node, [](const RTBase &, double) {}))
+          chain<detail::Add>(node, end);
+        else if (links<detail::Multiply>(node, [](const RTBase &, double) {}))
+          chain<detail::Multiply>(node, end);
+        else
+        {
+          OperandsRT operands;
+          const std::size_t count = node.visit(operands);
+          for (std::size_t i(0); i < count; ++i)
+            f(operands.operand(i));
+        }
+      }
+
+      //! \brief Test if a power has a constant, integer exponent.
+      static bool integer_power(const BinaryOp<Expr, detail::Power, Expr> &op)
+      {
+        if (op._r->_type_idx != Type_index<ConstantRT<double>>::value)
+          return false;
+        const double n = static_cast<const ConstantRT<double> &>(*op._r).get();
+        return n == std::floor(n);
+      }
+    };
+  }
+
+  /*! \brief Convert the sums and products of an expression into
+      flattened, canonical \ref SumRT and \ref ProductRT nodes.
+
+    Chains of additions, subtractions and negations become a single
+    sum, and chains of multiplications, divisions and constant powers
+    become a single product. Numeric constants are folded, like terms
+    (and factors) are merged, and the terms are put in a canonical
+    order, so sums or products which only differ in the order of
+    their terms become equal. Terms are not cancelled where that
+    would change the value of the expression (e.g., x/x, see \ref
+    detail::NaryBuilder), which is left to \ref simplify.
+
+    \code{.cpp}
+    sym::Expr f = sym::flatten(sym::Expr("x+2*y+3*x-1")); //4*x+2*y-1, a single SumRT
+    sym::flatten(sym::Expr("y+x")) == sym::flatten(sym::Expr("x+y")); //true
+    \endcode
+
+    Long sums are then simplified, hashed, compared and evaluated in
+    time linear in their number of terms, and \ref simplify keeps
+    flattened nodes flat.
+   */
+  inline Expr flatten(const Expr &f)
+  {
+    detail::FlattenRT visitor;
+    //Each node is flattened after the nodes it depends on, so its
+    //visit finds their results in the memo rather than recursing
+    detail::Scratch<std::pair<const RTBase *, bool>> stack;
+    auto pending = [&](const RTBase &node)
+    { return !detail::SimplifyRT::is_leaf(node) && !visitor._memo.count(&node); };
+    if (pending(*f))
+      stack->emplace_back(f.get(), false);
+    while (!stack->empty())
+    {
+      auto &top = stack->back();
+      const RTBase &node = *top.first;
+      if (!pending(node))
+        stack->pop_back();
+      else if (!top.second)
+      {
+        top.second = true;
+        detail::FlattenRT::dependencies(node, [&](const RTBase &dep)
+                                        { if (pending(dep)) stack->emplace_back(&dep, false); });
+      }
+      else
+      {
+        stack->pop_back();
+        visitor.flattened(Expr(node));
+      }
+    }
+    return visitor.visit_child(f);
+  }
+
+  Expr derivative(const Expr &f, const VarRT &v);
+
+  /*! \brief Derivative of a flattened sum. */
+  inline Expr derivative(const SumRT &f, const VarRT &v)
+  {
+    detail::NaryBuilder<detail::Add> sum;
+    for (const auto &t : f._terms)
+      sum.add(derivative(t.first, v), t.second);
+    return sum.finish();
+  }
+
+  /*! \brief Derivative of a flattened product, by the product rule
+      over all of its factors. */
+  inline Expr derivative(const ProductRT &f, const VarRT &v)
+  {
+    detail::NaryBuilder<detail::Add> sum;
+    for (std::size_t i(0); i < f._terms.size(); ++i)
+    {
+      const Expr d = derivative(f._terms[i].first, v);
+      if ((d->_type_idx == detail::Type_index<ConstantRT<double>>::value) && (d.as<double>() == 0))
+        continue;
+
+      detail::NaryBuilder<detail::Multiply> term;
+      term.add(Expr(f._constant * f._terms[i].second));
+      term.add(d);
+      for (std::size_t j(0); j < f._terms.size(); ++j)
+        term.add(f._terms[j].first, f._terms[j].second - (i == j));
+      sum.add(term.finish());
+    }
+    return sum.finish();
+  }
+
   namespace detail
   {
     struct DerivativeRT : VisitorHelper<DerivativeRT>
@@ -996,83 +1599,231 @@ namespace sym
     return derivative(f, v.as<VarRT>());
   }
 
-  namespace detail
+  /*! \brief A mapping of runtime variables to consecutive slots.
+
+    This resolves a list of variables once, so that numerical
+    evaluation (see \ref fast_sub) can bind many variables to an
+    array of values. Variables are matched by name, which evaluation
+    only looks up once for each variable node of the expression (see
+    \ref detail::SlotCache). An expression which is evaluated many
+    times should be lowered to a \ref CompiledExpr, which resolves
+    every variable when it is compiled.
+   */
+  class VarSlots
   {
-    struct FastSubRT : VisitorHelper<FastSubRT>
+  public:
+    /*! \brief Assign each of the variables a slot, in order. */
+    VarSlots(const std::vector<Expr> &vars)
     {
-      FastSubRT(const VarRT &var, double replacement) : _var(var), _replacement(replacement) {}
+      for (const Expr &v : vars)
+      {
+        if (v->_type_idx != detail::Type_index<VarRT>::value)
+          stator_throw() << "Only variables can be assigned slots, not " << repr(v);
 
-      //By default, throw an exception!
-      template <class T>
-      Expr apply(const T &v) { stator_throw() << "fast_sub cannot operate on this (" << repr(v) << ") expression"; }
+        if (!_slots.emplace(static_cast<const VarRT &>(*v).getName(), _slots.size()).second)
+          stator_throw() << "The variable " << repr(v) << " is repeated in the slot list";
+      }
+    }
+
+    /*! \brief The slot of a variable. */
+    std::size_t operator[](const VarRT &v) const
+    {
+      auto it = _slots.find(v._name);
+      if (it == _slots.end())
+        stator_throw() << "Unexpected variable " << repr(v) << ", it has not been assigned a slot";
+      return it->second;
+    }
+
+    /*! \brief The number of slots. */
+    std::size_t size() const { return _slots.size(); }
+
+  private:
+    std::unordered_map<std::string, std::size_t> _slots;
+  };
 
-      Expr apply(const double &v)
+  namespace detail
+  {
+    /*! \brief Binds a single variable for fast_sub. */
+    struct FastSubVar
+    {
+      double operator()(const VarRT &v) const
       {
-        _intermediate = v;
-        return Expr();
+        if (v == _var)
+          return _replacement;
+        stator_throw() << "Unexpected variable " << repr(v) << " for fast_sub";
       }
 
-      //Variable matching
-      Expr apply(const VarRT &v)
+      const VarRT &_var;
+      double _replacement;
+    };
+
+    /*! \brief Resolves the variable nodes of an expression to their
+        slots, remembering the slot of each node so the name of a
+        variable is only looked up on its first visit.
+
+      The nodes are cached by address, in a small direct mapped table
+      which needs no allocation, thus the expression must outlive
+      the cache (as it does for the duration of an evaluation).
+     */
+    class SlotCache
+    {
+    public:
+      SlotCache(const VarSlots &slots) : _slots(slots) { _nodes.fill(nullptr); }
+
+      std::size_t operator()(const VarRT &v) const
       {
-        if (v == _var)
+        const std::size_t i = (reinterpret_cast<std::uintptr_t>(&v) / alignof(VarRT)) % _size;
+        if (_nodes[i] != &v)
         {
-          _intermediate = _replacement;
-          return Expr();
+          _slot[i] = _slots[v];
+          _nodes[i] = &v;
         }
-        stator_throw() << "Unexpected variable " << repr(v) << " for fast_sub";
+        return _slot[i];
       }
 
+      const VarSlots &slots() const { return _slots; }
+
+    private:
+      static constexpr std::size_t _size = 64;
+
+      const VarSlots &_slots;
+      mutable std::array<const VarRT *, _size> _nodes;
+      mutable std::array<std::size_t, _size> _slot;
+    };
+
+    /*! \brief Binds variables to an array of values by their slots for fast_sub. */
+    struct FastSubSlots
+    {
+      double operator()(const VarRT &v) const { return _values[_slots(v)]; }
+
+      SlotCache _slots;
+      const double *_values;
+    };
+
+    /*! \brief Numerical evaluation of an expression.
+
+      The expression is evaluated bottom up on the traversal stack,
+      thus no expressions are created (and, once the scratch stacks
+      of the thread are warmed up, no allocations are made for
+      trees). Shared subexpressions are evaluated once, and their
+      values remembered.
+     */
+    template <class Binding>
+    struct FastSubRT : PostOrderHelper<FastSubRT<Binding>, double>
+    {
+      static constexpr bool memoize_shared = true;
+
+      FastSubRT(const Binding &binding) : _binding(binding) {}
+
+      //By default, throw an exception!
+      template <class T>
+      double apply(const T &v) { stator_throw() << "fast_sub cannot operate on this (" << repr(v) << ") expression"; }
+
+      double apply(const double &v) { return v; }
+
+      //Variable matching
+      double apply(const VarRT &v) { return _binding(v); }
+
       template <typename Op>
-      auto apply(const UnaryOp<Expr, Op> &op) -> decltype(double(Op::apply(0.0)), Expr())
+      auto apply(const UnaryOp<Expr, Op> &) -> decltype(double(Op::apply(0.0)))
       {
-        op.getArg()->visit(*this);
-        _intermediate = Op::apply(_intermediate);
-        return Expr();
+        return Op::apply(this->operand(0));
       }
 
       template <typename Op>
-      Expr apply(const BinaryOp<Expr, Op, Expr> &op)
+      double apply(const BinaryOp<Expr, Op, Expr> &)
       {
-        op.getLHS()->visit(*this);
-        double lval = _intermediate;
-        op.getRHS()->visit(*this);
-        _intermediate = Op::apply(lval, _intermediate);
-        return Expr();
+        return Op::apply(this->operand(0), this->operand(1));
+      }
+
+      double apply(const SumRT &op)
+      {
+        double sum = op._constant;
+        for (std::size_t i(0); i < op._terms.size(); ++i)
+          sum += op._terms[i].second * this->operand(i);
+        return sum;
       }
 
-      Expr apply(const BinaryOp<Expr, detail::Equality, Expr> &op)
+      double apply(const ProductRT &op)
+      {
+        double product = op._constant;
+        for (std::size_t i(0); i < op._terms.size(); ++i)
+        {
+          const double v = this->operand(i);
+          const double a = op._terms[i].second;
+          product *= (a == 1) ? v : ((a == -1) ? 1 / v : ((a == 2) ? v * v : std::pow(v, a)));
+        }
+        return product;
+      }
+
+      double apply(const BinaryOp<Expr, detail::Equality, Expr> &op)
       {
         stator_throw() << "fast_sub cannot operate on this (" << repr(op) << ") expression";
       }
 
-      Expr apply(const BinaryOp<Expr, detail::ArrayAccess, Expr> &op)
+      double apply(const BinaryOp<Expr, detail::ArrayAccess, Expr> &op)
       {
         stator_throw() << "fast_sub cannot operate on this (" << repr(op) << ") expression";
       }
 
-      Expr apply(const BinaryOp<Expr, detail::Units, Expr> &op)
+      double apply(const BinaryOp<Expr, detail::Units, Expr> &op)
       {
         stator_throw() << "fast_sub cannot operate on this (" << repr(op) << ") expression";
       }
 
-      Expr apply(const BinaryOp<Expr, detail::Uncertainty, Expr> &op)
+      double apply(const BinaryOp<Expr, detail::Uncertainty, Expr> &op)
       {
         stator_throw() << "fast_sub cannot operate on this (" << repr(op) << ") expression";
       }
 
-      const VarRT &_var;
-      double _replacement;
-      double _intermediate;
+      const Binding &_binding;
     };
   }
 
   template <class Var>
   double fast_sub(const Expr &f, const EqualityOp<Var, double> &rel)
   {
-    detail::FastSubRT visitor(rel._var, rel._val);
-    f->visit(visitor);
-    return visitor._intermediate;
+    const Expr var(rel._l);
+    const detail::FastSubVar binding{static_cast<const VarRT &>(*var), rel._r};
+    detail::FastSubRT<detail::FastSubVar> visitor(binding);
+    return visitor.traverse(f);
+  }
+
+  /*! \brief Numerical evaluation of an expression with many variables.
+
+    This evaluates the expression directly, without substituting or
+    simplifying it, and each shared subexpression (see \ref cse) is
+    only evaluated once. No allocations are made after the first call
+    on a thread, unless the expression has shared subexpressions.
+
+    \code{.cpp}
+    sym::VarSlots slots({sym::Expr("x"), sym::Expr("y")});
+    const double values[] = {1.0, 2.0};
+    double r = sym::fast_sub(sym::Expr("x*y+1"), slots, values); //r=3
+    \endcode
+
+    \param f The expression to evaluate.
+    \param slots The variables of f.
+    \param values The value of each variable, indexed by its slot.
+   */
+  inline double fast_sub(const Expr &f, const VarSlots &slots, const double *values)
+  {
+    const detail::FastSubSlots binding{slots, values};
+    detail::FastSubRT<detail::FastSubSlots> visitor(binding);
+    return visitor.traverse(f);
+  }
+
+  /*! \brief Numerical evaluation of an expression with many variables.
+    
+    \param f The expression to evaluate.
+    \param slots The variables of f.
+    \param values The value of each variable, indexed by its slot.
+   */
+  inline double fast_sub(const Expr &f, const VarSlots &slots, const std::vector<double> &values)
+  {
+    if (values.size() != slots.size())
+      stator_throw() << "fast_sub expects " << slots.size() << " variable values, but was passed " << values.size();
+    return fast_sub(f, slots, values.data());
   }
 
   template <class RetType>
@@ -1120,6 +1871,10 @@ namespace sym
       return c.visit(static_cast<const DictRT &>(*this));
     case detail::Type_index<UnaryOp<Expr, detail::Negate>>::value:
       return c.visit(static_cast<const UnaryOp<Expr, detail::Negate> &>(*this));
+    case detail::Type_index<SumRT>::value:
+      return c.visit(static_cast<const SumRT &>(*this));
+    case detail::Type_index<ProductRT>::value:
+      return c.visit(static_cast<const ProductRT &>(*this));
     default:
       stator_throw() << "Unhandled type index (" << _type_idx << ") for the visitor";
     }
@@ -1166,13 +1921,31 @@ namespace sym
   namespace detail
   {
     template <class Config>
-    struct ReprVisitor : public sym::detail::VisitorHelper<ReprVisitor<Config>, std::string>
+    struct ReprVisitor : public PostOrderHelper<ReprVisitor<Config>, std::string>
     {
       template <class T>
       std::string apply(const T &rhs)
       {
         return repr<Config>(rhs);
       }
+
+      template <typename Op>
+      std::string apply(const UnaryOp<Expr, Op> &op)
+      {
+        return repr_unary<Config>(op, std::move(this->operand(0)));
+      }
+
+      template <typename Op>
+      std::string apply(const BinaryOp<Expr, Op, Expr> &op)
+      {
+        return repr_binary<Config>(op, std::move(this->operand(0)), std::move(this->operand(1)));
+      }
+
+      template <typename Op>
+      std::string apply(const NaryOp<Op> &op)
+      {
+        return repr_nary<Config>(op, &this->operand(0));
+      }
     };
   }
 
@@ -1180,7 +1953,7 @@ namespace sym
   std::string repr(const sym::RTBase &b)
   {
     detail::ReprVisitor<Config> visitor;
-    return b.visit(visitor);
+    return visitor.traverse(b);
   }
 
   /*! \brief Give a representation of an Expr. 
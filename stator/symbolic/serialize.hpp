@@ -0,0 +1,576 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stator/symbolic/runtime.hpp>
+#include <stator/hash.hpp>
+#include <stator/symbolic/mapped_file.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace sym {
+  /*! \brief A read-only view of an expression in the binary format
+      written by \ref serialize.
+
+    The format is a header followed by a table of nodes in
+    topological order (every operand precedes the nodes which use
+    it), and a data area of 64-bit words for the operands which do
+    not fit in the table. Shared subexpressions, and structurally
+    equal ones (other than arrays and dictionaries, which are
+    mutable), are written once.
+
+    \verbatim
+    header  char magic[8]; uint32 version; uint32 byte order mark;
+            uint64 nodes; uint64 data words; uint32 root; uint32 reserved;
+    node    uint32 type; uint32 count; uint64 data;
+    \endverbatim
+
+    The type of a node is its \ref detail::Type_index, and its data
+    holds:
+    - Constants: the bits of the double.
+    - Variables: the offset (in words) of the name, which is count bytes.
+    - Unary operators: the operand id.
+    - Binary operators: the left and right operand ids, in the low and high 32 bits.
+    - Arrays: the offset of the count element ids.
+    - Dictionaries: the offset of count/2 key and value id pairs, ordered by the hash then the repr of the keys.
+    - Sums and products: the offset of the constant, then the count
+      term ids, then their coefficients (or exponents).
+
+    Empty array elements and dictionary values have the id \ref
+    null (dictionary keys may not be empty, and sums and products
+    have at least one term). Values are stored in the byte order of the writer, and
+    images with the other byte order are rejected.
+
+    The image is validated on construction, after which the nodes
+    may be read directly (e.g., from a memory mapped file, see \ref
+    MappedFile) without building an \ref Expr, or converted with
+    \ref to_expr.
+  */
+  class ExprImage {
+  public:
+    static constexpr std::uint32_t version = 1;
+    static constexpr std::uint32_t null = ~std::uint32_t(0);
+    static constexpr std::size_t header_size = 40;
+    static constexpr std::size_t node_size = 16;
+
+    static const char* magic() { return "STATORX"; }
+
+    explicit ExprImage(std::string_view bytes):
+      _bytes(bytes)
+    {
+      if ((_bytes.size() < header_size) || std::memcmp(_bytes.data(), magic(), 8))
+	stator_throw() << "Not a serialized expression";
+      if (word<std::uint32_t>(8) != version)
+	stator_throw() << "Unsupported serialized expression version " << word<std::uint32_t>(8) << " (expected " << version << ")";
+      if (word<std::uint32_t>(12) != byte_order_mark)
+	stator_throw() << "Serialized expression has a different byte order";
+
+      _nodes = word<std::uint64_t>(16);
+      _words = word<std::uint64_t>(24);
+      _root = word<std::uint32_t>(32);
+      if ((_nodes >= null) || (_words > _bytes.size() / 8)
+	  || (_bytes.size() != header_size + _nodes * node_size + _words * 8))
+	stator_throw() << "Serialized expression is truncated or corrupt";
+      if ((_root != null) && (_root >= _nodes))
+	stator_throw() << "Serialized expression root " << _root << " is out of range";
+
+      for (std::uint32_t i(0); i < _nodes; ++i)
+	validate(i);
+    }
+
+    //! \brief The number of nodes.
+    std::size_t size() const { return _nodes; }
+
+    //! \brief The id of the root node (\ref null for an empty Expr).
+    std::uint32_t root() const { return _root; }
+
+    //! \brief The \ref detail::Type_index of a node.
+    int type(std::uint32_t id) const { return int(field<std::uint32_t>(id, 0)); }
+
+    /*! \brief The number of operands of a node (the ids read with
+        \ref operand), or the length of the name of a variable. */
+    std::size_t operands(std::uint32_t id) const { return field<std::uint32_t>(id, 4); }
+
+    /*! \brief The id of the j-th operand of a node.
+
+      For dictionaries, the keys are the even operands and their
+      values follow them.
+    */
+    std::uint32_t operand(std::uint32_t id, std::size_t j) const {
+      const std::uint64_t data = field<std::uint64_t>(id, 8);
+      switch (layout(type(id))) {
+      case Layout::Unary:
+	return std::uint32_t(data);
+      case Layout::Binary:
+	return std::uint32_t(data >> (32 * j));
+      case Layout::Nary:
+	return std::uint32_t(data_word<std::uint64_t>(data + 1 + j));
+      default:
+	return std::uint32_t(data_word<std::uint64_t>(data + j));
+      }
+    }
+
+    //! \brief The value of a constant, or the constant of a sum or product.
+    double constant(std::uint32_t id) const {
+      if (layout(type(id)) == Layout::Nary)
+	return data_word<double>(field<std::uint64_t>(id, 8));
+      return field<double>(id, 8);
+    }
+
+    //! \brief The coefficient (or exponent) of the j-th term of a sum (or product).
+    double coefficient(std::uint32_t id, std::size_t j) const {
+      return data_word<double>(field<std::uint64_t>(id, 8) + 1 + operands(id) + j);
+    }
+
+    //! \brief The name of a variable.
+    std::string_view name(std::uint32_t id) const {
+      return std::string_view(data_start() + 8 * field<std::uint64_t>(id, 8), operands(id));
+    }
+
+    //! \brief Rebuild the expression.
+    Expr to_expr() const;
+
+    //! \brief Written in the header to detect images from machines of the other byte order.
+    static constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+  private:
+    enum class Layout { Leaf, Name, Unary, Binary, Container, Nary, Unknown };
+
+    static Layout layout(int type) {
+      switch (type) {
+      case detail::Type_index<ConstantRT<double>>::value: return Layout::Leaf;
+      case detail::Type_index<VarRT>::value: return Layout::Name;
+      case detail::Type_index<UnaryOp<Expr, detail::Sine>>::value:
+      case detail::Type_index<UnaryOp<Expr, detail::Cosine>>::value:
+      case detail::Type_index<UnaryOp<Expr, detail::Log>>::value:
+      case detail::Type_index<UnaryOp<Expr, detail::Exp>>::value:
+      case detail::Type_index<UnaryOp<Expr, detail::Absolute>>::value:
+      case detail::Type_index<UnaryOp<Expr, detail::Arbsign>>::value:
+      case detail::Type_index<UnaryOp<Expr, detail::Negate>>::value:
+	return Layout::Unary;
+      case detail::Type_index<BinaryOp<Expr, detail::Add, Expr>>::value:
+      case detail::Type_index<BinaryOp<Expr, detail::Subtract, Expr>>::value:
+      case detail::Type_index<BinaryOp<Expr, detail::Multiply, Expr>>::value:
+      case detail::Type_index<BinaryOp<Expr, detail::Divide, Expr>>::value:
+      case detail::Type_index<BinaryOp<Expr, detail::Power, Expr>>::value:
+      case detail::Type_index<BinaryOp<Expr, detail::Equality, Expr>>::value:
+      case detail::Type_index<BinaryOp<Expr, detail::ArrayAccess, Expr>>::value:
+      case detail::Type_index<BinaryOp<Expr, detail::Units, Expr>>::value:
+      case detail::Type_index<BinaryOp<Expr, detail::Uncertainty, Expr>>::value:
+	return Layout::Binary;
+      case detail::Type_index<ArrayRT>::value:
+      case detail::Type_index<DictRT>::value:
+	return Layout::Container;
+      case detail::Type_index<SumRT>::value:
+      case detail::Type_index<ProductRT>::value:
+	return Layout::Nary;
+      default:
+	return Layout::Unknown;
+      }
+    }
+
+    template<class T>
+    T word(std::size_t offset) const {
+      T v;
+      std::memcpy(&v, _bytes.data() + offset, sizeof(T));
+      return v;
+    }
+
+    template<class T>
+    T field(std::uint32_t id, std::size_t offset) const { return word<T>(header_size + node_size * std::size_t(id) + offset); }
+
+    const char* data_start() const { return _bytes.data() + header_size + node_size * _nodes; }
+
+    template<class T>
+    T data_word(std::uint64_t w) const {
+      T v;
+      std::memcpy(&v, data_start() + 8 * w, sizeof(T));
+      return v;
+    }
+
+    void validate(std::uint32_t id) const {
+      const Layout l = layout(type(id));
+      const std::uint32_t count = field<std::uint32_t>(id, 4);
+      const std::uint64_t data = field<std::uint64_t>(id, 8);
+      //Operands must precede their users, so that the image is acyclic
+      auto check_id = [&](std::uint32_t o, bool nullable) {
+	if ((o >= id) && !(nullable && (o == null)))
+	  stator_throw() << "Serialized expression node " << id << " has an invalid operand " << o;
+      };
+      auto check_words = [&](std::uint64_t n) {
+	if ((data > _words) || (n > _words - data))
+	  stator_throw() << "Serialized expression node " << id << " data is out of range";
+      };
+
+      switch (l) {
+      case Layout::Leaf:
+	break;
+      case Layout::Name:
+	check_words((std::uint64_t(count) + 7) / 8);
+	break;
+      case Layout::Unary:
+      case Layout::Binary:
+	if (count != ((l == Layout::Unary) ? 1u : 2u))
+	  stator_throw() << "Serialized expression node " << id << " has the wrong number of operands";
+	for (std::uint32_t j(0); j < count; ++j)
+	  check_id(operand(id, j), false);
+	break;
+      case Layout::Container:
+	if ((type(id) == detail::Type_index<DictRT>::value) && (count % 2))
+	  stator_throw() << "Serialized expression dictionary " << id << " has an unpaired key";
+	check_words(count);
+	//Array elements and dictionary values may be empty, but keys may not
+	for (std::uint32_t j(0); j < count; ++j)
+	  check_id(operand(id, j), (type(id) == detail::Type_index<ArrayRT>::value) || (j % 2));
+	break;
+      case Layout::Nary:
+	//Sums and products are built with at least one term
+	if (!count)
+	  stator_throw() << "Serialized expression node " << id << " has no terms";
+	check_words(1 + 2 * std::uint64_t(count));
+	for (std::uint32_t j(0); j < count; ++j)
+	  check_id(operand(id, j), false);
+	break;
+      default:
+	stator_throw() << "Serialized expression node " << id << " has an unknown type " << type(id);
+      }
+    }
+
+    std::string_view _bytes;
+    std::uint64_t _nodes;
+    std::uint64_t _words;
+    std::uint32_t _root;
+  };
+
+  namespace detail {
+    /*! \brief Writes the nodes of expressions to an \ref ExprImage,
+        returning the id of each node visited.
+
+      The node table is deduplicated by content. As operands are
+      written first, equal records mean structurally equal
+      subexpressions. Nodes with more than one reference are also
+      remembered by identity, so shared subexpressions are only
+      traversed once (a node with a single reference can only be
+      reached once).
+    */
+    class ImageWriter : public VisitorHelper<ImageWriter, std::uint32_t> {
+    public:
+      std::uint32_t write(const Expr& e) {
+	if (!e)
+	  return ExprImage::null;
+
+	Scratch<std::uint32_t> results;
+	post_order(*e, [&](const RTBase& node) {
+		     if (node._refs.count() > 1) {
+		       auto it = _shared.find(&node);
+		       if (it != _shared.end()) {
+			 results->push_back(it->second);
+			 return false;
+		       }
+		     }
+		     return true;
+		   },
+		   [&](const RTBase& node, std::size_t count) {
+		     _operands = results->data() + (results->size() - count);
+		     const std::uint32_t id = node.visit(*this);
+		     results->resize(results->size() - count);
+		     results->push_back(id);
+		     if (node._refs.count() > 1)
+		       _shared.emplace(&node, id);
+		   });
+	return results->back();
+      }
+
+      //! \brief The image, once all expressions have been written.
+      std::string finish(std::uint32_t root) const {
+	std::string out;
+	out.reserve(ExprImage::header_size + ExprImage::node_size * _nodes.size() + 8 * _data.size());
+	out.append(ExprImage::magic(), 8);
+	append(out, ExprImage::version);
+	append(out, ExprImage::byte_order_mark);
+	append(out, std::uint64_t(_nodes.size()));
+	append(out, std::uint64_t(_data.size()));
+	append(out, root);
+	append(out, std::uint32_t(0));
+	for (const Record& r : _nodes) {
+	  append(out, r.type);
+	  append(out, r.count);
+	  append(out, r.data);
+	}
+	out.append(reinterpret_cast<const char*>(_data.data()), 8 * _data.size());
+	return out;
+      }
+
+      std::uint32_t apply(const double& v) {
+	std::uint64_t bits;
+	std::memcpy(&bits, &v, 8);
+	return node(Record{std::uint32_t(Type_index<ConstantRT<double>>::value), 0, bits});
+      }
+
+      std::uint32_t apply(const VarRT& v) {
+	const std::string& name = v._name;
+	const std::size_t start = _data.size();
+	_data.resize(start + (name.size() + 7) / 8, 0);
+	std::memcpy(_data.data() + start, name.data(), name.size());
+	return payload_node(Record{std::uint32_t(Type_index<VarRT>::value), std::uint32_t(name.size()), start});
+      }
+
+      template<class Op>
+      std::uint32_t apply(const UnaryOp<Expr, Op>& op) {
+	return node(Record{std::uint32_t(Type_index<UnaryOp<Expr, Op>>::value), 1, _operands[0]});
+      }
+
+      template<class Op>
+      std::uint32_t apply(const BinaryOp<Expr, Op, Expr>& op) {
+	return node(Record{std::uint32_t(Type_index<BinaryOp<Expr, Op, Expr>>::value), 2, _operands[0] | (std::uint64_t(_operands[1]) << 32)});
+      }
+
+      template<class Op>
+      std::uint32_t apply(const NaryOp<Op>& op) {
+	const std::size_t start = _data.size();
+	push(op._constant);
+	_data.insert(_data.end(), _operands, _operands + op._terms.size());
+	for (const auto& t : op._terms)
+	  push(t.second);
+	return payload_node(Record{std::uint32_t(Type_index<NaryOp<Op>>::value), std::uint32_t(op._terms.size()), start});
+      }
+
+      //Containers are mutable, so they are never merged, and their
+      //elements are separate expressions which are written first
+      std::uint32_t apply(const ArrayRT& a) {
+	std::vector<std::uint32_t> elements;
+	elements.reserve(a.getStore().size());
+	for (const Expr& e : a.getStore())
+	  elements.push_back(write(e));
+	return container(Type_index<ArrayRT>::value, elements);
+      }
+
+      //The entries are written ordered by the hash and then the repr
+      //of their keys, so the image does not depend on the iteration
+      //order of the hash map
+      std::uint32_t apply(const DictRT& d) {
+	std::vector<std::tuple<std::size_t, std::string, const Expr*, const Expr*>> order;
+	order.reserve(d.size());
+	for (const auto& kv : d)
+	  order.emplace_back(std::hash<Expr>{}(kv.first), repr(kv.first), &kv.first, &kv.second);
+	std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+	    return std::tie(std::get<0>(a), std::get<1>(a)) < std::tie(std::get<0>(b), std::get<1>(b));
+	  });
+
+	std::vector<std::uint32_t> entries;
+	entries.reserve(2 * d.size());
+	for (const auto& e : order) {
+	  entries.push_back(write(*std::get<2>(e)));
+	  entries.push_back(write(*std::get<3>(e)));
+	}
+	return container(Type_index<DictRT>::value, entries);
+      }
+
+    private:
+      struct Record {
+	bool operator==(const Record& o) const { return (type == o.type) && (count == o.count) && (data == o.data); }
+
+	std::uint32_t type;
+	std::uint32_t count;
+	std::uint64_t data;
+      };
+
+      struct RecordHash {
+	std::size_t operator()(const Record& r) const {
+	  std::size_t seed = r.type;
+	  stator::hash_combine(seed, r.count);
+	  stator::hash_combine(seed, r.data);
+	  return seed;
+	}
+      };
+
+      template<class T>
+      static void append(std::string& out, const T& v) { out.append(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+      void push(double v) {
+	std::uint64_t bits;
+	std::memcpy(&bits, &v, 8);
+	_data.push_back(bits);
+      }
+
+      std::uint32_t add(const Record& r) {
+	if (_nodes.size() >= ExprImage::null)
+	  stator_throw() << "Expression has too many nodes to serialize";
+	_nodes.push_back(r);
+	return std::uint32_t(_nodes.size() - 1);
+      }
+
+      //! \brief Add a node whose record holds all of its content.
+      std::uint32_t node(const Record& r) {
+	auto it = _records.find(r);
+	if (it != _records.end())
+	  return it->second;
+	const std::uint32_t i = add(r);
+	_records.emplace(r, i);
+	return i;
+      }
+
+      /*! \brief Add a node whose content has just been appended to
+          the data area (at r.data), dropping the content if an equal
+          node exists. */
+      std::uint32_t payload_node(const Record& r) {
+	std::string key(sizeof(r.type), '\0');
+	std::memcpy(&key[0], &r.type, sizeof(r.type));
+	key.append(reinterpret_cast<const char*>(_data.data() + r.data), 8 * (_data.size() - r.data));
+	auto it = _payloads.find(key);
+	if (it != _payloads.end()) {
+	  _data.resize(r.data);
+	  return it->second;
+	}
+	const std::uint32_t i = add(r);
+	_payloads.emplace(std::move(key), i);
+	return i;
+      }
+
+      std::uint32_t container(int type, const std::vector<std::uint32_t>& ids) {
+	const std::size_t start = _data.size();
+	_data.insert(_data.end(), ids.begin(), ids.end());
+	return add(Record{std::uint32_t(type), std::uint32_t(ids.size()), start});
+      }
+
+      std::vector<Record> _nodes;
+      std::vector<std::uint64_t> _data;
+      std::unordered_map<const RTBase*, std::uint32_t> _shared;
+      //! \brief The ids of the operands of the node being written.
+      const std::uint32_t* _operands = nullptr;
+      std::unordered_map<Record, std::uint32_t, RecordHash> _records;
+      std::unordered_map<std::string, std::uint32_t> _payloads;
+    };
+
+    template<class Op>
+    Expr image_unary(const Expr& a) { return Expr(UnaryOp<Expr, Op>::create(a)); }
+
+    template<class Op>
+    Expr image_binary(const Expr& l, const Expr& r) { return Expr(BinaryOp<Expr, Op, Expr>::create(l, r)); }
+  }
+
+  inline Expr ExprImage::to_expr() const {
+    if (_root == null)
+      return Expr();
+
+    std::vector<Expr> nodes(_nodes);
+    auto get = [&](std::uint32_t id) { return (id == null) ? Expr() : nodes[id]; };
+    for (std::uint32_t i(0); i < _nodes; ++i) {
+      const int t = type(i);
+      switch (t) {
+      case detail::Type_index<ConstantRT<double>>::value:
+	nodes[i] = Expr(ConstantRT<double>::create(constant(i)));
+	break;
+      case detail::Type_index<VarRT>::value:
+	nodes[i] = Expr(VarRT::create(std::string(name(i))));
+	break;
+      case detail::Type_index<UnaryOp<Expr, detail::Sine>>::value: nodes[i] = detail::image_unary<detail::Sine>(nodes[operand(i, 0)]); break;
+      case detail::Type_index<UnaryOp<Expr, detail::Cosine>>::value: nodes[i] = detail::image_unary<detail::Cosine>(nodes[operand(i, 0)]); break;
+      case detail::Type_index<UnaryOp<Expr, detail::Log>>::value: nodes[i] = detail::image_unary<detail::Log>(nodes[operand(i, 0)]); break;
+      case detail::Type_index<UnaryOp<Expr, detail::Exp>>::value: nodes[i] = detail::image_unary<detail::Exp>(nodes[operand(i, 0)]); break;
+      case detail::Type_index<UnaryOp<Expr, detail::Absolute>>::value: nodes[i] = detail::image_unary<detail::Absolute>(nodes[operand(i, 0)]); break;
+      case detail::Type_index<UnaryOp<Expr, detail::Arbsign>>::value: nodes[i] = detail::image_unary<detail::Arbsign>(nodes[operand(i, 0)]); break;
+      case detail::Type_index<UnaryOp<Expr, detail::Negate>>::value: nodes[i] = detail::image_unary<detail::Negate>(nodes[operand(i, 0)]); break;
+      case detail::Type_index<BinaryOp<Expr, detail::Add, Expr>>::value: nodes[i] = detail::image_binary<detail::Add>(nodes[operand(i, 0)], nodes[operand(i, 1)]); break;
+      case detail::Type_index<BinaryOp<Expr, detail::Subtract, Expr>>::value: nodes[i] = detail::image_binary<detail::Subtract>(nodes[operand(i, 0)], nodes[operand(i, 1)]); break;
+      case detail::Type_index<BinaryOp<Expr, detail::Multiply, Expr>>::value: nodes[i] = detail::image_binary<detail::Multiply>(nodes[operand(i, 0)], nodes[operand(i, 1)]); break;
+      case detail::Type_index<BinaryOp<Expr, detail::Divide, Expr>>::value: nodes[i] = detail::image_binary<detail::Divide>(nodes[operand(i, 0)], nodes[operand(i, 1)]); break;
+      case detail::Type_index<BinaryOp<Expr, detail::Power, Expr>>::value: nodes[i] = detail::image_binary<detail::Power>(nodes[operand(i, 0)], nodes[operand(i, 1)]); break;
+      case detail::Type_index<BinaryOp<Expr, detail::Equality, Expr>>::value: nodes[i] = detail::image_binary<detail::Equality>(nodes[operand(i, 0)], nodes[operand(i, 1)]); break;
+      case detail::Type_index<BinaryOp<Expr, detail::ArrayAccess, Expr>>::value: nodes[i] = detail::image_binary<detail::ArrayAccess>(nodes[operand(i, 0)], nodes[operand(i, 1)]); break;
+      case detail::Type_index<BinaryOp<Expr, detail::Units, Expr>>::value: nodes[i] = detail::image_binary<detail::Units>(nodes[operand(i, 0)], nodes[operand(i, 1)]); break;
+      case detail::Type_index<BinaryOp<Expr, detail::Uncertainty, Expr>>::value: nodes[i] = detail::image_binary<detail::Uncertainty>(nodes[operand(i, 0)], nodes[operand(i, 1)]); break;
+      case detail::Type_index<ArrayRT>::value: {
+	auto a_ptr = ArrayRT::create(operands(i));
+	auto& a = *a_ptr;
+	for (std::size_t j(0); j < operands(i); ++j)
+	  a[j] = get(operand(i, j));
+	nodes[i] = Expr(a_ptr);
+	break;
+      }
+      case detail::Type_index<DictRT>::value: {
+	auto d_ptr = DictRT::create();
+	auto& d = *d_ptr;
+	for (std::size_t j(0); j < operands(i); j += 2)
+	  d[get(operand(i, j))] = get(operand(i, j + 1));
+	nodes[i] = Expr(d_ptr);
+	break;
+      }
+      case detail::Type_index<SumRT>::value:
+      case detail::Type_index<ProductRT>::value: {
+	std::vector<std::pair<Expr, double>> terms;
+	terms.reserve(operands(i));
+	for (std::size_t j(0); j < operands(i); ++j)
+	  terms.emplace_back(nodes[operand(i, j)], coefficient(i, j));
+	if (t == detail::Type_index<SumRT>::value)
+	  nodes[i] = Expr(SumRT::create(constant(i), std::move(terms)));
+	else
+	  nodes[i] = Expr(ProductRT::create(constant(i), std::move(terms)));
+	break;
+      }
+      }
+    }
+    return nodes[_root];
+  }
+
+  /*! \brief Write an expression in the binary \ref ExprImage format.
+
+    Unlike the text form (\ref repr), the result can be loaded
+    without parsing, and round trips exactly (e.g., the bits of every
+    constant and the order of the terms of sums are kept). The one
+    exception is the iteration order of dictionaries, which is that
+    of their hash map. Dictionary entries are written ordered by the
+    hash and then the \ref repr of their keys, so equal expressions
+    have equal images.
+  */
+  inline std::string serialize(const Expr& f) {
+    detail::ImageWriter writer;
+    const std::uint32_t root = writer.write(f);
+    return writer.finish(root);
+  }
+
+  //! \brief Load an expression written by \ref serialize.
+  inline Expr deserialize(std::string_view bytes) {
+    return ExprImage(bytes).to_expr();
+  }
+
+  //! \brief Write an expression to a file in the binary \ref ExprImage format.
+  inline void save(const Expr& f, const std::string& filename) {
+    const std::string bytes = serialize(f);
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), std::streamsize(bytes.size()));
+    if (!out)
+      stator_throw() << "Could not write " << filename;
+  }
+
+  //! \brief Load an expression written by \ref save, mapping the file into memory.
+  inline Expr load(const std::string& filename) {
+    MappedFile file(filename);
+    return deserialize(file.bytes());
+  }
+}
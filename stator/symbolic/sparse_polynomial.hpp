@@ -0,0 +1,619 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stator/symbolic/runtime.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sym {
+  namespace detail {
+    struct PolynomialRT;
+  }
+
+  /*! \brief A sparse multivariate polynomial with numeric
+      coefficients.
+
+    The polynomial is a hash map from monomials to their
+    coefficients, where a monomial lists the generators it contains
+    and their exponents. Generators are usually variables, but may be
+    any expression which is not itself a polynomial (e.g., sin(x) or
+    1/x). Monomials are sparse too, so their cost depends on the
+    number of generators they contain, not on the total number of
+    generators.
+
+    Unlike \ref Polynomial, the variables and the order are chosen at
+    runtime and only the non-zero terms are stored. Addition and
+    multiplication collect like terms by hashing, so multiplying sums
+    of n and m terms takes O(n*m) time.
+
+    \code{.cpp}
+    sym::SparsePolynomial p(sym::Expr("(x+y)^2")); //x^2+2*x*y+y^2
+    p.size(); //3
+    sym::Expr f = (p * p).to_expr(); //x^4+4*x^3*y+6*x^2*y^2+4*x*y^3+y^4
+    \endcode
+
+    See also \ref expand.
+   */
+  class SparsePolynomial {
+  public:
+    /*! \brief The index of each generator in a monomial, and its
+        (non-zero) exponent, sorted by index. */
+    typedef std::vector<std::pair<unsigned, unsigned> > Monomial;
+
+    /*! \brief The largest integer power of a non-constant expression
+        which is expanded when converting it into a polynomial.
+
+      Larger powers (e.g., (x+y)^1000) are kept whole, as generators.
+      This alone does not bound the size of the expansion (e.g.,
+      (a+b+c+d+e+f+g+h+i+j)^64 has over 10^11 terms), see \ref
+      max_expanded_terms.
+    */
+    static constexpr unsigned max_expanded_power = 64;
+
+    /*! \brief The largest number of terms, estimated from the sizes
+        of the operands, of a product or power which is expanded when
+        converting an expression into a polynomial.
+
+      Larger products and powers keep (one of) their operands whole,
+      as a generator, so no single product or power is multiplied
+      out beyond this, even for nested powers such as
+      ((x+y+z)^64)^64. Sums of these are not limited.
+    */
+    static constexpr std::size_t max_expanded_terms = std::size_t(1) << 20;
+
+    struct MonomialHash {
+      std::size_t operator()(const Monomial& m) const {
+	std::size_t seed = m.size();
+	for (const auto& p : m) {
+	  stator::hash_combine(seed, p.first);
+	  stator::hash_combine(seed, p.second);
+	}
+	return seed;
+      }
+    };
+
+    //! \brief The non-zero coefficient of each monomial.
+    typedef std::unordered_map<Monomial, double, MonomialHash> Terms;
+
+    //! \brief The zero polynomial.
+    SparsePolynomial() {}
+
+    //! \brief A constant polynomial.
+    SparsePolynomial(double c) {
+      if (c != 0)
+	_terms.emplace(Monomial(), c);
+    }
+
+    /*! \brief Construct a polynomial from its terms.
+
+      \param generators The generators which the monomials refer to.
+      \param terms The terms, which must not have zero coefficients
+      (or zero exponents).
+     */
+    SparsePolynomial(std::vector<Expr> generators, Terms terms):
+      _generators(std::move(generators)), _terms(std::move(terms))
+    {}
+
+    /*! \brief Convert an expression into a polynomial.
+
+      Sums, differences, products, division by constants and
+      non-negative integer powers are expanded. Division by, and
+      negative integer powers of, other expressions are collected
+      into the generator 1/g (so x/y is x*(1/y)), and all remaining
+      subexpressions (e.g., sin(x+1) or x^(1/2)) are generators as
+      they are.
+     */
+    explicit SparsePolynomial(const Expr& f);
+
+    //! \brief The polynomial g, for a generator g.
+    static SparsePolynomial generator(const Expr& g) { return SparsePolynomial({g}, Terms{{Monomial{{0, 1}}, 1.0}}); }
+
+    const std::vector<Expr>& generators() const { return _generators; }
+
+    const Terms& terms() const { return _terms; }
+
+    //! \brief The number of (non-zero) terms.
+    std::size_t size() const { return _terms.size(); }
+
+    /*! \brief The coefficient of a monomial.
+
+      \param exponents The exponent of each of the \ref generators.
+     */
+    double coefficient(const std::vector<unsigned>& exponents) const {
+      Monomial key;
+      for (std::size_t i(0); i < exponents.size(); ++i)
+	if (exponents[i])
+	  key.emplace_back(unsigned(i), exponents[i]);
+      auto it = _terms.find(key);
+      return (it == _terms.end()) ? 0 : it->second;
+    }
+
+    //! \brief The total degree, which is zero for the zero polynomial.
+    unsigned degree() const {
+      unsigned d = 0;
+      for (const auto& t : _terms) {
+	unsigned sum = 0;
+	for (const auto& p : t.first)
+	  sum += p.second;
+	d = std::max(d, sum);
+      }
+      return d;
+    }
+
+    /*! \brief Convert the polynomial into a flattened expression
+        (see \ref flatten), a \ref SumRT of \ref ProductRT terms. */
+    Expr to_expr() const;
+
+    SparsePolynomial& operator+=(const SparsePolynomial& o) { return add(o, 1); }
+    SparsePolynomial& operator-=(const SparsePolynomial& o) { return add(o, -1); }
+
+    SparsePolynomial& operator*=(double c) {
+      if (c == 0)
+	_terms.clear();
+      for (auto& t : _terms)
+	t.second *= c;
+      return *this;
+    }
+
+    SparsePolynomial& operator*=(const SparsePolynomial& o) {
+      std::vector<unsigned> index;
+      if (align(o, index))
+	_terms = multiply(_terms, o._terms);
+      else
+	_terms = multiply(_terms, remap(o._terms, index));
+      return *this;
+    }
+
+    friend SparsePolynomial operator+(SparsePolynomial l, const SparsePolynomial& r) { return l += r; }
+    friend SparsePolynomial operator-(SparsePolynomial l, const SparsePolynomial& r) { return l -= r; }
+    friend SparsePolynomial operator*(SparsePolynomial l, const SparsePolynomial& r) { return l *= r; }
+    friend SparsePolynomial operator*(SparsePolynomial l, double r) { return l *= r; }
+    friend SparsePolynomial operator*(double l, SparsePolynomial r) { return r *= l; }
+    friend SparsePolynomial operator-(SparsePolynomial p) { return p *= -1; }
+
+    //! \brief Raise a polynomial to a non-negative integer power.
+    friend SparsePolynomial pow(const SparsePolynomial& p, unsigned n) { return SparsePolynomial(p._generators, power(p._terms, n)); }
+
+    //! \brief Compare the terms, whatever the order of the generators.
+    bool operator==(const SparsePolynomial& o) const { return (*this - o)._terms.empty(); }
+    bool operator!=(const SparsePolynomial& o) const { return !(*this == o); }
+
+    //! \brief Add c*t to the terms.
+    static void add(Terms& terms, const Terms& t, double c) {
+      for (const auto& term : t) {
+	auto it = terms.find(term.first);
+	if (it == terms.end())
+	  terms.emplace(term.first, c * term.second);
+	else if ((it->second += c * term.second) == 0)
+	  terms.erase(it);
+      }
+    }
+
+    /*! \brief The product of two sets of terms.
+
+      Throws if an exponent of the product would not fit in an
+      unsigned (see \ref max_exponent).
+     */
+    static Terms multiply(const Terms& a, const Terms& b) {
+      Terms result;
+      result.reserve(std::max(a.size(), b.size()));
+      Monomial m;
+      for (const auto& x : a)
+	for (const auto& y : b) {
+	  //Merge the sorted generators
+	  m.clear();
+	  auto i = x.first.begin(), j = y.first.begin();
+	  while ((i != x.first.end()) && (j != y.first.end()))
+	    if (i->first < j->first)
+	      m.push_back(*i++);
+	    else if (j->first < i->first)
+	      m.push_back(*j++);
+	    else {
+	      if (i->second > std::numeric_limits<unsigned>::max() - j->second)
+		stator_throw() << "SparsePolynomial exponent overflow";
+	      m.emplace_back(i->first, i->second + j->second);
+	      ++i;
+	      ++j;
+	    }
+	  m.insert(m.end(), i, x.first.end());
+	  m.insert(m.end(), j, y.first.end());
+
+	  auto it = result.find(m);
+	  if (it == result.end())
+	    result.emplace(m, x.second * y.second);
+	  else
+	    it->second += x.second * y.second;
+	}
+
+      //Drop the terms which cancelled
+      for (auto it = result.begin(); it != result.end();)
+	it = (it->second == 0) ? result.erase(it) : std::next(it);
+      return result;
+    }
+
+    //! \brief The largest exponent of any generator in the terms.
+    static unsigned max_exponent(const Terms& t) {
+      unsigned e = 0;
+      for (const auto& term : t)
+	for (const auto& p : term.first)
+	  e = std::max(e, p.second);
+      return e;
+    }
+
+    //! \brief The terms raised to a non-negative integer power, by squaring.
+    static Terms power(const Terms& t, unsigned n) {
+      Terms result{{Monomial(), 1.0}};
+      if (n == 0)
+	return result;
+      Terms base = t;
+      while (true) {
+	if (n & 1)
+	  result = multiply(result, base);
+	n >>= 1;
+	if (!n)
+	  return result;
+	base = multiply(base, base);
+      }
+    }
+
+  private:
+    SparsePolynomial& add(const SparsePolynomial& o, double c) {
+      if (&o == this)
+	return *this *= (1 + c);
+      std::vector<unsigned> index;
+      if (align(o, index))
+	add(_terms, o._terms, c);
+      else
+	add(_terms, remap(o._terms, index), c);
+      return *this;
+    }
+
+    /*! \brief Add the generators of o to this polynomial.
+
+      \param index Set to the new index of each generator of o, if
+      they have moved.
+      \return True if the generators of o are a prefix of the
+      generators of this polynomial, so its monomials can be used
+      as they are.
+     */
+    bool align(const SparsePolynomial& o, std::vector<unsigned>& index) {
+      auto same = [](const Expr& a, const Expr& b) { return (a.get() == b.get()) || (a == b); };
+      const std::size_t common = std::min(_generators.size(), o._generators.size());
+      if (std::equal(_generators.begin(), _generators.begin() + common, o._generators.begin(), same)) {
+	//The common case, where the polynomials were built together
+	if (o._generators.size() > _generators.size())
+	  _generators = o._generators;
+	return true;
+      }
+
+      for (const Expr& g : o._generators) {
+	auto it = std::find_if(_generators.begin(), _generators.end(), [&](const Expr& h) { return same(g, h); });
+	index.push_back(unsigned(it - _generators.begin()));
+	if (it == _generators.end())
+	  _generators.push_back(g);
+      }
+      return false;
+    }
+
+    //! \brief Move the exponents of each monomial to new indices.
+    static Terms remap(const Terms& terms, const std::vector<unsigned>& index) {
+      Terms result;
+      result.reserve(terms.size());
+      for (const auto& t : terms) {
+	Monomial m(t.first);
+	for (auto& p : m)
+	  p.first = index[p.first];
+	std::sort(m.begin(), m.end());
+	result.emplace(std::move(m), t.second);
+      }
+      return result;
+    }
+
+    friend struct detail::PolynomialRT;
+
+    std::vector<Expr> _generators;
+    Terms _terms;
+  };
+
+  namespace detail {
+    /*! \brief The expression of a sum of terms, as a flattened \ref
+        SumRT of \ref ProductRT monomials. */
+    inline Expr terms_expr(const std::vector<Expr>& generators, const SparsePolynomial::Terms& terms) {
+      NaryBuilder<Add> sum;
+      for (const auto& t : terms) {
+	NaryBuilder<Multiply> product;
+	product.add(Expr(t.second));
+	for (const auto& p : t.first)
+	  product.add(generators[p.first], p.second);
+	sum.add(product.finish());
+      }
+      return sum.finish();
+    }
+
+    /*! \brief Converts an expression into the terms of a \ref
+        SparsePolynomial, bottom up.
+
+      The generators are shared by all of the intermediate
+      polynomials, so they combine without realignment. If
+      expanding, the arguments of the generators are expanded too.
+     */
+    struct PolynomialRT : PostOrderHelper<PolynomialRT, SparsePolynomial::Terms> {
+      typedef SparsePolynomial::Terms Terms;
+      typedef SparsePolynomial::Monomial Monomial;
+
+      PolynomialRT(bool expand_arguments): _expand(expand_arguments) {}
+
+      /*! \brief Finds the nodes which are always generators, thus
+          kept whole if their arguments are not expanded. */
+      struct GeneratorRT : VisitorHelper<GeneratorRT, bool> {
+	template<class T>
+	bool apply(const T&) { return false; }
+
+	template<typename Op>
+	bool apply(const UnaryOp<Expr, Op>&) { return !std::is_same<Op, Negate>::value; }
+
+	template<typename Op>
+	bool apply(const BinaryOp<Expr, Op, Expr>&) {
+	  return !std::is_same<Op, Add>::value && !std::is_same<Op, Subtract>::value && !std::is_same<Op, Multiply>::value
+	    && !std::is_same<Op, Divide>::value && !std::is_same<Op, Power>::value;
+	}
+      };
+
+      //The operands of generators are not needed unless expanding
+      bool skip_operands(const RTBase& node) {
+	GeneratorRT visitor;
+	return !_expand && node.visit(visitor);
+      }
+
+      Terms apply(const double& v) { return SparsePolynomial(v)._terms; }
+
+      //Everything else is a generator
+      template<class T>
+      Terms apply(const T& v) { return generator(Expr(static_cast<const RTBase&>(v))); }
+
+      template<typename Op>
+      Terms apply(const UnaryOp<Expr, Op>& op) {
+	if (!_expand)
+	  return generator(Expr(static_cast<const RTBase&>(op)));
+	Expr arg = argument(0, op._arg);
+	return generator((arg.get() == op._arg.get()) ? Expr(static_cast<const RTBase&>(op)) : Expr(UnaryOp<Expr, Op>::create(arg)));
+      }
+
+      Terms apply(const UnaryOp<Expr, Negate>&) {
+	Terms result = std::move(operand(0));
+	for (auto& t : result)
+	  t.second = -t.second;
+	return result;
+      }
+
+      template<typename Op>
+      Terms apply(const BinaryOp<Expr, Op, Expr>& op) {
+	if (!_expand)
+	  return generator(Expr(static_cast<const RTBase&>(op)));
+	Expr l = argument(0, op._l);
+	Expr r = argument(1, op._r);
+	if ((l.get() == op._l.get()) && (r.get() == op._r.get()))
+	  return generator(Expr(static_cast<const RTBase&>(op)));
+	return generator(Expr(BinaryOp<Expr, Op, Expr>::create(l, r)));
+      }
+
+      Terms apply(const BinaryOp<Expr, Add, Expr>&) { return sum(1); }
+      Terms apply(const BinaryOp<Expr, Subtract, Expr>&) { return sum(-1); }
+      Terms apply(const BinaryOp<Expr, Multiply, Expr>& op) { return times(operand(0), 1, op._r); }
+
+      Terms apply(const BinaryOp<Expr, Divide, Expr>& op) {
+	double c;
+	if (constant(operand(1), c) && (c != 0)) {
+	  Terms result = std::move(operand(0));
+	  for (auto& t : result)
+	    t.second /= c;
+	  return result;
+	}
+	return SparsePolynomial::multiply(operand(0), generator(inverse(argument(1, op._r))));
+      }
+
+      Terms apply(const BinaryOp<Expr, Power, Expr>& op) {
+	double n;
+	if (constant(operand(1), n) && expandable(0, n))
+	  return raise(0, op._l, n);
+
+	Expr l = argument(0, op._l);
+	Expr r = argument(1, op._r);
+	if ((l.get() == op._l.get()) && (r.get() == op._r.get()))
+	  return generator(Expr(static_cast<const RTBase&>(op)));
+	return generator(Expr(BinaryOp<Expr, Power, Expr>::create(l, r)));
+      }
+
+      Terms apply(const SumRT& op) {
+	Terms result = SparsePolynomial(op._constant)._terms;
+	for (std::size_t i(0); i < op._terms.size(); ++i)
+	  SparsePolynomial::add(result, operand(i), op._terms[i].second);
+	return result;
+      }
+
+      Terms apply(const ProductRT& op) {
+	Terms result = SparsePolynomial(op._constant)._terms;
+	for (std::size_t i(0); i < op._terms.size(); ++i) {
+	  const double a = op._terms[i].second;
+	  if (expandable(i, a)) {
+	    Terms factor = raise(i, op._terms[i].first, a);
+	    if (fits(result, factor)) {
+	      result = SparsePolynomial::multiply(result, factor);
+	      continue;
+	    }
+	  }
+
+	  NaryBuilder<Multiply> factor;
+	  factor.add(argument(i, op._terms[i].first), a);
+	  result = SparsePolynomial::multiply(result, generator(factor.finish()));
+	}
+	return result;
+      }
+
+      //! \brief The generator g, as terms.
+      Terms generator(const Expr& g) {
+	auto it = _index.emplace(g, unsigned(_generators.size())).first;
+	if (it->second == _generators.size())
+	  _generators.push_back(g);
+	return Terms{{Monomial{{it->second, 1}}, 1.0}};
+      }
+
+      /*! \brief Test if the i-th operand raised to the power n can
+          be converted, as n is an integer and either the operand is
+          a (usable) constant, or n is at most \ref
+          SparsePolynomial::max_expanded_power in magnitude and the
+          power fits (as for \ref fits). */
+      bool expandable(std::size_t i, double n) {
+	if (n != std::floor(n))
+	  return false;
+	double c;
+	if (constant(operand(i), c) && ((c != 0) || (n >= 0)))
+	  return true;
+	if (std::abs(n) > SparsePolynomial::max_expanded_power)
+	  return false;
+	//Negative powers are of a single generator, 1/g
+	if (n < 0)
+	  return true;
+	const Terms& t = operand(i);
+	if (double(SparsePolynomial::max_exponent(t)) * n > std::numeric_limits<unsigned>::max())
+	  return false;
+	//The number of monomials of degree n in t.size() symbols
+	double terms = 1;
+	for (unsigned k(1); k <= n; ++k)
+	  terms *= (double(t.size()) - 1 + k) / k;
+	return terms <= SparsePolynomial::max_expanded_terms;
+      }
+
+      /*! \brief Test if the product of two sets of terms can be
+          stored, as its exponents fit in an unsigned, and it has at
+          most \ref SparsePolynomial::max_expanded_terms terms. */
+      static bool fits(const Terms& a, const Terms& b) {
+	return (double(a.size()) * b.size() <= SparsePolynomial::max_expanded_terms)
+	  && (SparsePolynomial::max_exponent(a) <= std::numeric_limits<unsigned>::max() - SparsePolynomial::max_exponent(b));
+      }
+
+      /*! \brief The terms a times the i-th operand, which is kept
+          whole, as a generator, if the product does not fit (see
+          \ref fits). */
+      Terms times(const Terms& a, std::size_t i, const Expr& e) {
+	if (fits(a, operand(i)))
+	  return SparsePolynomial::multiply(a, operand(i));
+	return SparsePolynomial::multiply(a, generator(argument(i, e)));
+      }
+
+      //! \brief The i-th operand raised to the integer power n (see \ref expandable).
+      Terms raise(std::size_t i, const Expr& base, double n) {
+	double c;
+	if (constant(operand(i), c) && ((c != 0) || (n >= 0)))
+	  return SparsePolynomial(std::pow(c, n))._terms;
+	if (n >= 0)
+	  return SparsePolynomial::power(operand(i), unsigned(n));
+	return SparsePolynomial::power(generator(inverse(argument(i, base))), unsigned(-n));
+      }
+
+      //! \brief The i-th argument of a generator, expanded if required.
+      Expr argument(std::size_t i, const Expr& arg) { return _expand ? terms_expr(_generators, operand(i)) : arg; }
+
+      static Expr inverse(const Expr& e) {
+	NaryBuilder<Multiply> builder;
+	builder.add(e, -1);
+	return builder.finish();
+      }
+
+      //! \brief Test if the terms are a constant, c.
+      static bool constant(const Terms& t, double& c) {
+	if (t.empty())
+	  c = 0;
+	else if ((t.size() == 1) && t.begin()->first.empty())
+	  c = t.begin()->second;
+	else
+	  return false;
+	return true;
+      }
+
+      Terms sum(double c) {
+	Terms result = std::move(operand(0));
+	SparsePolynomial::add(result, operand(1), c);
+	return result;
+      }
+
+      const bool _expand;
+      std::vector<Expr> _generators;
+      std::unordered_map<Expr, unsigned> _index;
+    };
+  }
+
+  inline SparsePolynomial::SparsePolynomial(const Expr& f) {
+    detail::PolynomialRT visitor(false);
+    _terms = visitor.traverse(f);
+
+    //Operands of some generators (e.g., the x of x^y) were also
+    //visited, thus the unused generators are dropped
+    std::vector<bool> used(visitor._generators.size(), false);
+    for (const auto& t : _terms)
+      for (const auto& p : t.first)
+	used[p.first] = true;
+
+    std::vector<unsigned> index(used.size());
+    for (std::size_t i(0); i < used.size(); ++i)
+      if (used[i]) {
+	index[i] = unsigned(_generators.size());
+	_generators.push_back(visitor._generators[i]);
+      }
+    if (_generators.size() != used.size())
+      _terms = remap(_terms, index);
+  }
+
+  inline Expr SparsePolynomial::to_expr() const { return detail::terms_expr(_generators, _terms); }
+
+  /*! \brief Expand the products and integer powers of sums in an
+      expression.
+
+    The expression is converted into a \ref SparsePolynomial (as are
+    the arguments of any functions in it) and back, giving a
+    flattened sum of monomials with like terms collected. Powers
+    larger than \ref SparsePolynomial::max_expanded_power, and
+    products and powers estimated to have more than \ref
+    SparsePolynomial::max_expanded_terms terms, are not expanded.
+
+    \code{.cpp}
+    sym::expand(sym::Expr("(x+1)*(x-1)")); //x^2-1
+    sym::expand(sym::Expr("sin((x+1)^2)/x")); //sin(x^2+2*x+1)/x
+    \endcode
+
+    The elements of arrays are expanded separately.
+   */
+  inline Expr expand(const Expr& f) {
+    if (f->_type_idx == detail::Type_index<ArrayRT>::value) {
+      Expr result = detail::map_elements(f.as<ArrayRT>(), [](const Expr& e) { return expand(e); });
+      return result ? result : f;
+    }
+
+    detail::PolynomialRT visitor(true);
+    const SparsePolynomial::Terms terms = visitor.traverse(f);
+    return detail::terms_expr(visitor._generators, terms);
+  }
+}
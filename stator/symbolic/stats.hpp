@@ -0,0 +1,186 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef STATOR_STATS
+# include <atomic>
+# include <deque>
+# include <mutex>
+# include <typeinfo>
+# ifdef __GNUG__
+#  include <cstdlib>
+#  include <cxxabi.h>
+# endif
+#endif
+
+namespace sym {
+  /*! \brief Counts of the work done by the runtime symbolic engine
+      (see \ref engine_stats).
+
+    The counters are only maintained if STATOR_STATS is defined
+    (e.g., with the STATOR_STATS CMake option). Otherwise, the
+    counting compiles away entirely and every count is zero.
+  */
+  struct EngineStats {
+    //! \brief Larger than any \ref detail::Type_index.
+    static constexpr std::size_t max_types = 32;
+
+    //! \brief The nodes created of each type, indexed by \ref detail::Type_index.
+    std::array<std::size_t, max_types> nodes_created;
+    //! \brief Node visits (dispatches of \ref RTBase::visit) made by each visitor class.
+    std::vector<std::pair<std::string, std::size_t>> visitor_dispatches;
+    //! \brief Calls of simplify on an Expr.
+    std::size_t simplify_passes;
+    //! \brief Nodes that simplify replaced.
+    std::size_t simplify_rewrites;
+    //! \brief Calls of RTBase::hash (including those of std::hash<Expr>).
+    std::size_t hashes;
+    //! \brief Comparisons of runtime nodes (operator==).
+    std::size_t compares;
+    //! \brief Tokens read by the expression parser.
+    std::size_t tokens;
+
+    //! \brief The number of visits made by the visitor classes whose name contains a string.
+    std::size_t visits(const std::string& visitor) const {
+      std::size_t n = 0;
+      for (const auto& v : visitor_dispatches)
+	if (v.first.find(visitor) != std::string::npos)
+	  n += v.second;
+      return n;
+    }
+  };
+
+  //! \brief True if the engine counters are compiled in (STATOR_STATS is defined).
+  constexpr bool engine_stats_enabled() {
+#ifdef STATOR_STATS
+    return true;
+#else
+    return false;
+#endif
+  }
+
+#ifdef STATOR_STATS
+  namespace detail {
+    struct EngineCounters {
+      std::array<std::atomic<std::size_t>, EngineStats::max_types> nodes_created{};
+      std::atomic<std::size_t> simplify_passes{0};
+      std::atomic<std::size_t> simplify_rewrites{0};
+      std::atomic<std::size_t> hashes{0};
+      std::atomic<std::size_t> compares{0};
+      std::atomic<std::size_t> tokens{0};
+
+      struct VisitorCount {
+	std::string name;
+	std::atomic<std::size_t> count{0};
+      };
+
+      //Entries are never moved once registered, so counters may
+      //be held by reference
+      std::mutex visitors_mutex;
+      std::deque<VisitorCount> visitors;
+
+      static EngineCounters& get() {
+	static EngineCounters instance;
+	return instance;
+      }
+    };
+
+    inline std::string demangle(const char* name) {
+#ifdef __GNUG__
+      int status = 0;
+      char* out = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+      if (out) {
+	std::string result(out);
+	std::free(out);
+	return result;
+      }
+#endif
+      return name;
+    }
+
+    //! \brief The dispatch counter of a visitor class, registered on first use.
+    template<class Visitor>
+    std::atomic<std::size_t>& visitor_counter() {
+      static std::atomic<std::size_t>& counter = []() -> std::atomic<std::size_t>& {
+	auto& c = EngineCounters::get();
+	std::lock_guard<std::mutex> lock(c.visitors_mutex);
+	c.visitors.emplace_back();
+	c.visitors.back().name = demangle(typeid(Visitor).name());
+	return c.visitors.back().count;
+      }();
+      return counter;
+    }
+  }
+
+# define STATOR_STATS_COUNT(COUNTER) ::sym::detail::EngineCounters::get().COUNTER.fetch_add(1, std::memory_order_relaxed)
+# define STATOR_STATS_COUNT_NODE(TYPE_INDEX) ::sym::detail::EngineCounters::get().nodes_created[TYPE_INDEX].fetch_add(1, std::memory_order_relaxed)
+# define STATOR_STATS_COUNT_VISIT(VISITOR) ::sym::detail::visitor_counter<VISITOR>().fetch_add(1, std::memory_order_relaxed)
+#else
+# define STATOR_STATS_COUNT(COUNTER) ((void)0)
+# define STATOR_STATS_COUNT_NODE(TYPE_INDEX) ((void)0)
+# define STATOR_STATS_COUNT_VISIT(VISITOR) ((void)0)
+#endif
+
+  /*! \brief A snapshot of the engine counters. */
+  inline EngineStats engine_stats() {
+    EngineStats s{};
+#ifdef STATOR_STATS
+    auto& c = detail::EngineCounters::get();
+    for (std::size_t i(0); i < EngineStats::max_types; ++i)
+      s.nodes_created[i] = c.nodes_created[i].load();
+    {
+      std::lock_guard<std::mutex> lock(c.visitors_mutex);
+      for (const auto& v : c.visitors)
+	s.visitor_dispatches.emplace_back(v.name, v.count.load());
+    }
+    s.simplify_passes = c.simplify_passes.load();
+    s.simplify_rewrites = c.simplify_rewrites.load();
+    s.hashes = c.hashes.load();
+    s.compares = c.compares.load();
+    s.tokens = c.tokens.load();
+#endif
+    return s;
+  }
+
+  /*! \brief Resets the engine counters to zero. */
+  inline void reset_engine_stats() {
+#ifdef STATOR_STATS
+    auto& c = detail::EngineCounters::get();
+    for (auto& n : c.nodes_created)
+      n = 0;
+    {
+      std::lock_guard<std::mutex> lock(c.visitors_mutex);
+      for (auto& v : c.visitors)
+	v.count = 0;
+    }
+    c.simplify_passes = 0;
+    c.simplify_rewrites = 0;
+    c.hashes = 0;
+    c.compares = 0;
+    c.tokens = 0;
+#endif
+  }
+}
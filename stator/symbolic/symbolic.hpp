@@ -39,6 +39,8 @@ namespace sym {
     using stator::detail::select_overload;
   } // namespace detail
   
+  template<class T> class NodePtr;
+
   using stator::orphan::StackVector;
   using stator::detail::store;
   using stator::repr;
@@ -108,6 +110,11 @@ namespace sym {
       return *ptr;
     }
 
+    template<class T>
+    auto& unwrap(NodePtr<T>& ptr) {
+      return *ptr;
+    }
+
     template<class T>
     auto& unwrap(T& ptr) {
       return ptr;
@@ -0,0 +1,341 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sym {
+  namespace detail {
+    /*! \brief A scratch buffer borrowed from a per-thread free list.
+
+      Traversals need working stacks, and these are recycled so that
+      repeated traversals (such as \ref fast_sub) do not allocate once
+      warmed up. Nested traversals borrow separate buffers.
+    */
+    template<class T>
+    class Scratch {
+    public:
+      Scratch() {
+	if (!free_list().empty()) {
+	  _buffer.swap(free_list().back());
+	  free_list().pop_back();
+	}
+      }
+
+      ~Scratch() {
+	_buffer.clear();
+	free_list().emplace_back();
+	free_list().back().swap(_buffer);
+      }
+
+      Scratch(const Scratch&) = delete;
+      Scratch& operator=(const Scratch&) = delete;
+
+      std::vector<T>& operator*() { return _buffer; }
+      std::vector<T>* operator->() { return &_buffer; }
+
+    private:
+      static std::vector<std::vector<T>>& free_list() {
+	thread_local std::vector<std::vector<T>> list;
+	return list;
+      }
+
+      std::vector<T> _buffer;
+    };
+
+    /*! \brief Finds the operands of a node. Leaves, and containers
+        (whose elements are separate expressions), have none. */
+    struct OperandsRT : VisitorHelper<OperandsRT, std::size_t> {
+      template<class T>
+      std::size_t apply(const T&) { return 0; }
+
+      template<typename Op>
+      std::size_t apply(const UnaryOp<Expr, Op>& op) {
+	_operands[0] = op._arg.get();
+	_terms = nullptr;
+	_constant = 0;
+	return 1;
+      }
+
+      template<typename Op>
+      std::size_t apply(const BinaryOp<Expr, Op, Expr>& op) {
+	_operands[0] = op._l.get();
+	_operands[1] = op._r.get();
+	_terms = nullptr;
+	_constant = 0;
+	return 2;
+      }
+
+      template<typename Op>
+      std::size_t apply(const NaryOp<Op>& op) {
+	_terms = op._terms.data();
+	_constant = op._constant;
+	return op._terms.size();
+      }
+
+      //! \brief The i-th operand of the last node visited.
+      const RTBase& operand(std::size_t i) const { return _terms ? *_terms[i].first : *_operands[i]; }
+
+      const RTBase* _operands[2];
+      const std::pair<Expr, double>* _terms = nullptr;
+      //! \brief The constant of the last n-ary node visited.
+      double _constant = 0;
+    };
+
+    /*! \brief Structural equality of two operator nodes of the same
+        type, compared pair by pair on an explicit stack.
+
+      The operands are compared here rather than through their own
+      operator==, so comparing deep expressions does not recurse.
+      Leaves and containers are compared with RTBase::compare.
+    */
+    inline bool equal_operands(const RTBase& l, const RTBase& r) {
+      Scratch<std::pair<const RTBase*, const RTBase*>> stack;
+      OperandsRT lf, rf;
+      //Pushes the operands of two nodes of the same type, if the
+      //nodes are otherwise equal
+      auto push = [&](const RTBase& a, const RTBase& b) {
+	const std::size_t count = a.visit(lf);
+	if ((count != b.visit(rf)) || (lf._constant != rf._constant))
+	  return false;
+	for (std::size_t i(0); i < count; ++i) {
+	  if (lf._terms && (lf._terms[i].second != rf._terms[i].second))
+	    return false;
+	  stack->emplace_back(&lf.operand(i), &rf.operand(i));
+	}
+	return true;
+      };
+
+      if (!push(l, r))
+	return false;
+
+      while (!stack->empty()) {
+	const RTBase& a = *stack->back().first;
+	const RTBase& b = *stack->back().second;
+	stack->pop_back();
+
+	if (&a == &b)
+	  continue;
+
+	//Leaves and containers have no operands
+	if (!a.visit(lf)) {
+	  if (!a.compare(Expr(b)))
+	    return false;
+	  continue;
+	}
+
+	if (a._type_idx != b._type_idx)
+	  return false;
+	if (a._interned && b._interned && (a._intern_generation == b._intern_generation))
+	  return false;
+	if (a._hash_cached && b._hash_cached && (a._hash != b._hash))
+	  return false;
+	STATOR_STATS_COUNT(compares);
+	if (!push(a, b))
+	  return false;
+      }
+      return true;
+    }
+
+    struct PostOrderFrame {
+      const RTBase& operand(std::size_t i) const { return terms ? *terms[i].first : *operands[i]; }
+
+      const RTBase* node;
+      const RTBase* operands[2];
+      const std::pair<Expr, double>* terms;
+      std::size_t count;
+      std::size_t next;
+    };
+
+    /*! \brief Depth-first, post-order traversal of an expression on an
+        explicit stack, so the depth is only limited by memory.
+
+      \param root The expression to traverse.
+      \param enter Called with each node before its operands are
+      traversed. If this returns false, the node (and its operands)
+      are skipped.
+      \param exit Called with each entered node and its number of
+      operands, once all of its operands have been exited, so exit
+      is called on operands (left to right) before their parents.
+    */
+    template<class Enter, class Exit>
+    void post_order(const RTBase& root, Enter enter, Exit exit) {
+      if (!enter(root))
+	return;
+
+      Scratch<PostOrderFrame> stack;
+      OperandsRT operands;
+      auto push = [&](const RTBase& node) {
+	const std::size_t count = node.visit(operands);
+	stack->push_back(PostOrderFrame{&node, {operands._operands[0], operands._operands[1]}, operands._terms, count, 0});
+      };
+
+      push(root);
+      while (!stack->empty()) {
+	PostOrderFrame& top = stack->back();
+	if (top.next < top.count) {
+	  const RTBase& operand = top.operand(top.next++);
+	  if (enter(operand))
+	    push(operand);
+	  continue;
+	}
+
+	const RTBase& node = *top.node;
+	const std::size_t count = top.count;
+	stack->pop_back();
+	exit(node, count);
+      }
+    }
+
+    /*! \brief A CRTP base for visitors which compute a result for
+        each node from the results of its operands.
+
+      The derived class provides apply overloads, as for \ref
+      VisitorHelper, but reads the results of the operands of a
+      UnaryOp or BinaryOp with \ref operand instead of visiting them.
+      Calling \ref traverse then evaluates the expression bottom up.
+
+      Shallow expressions are evaluated recursively, which is
+      fastest, but subexpressions deeper than \ref max_recursion are
+      handed to \ref post_order, so the stack use is bounded.
+
+      The operand results are held in the visitor while an apply
+      runs, thus a single instance must not traverse on multiple
+      threads at once (copy it instead).
+
+      A derived class may also hide \ref skip_operands, to apply a
+      node without evaluating its operands (e.g., a node which is
+      kept whole).
+
+      If the derived class sets memoize_shared, the result of each
+      operator node which has more than one reference is kept for
+      the rest of the traversal, so subexpressions shared in a DAG
+      (see \ref cse) are only evaluated once. Nodes with a single
+      reference can only be reached once, so are not stored.
+    */
+    template<class Derived, class RetType>
+    struct PostOrderHelper : VisitorHelper<Derived, RetType> {
+      //! \brief The recursion depth before switching to an explicit stack.
+      static constexpr unsigned max_recursion = 256;
+
+      //! \brief Whether the results of shared nodes are memoized.
+      static constexpr bool memoize_shared = false;
+
+      //! \brief Whether the apply of a node does not read its operands, so they are not evaluated.
+      bool skip_operands(const RTBase&) { return false; }
+
+      RetType traverse(const RTBase& root) {
+	if (_depth >= max_recursion)
+	  return traverse_stack(root);
+
+	OperandsRT finder;
+	std::size_t count = root.visit(finder);
+	if (count && static_cast<Derived&>(*this).skip_operands(root))
+	  count = 0;
+	const bool memoize = shared(root, count);
+	if (memoize) {
+	  auto it = _memo.find(&root);
+	  if (it != _memo.end())
+	    return it->second;
+	}
+
+	RetType result;
+	if (count <= 2) {
+	  RetType results[2];
+	  evaluate(finder, count, results);
+	  result = root.visit(static_cast<Derived&>(*this));
+	} else {
+	  //Operands of n-ary nodes
+	  Scratch<RetType> results;
+	  results->resize(count);
+	  evaluate(finder, count, results->data());
+	  result = root.visit(static_cast<Derived&>(*this));
+	}
+
+	if (memoize)
+	  _memo.emplace(&root, result);
+	return result;
+      }
+
+      RetType traverse(const Expr& root) { return traverse(*root); }
+
+      //! \brief The result of the i-th operand of the node being applied.
+      RetType& operand(std::size_t i) const { return _operands[i]; }
+
+    private:
+      void evaluate(const OperandsRT& finder, std::size_t count, RetType* results) {
+	{
+	  DepthGuard guard(_depth);
+	  for (std::size_t i(0); i < count; ++i)
+	    results[i] = traverse(finder.operand(i));
+	}
+	_operands = results;
+      }
+
+      struct DepthGuard {
+	DepthGuard(unsigned& depth): _depth(depth) { ++_depth; }
+	~DepthGuard() { --_depth; }
+	unsigned& _depth;
+      };
+
+      RetType traverse_stack(const RTBase& root) {
+	Scratch<RetType> results;
+	//Shared nodes already evaluated, and nodes which skip their
+	//operands, are not entered, their result is pushed in place of
+	//traversing them
+	auto enter = [&](const RTBase& node) {
+	  if (static_cast<Derived&>(*this).skip_operands(node)) {
+	    results->push_back(node.visit(static_cast<Derived&>(*this)));
+	    return false;
+	  }
+	  if (Derived::memoize_shared && (node_use_count(&node) > 1)) {
+	    auto it = _memo.find(&node);
+	    if (it != _memo.end()) {
+	      results->push_back(it->second);
+	      return false;
+	    }
+	  }
+	  return true;
+	};
+	post_order(root, enter, [&](const RTBase& node, std::size_t count) {
+	  _operands = results->data() + (results->size() - count);
+	  RetType r = node.visit(static_cast<Derived&>(*this));
+	  results->erase(results->end() - count, results->end());
+	  if (shared(node, count))
+	    _memo.emplace(&node, r);
+	  results->push_back(std::move(r));
+	});
+	return std::move(results->back());
+      }
+
+      static bool shared(const RTBase& node, std::size_t count) {
+	return Derived::memoize_shared && count && (node_use_count(&node) > 1);
+      }
+
+      RetType* _operands = nullptr;
+      unsigned _depth = 0;
+      //Results of the shared nodes (if memoize_shared)
+      std::unordered_map<const RTBase*, RetType> _memo;
+    };
+  }
+}
@@ -190,21 +190,29 @@ namespace sym {
   std::pair<int, int> BP(const sym::UnaryOp<Arg, Op>& v)
   { return std::make_pair(0, Op::BP); }
   
+  namespace detail {
+    /*! \brief String representation of a unary operation, given the
+        representation of its argument. */
+    template<class Config, class Arg, class Op>
+    inline std::string repr_unary(const sym::UnaryOp<Arg, Op>& f, std::string arg_repr)
+    {
+      const auto this_BP = BP(f);
+      const auto arg_BP = BP(f._arg);
+
+      if ((arg_BP.first < this_BP.second) || Config::Force_parenthesis)
+	arg_repr = paren_wrap<Config>(std::move(arg_repr));
+
+      return std::string((Config::Latex_output) ? Op::l_latex_repr() : Op::l_repr())
+	+ arg_repr
+	+ std::string((Config::Latex_output) ? Op::r_latex_repr() : Op::r_repr())
+	;
+    }
+  }
+
   template<class Config = DefaultReprConfig, class Arg, class Op>
   inline std::string repr(const sym::UnaryOp<Arg, Op>& f)
   {
-    std::string arg_repr = repr<Config>(f._arg);
-
-    const auto this_BP = BP(f);
-    const auto arg_BP = BP(f._arg);
-    
-    if ((arg_BP.first < this_BP.second) || Config::Force_parenthesis)
-      arg_repr = detail::paren_wrap<Config>(arg_repr);
-    
-    return std::string((Config::Latex_output) ? Op::l_latex_repr() : Op::l_repr())
-      + arg_repr
-      + std::string((Config::Latex_output) ? Op::r_latex_repr() : Op::r_repr())
-      ;
+    return detail::repr_unary<Config>(f, repr<Config>(f._arg));
   }
 }
 
@@ -27,17 +27,30 @@ namespace sym {
   template<typename Op>
   struct UnaryOp<Expr,Op> : public RTBaseHelper<UnaryOp<Expr,Op> >, public Dynamic {
   protected:
-    UnaryOp(const Expr& arg): _arg(arg) {}
+    UnaryOp(const Expr& arg): _arg(arg) {
+      if (_arg && _arg->_hash_cached)
+	RTBase::cache_hash(std::hash<UnaryOp>{}(*this));
+    }
     UnaryOp(const UnaryOp& e) = default;
     
   public:
+    ~UnaryOp() {
+      //Deep expressions are destroyed without recursion
+      detail::release_operand(_arg);
+    }
+
     static auto create(const Expr& arg) {
-      return std::shared_ptr<UnaryOp>(new UnaryOp(arg));
+      if (interning() && arg && detail::InternTable::get().current(*arg))
+	return detail::InternTable::get().lookup<UnaryOp>(detail::intern_key(detail::Type_index<UnaryOp>::value, arg.get()),
+							  [&](const UnaryOp& o) { return o._arg.get() == arg.get(); },
+							  [&]() { return detail::make_node<UnaryOp>(arg); });
+
+      return detail::make_node<UnaryOp>(arg);
     }
 
     bool operator==(const UnaryOp& o) const {
       //Shortcut comparison before proceeding with item by item
-      return (this == &o) || (_arg == o._arg);
+      return (this == &o) || detail::equal_operands(*this, o);
     }
     
     Expr getArg() const {
@@ -26,24 +26,29 @@ namespace sym {
   protected:
     inline Var(const std::string name="x"):
       _name(name)
-    {}
+    { cache_hash(std::hash<Var>{}(*this)); }
 
     Var(const Var& v) = delete;
     
     template<conststr N>
     Var(const Var<N>& v):
       _name(v.getName())
-    {}
+    { cache_hash(std::hash<Var>{}(*this)); }
 
     
   public:
     static auto create(const std::string name="x") {
-      return std::shared_ptr<VarRT>(new Var(name));
+      if (interning())
+	return detail::InternTable::get().lookup<VarRT>(detail::intern_key(detail::Type_index<VarRT>::value, name),
+							[&](const VarRT& o) { return o._name == name; },
+							[&]() { return detail::make_node<VarRT>(name); });
+
+      return detail::make_node<VarRT>(name);
     }
 
     template<conststr N>
     static auto create(const Var<N>& v) {
-      return std::shared_ptr<VarRT>(new Var(v));
+      return create(std::string(v.getName()));
     }
 
     
@@ -35,6 +35,29 @@ class Testfit(unittest.TestCase):
         #self.assertEqual(Expr("{x:1}") - Expr("{x:1, y:2}"), Expr('{x:0, y:-2.0}').to_python())
         #self.assertEqual(Expr("{x:3}") * Expr("{x:2, y:2}"), Expr('{x:6}').to_python())
 
+    def test_stats(self):
+        #Parsing already simplifies, so only count the explicit pass
+        f = Expr("x+0")
+        reset_stats()
+        simplify(f)
+        s = stats()
+        self.assertEqual(len(s["nodes_created"]), 32)
+        self.assertEqual(s["tokens"], 0)
+        if stats_enabled:
+            self.assertEqual(s["simplify_passes"], 1)
+        else:
+            self.assertEqual(s["simplify_passes"], 0)
+
+        reset_stats()
+        Expr("x+0")
+        s = stats()
+        if stats_enabled:
+            #x + 0
+            self.assertEqual(s["tokens"], 3)
+            self.assertEqual(s["simplify_passes"], 1)
+        else:
+            self.assertEqual(s["tokens"], 0)
+
     def test_sub_generic(self):
         self.assertEqual(sub(Expr("x"), Expr('{x:2}')), 2)
 
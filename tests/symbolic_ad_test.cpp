@@ -210,3 +210,92 @@ struct ConvertToExpr {
 //{  
 //  runtests();
 //}
+
+UNIT_TEST( gradient_compiletime )
+{
+  static constexpr char y_str[] = "y";
+  sym::Var<> x;
+  sym::Var<y_str> y;
+
+  auto g = sym::gradient(x * x * sym::sin(y) + sym::exp(x * y) / y - sym::log(y) + sym::pow(x, sym::C<3>()), x = 1.5, y = 0.5);
+  UNIT_TEST_CHECK_EQUAL(g.grad.size(), 2);
+  UNIT_TEST_CHECK_CLOSE(g.value, 1.5 * 1.5 * std::sin(0.5) + std::exp(0.75) / 0.5 - std::log(0.5) + std::pow(1.5, 3), 1e-12);
+  UNIT_TEST_CHECK_CLOSE(g.grad[0], 2 * 1.5 * std::sin(0.5) + std::exp(0.75) + 3 * 1.5 * 1.5, 1e-12);
+  UNIT_TEST_CHECK_CLOSE(g.grad[1], 1.5 * 1.5 * std::cos(0.5) + std::exp(0.75) * (1.5 * 0.5 - 1) / (0.5 * 0.5) - 1 / 0.5, 1e-12);
+
+  //The order of the bindings sets the order of the gradient
+  auto h = sym::gradient(x * y, y = 3.0, x = 2.0);
+  UNIT_TEST_CHECK_EQUAL(h.grad[0], 2.0);
+  UNIT_TEST_CHECK_EQUAL(h.grad[1], 3.0);
+}
+
+UNIT_TEST( gradient_runtime )
+{
+  const sym::Expr f = sym::Expr("x*sin(y)+2*x^2-ln(y)/exp(x)-(-y)+cos(x*y)+y^x+z^3") + sym::abs(sym::Expr("x-y"));
+  const std::vector<sym::Expr> vars{sym::Expr("x"), sym::Expr("y"), sym::Expr("z")};
+  const sym::VarSlots slots(vars);
+  const std::vector<double> values{0.75, 2.0, 1.5};
+
+  const sym::Gradient<> g = sym::gradient(f, slots, values);
+  UNIT_TEST_CHECK_EQUAL(g.grad.size(), 3);
+  UNIT_TEST_CHECK_CLOSE(g.value, sym::fast_sub(f, slots, values), 1e-12);
+  for (std::size_t i(0); i < vars.size(); ++i)
+    UNIT_TEST_CHECK_CLOSE(g.grad[i], sym::fast_sub(sym::derivative(f, vars[i].as<sym::VarRT>()), slots, values), 1e-12);
+
+  //Flattened sums and products have the same gradient
+  const sym::Gradient<> flat = sym::gradient(sym::flatten(f), slots, values);
+  UNIT_TEST_CHECK_CLOSE(flat.value, g.value, 1e-12);
+  for (std::size_t i(0); i < vars.size(); ++i)
+    UNIT_TEST_CHECK_CLOSE(flat.grad[i], g.grad[i], 1e-12);
+
+  //A fixed size gradient gives the same result
+  const sym::Gradient<3> h = sym::gradient<3>(f, slots, values);
+  UNIT_TEST_CHECK_EQUAL(h.value, g.value);
+  UNIT_TEST_CHECK(h.grad == g.grad);
+
+  //Constant exponents are differentiated without a logarithm, so
+  //negative bases are fine
+  UNIT_TEST_CHECK_CLOSE(sym::gradient(sym::Expr("z^3"), slots, {0.0, 0.0, -1.5}).grad[2], 6.75, 1e-12);
+
+  //Compile-time bindings also apply to runtime expressions
+  sym::Var<> x;
+  auto k = sym::gradient(sym::Expr("x*x"), x = 3.0);
+  UNIT_TEST_CHECK_EQUAL(k.grad[0], 6.0);
+}
+
+UNIT_TEST( taylor_tape )
+{
+  sym::Var<> x;
+  const sym::Expr f = sym::Expr("sin(x)*exp(-x/3)+ln(2+x*x)/(x+4)-cos(2*x)^2+x^x+(1+x)^2.5") + sym::abs(sym::Expr("x-5"));
+  sym::TaylorTape<4> tape(f, sym::Expr(x));
+
+  for (double t : {0.5, 1.25, 3.0}) {
+    const Eigen::Matrix<double, 5, 1> expected = sym::ad<4>(f, x = t);
+    const Eigen::Matrix<double, 5, 1> c = tape(t);
+    const Eigen::Matrix<double, 5, 1> flat = sym::ad<4>(sym::flatten(f), x = t);
+    for (int k(0); k < 5; ++k) {
+      UNIT_TEST_CHECK_CLOSE(c[k], expected[k], 1e-10);
+      UNIT_TEST_CHECK_CLOSE(flat[k], expected[k], 1e-10);
+    }
+  }
+
+  //The first coefficient is the value and the second the derivative
+  sym::TaylorTape<1> cube(sym::Expr("x^3"), sym::Expr(x));
+  UNIT_TEST_CHECK_CLOSE(cube(-2.0)[0], -8.0, 1e-14);
+  UNIT_TEST_CHECK_CLOSE(cube(-2.0)[1], 12.0, 1e-14);
+
+  sym::TaylorTape<2> abs(sym::abs(sym::Expr("x*x-4")), sym::Expr(x));
+  UNIT_TEST_CHECK(abs(1.0) == Eigen::Vector3d(3, -2, -1));
+
+  //Constant expressions have no higher coefficients
+  const Eigen::Matrix<double, 3, 1> constant = sym::TaylorTape<2>(sym::Expr("3"), sym::Expr(x))(1.0);
+  UNIT_TEST_CHECK(constant == Eigen::Vector3d(3, 0, 0));
+
+  //Integer powers of a zero base are finite
+  const Eigen::Matrix<double, 4, 1> high = sym::TaylorTape<3>(sym::Expr("x^20"), sym::Expr(x))(0.0);
+  UNIT_TEST_CHECK(high == Eigen::Vector4d(0, 0, 0, 0));
+  const Eigen::Matrix<double, 4, 1> low = sym::TaylorTape<3>(sym::Expr("(x+x^2)^2"), sym::Expr(x))(0.0);
+  UNIT_TEST_CHECK(low == Eigen::Vector4d(0, 0, 1, 2));
+  const Eigen::Matrix<double, 4, 1> zeroth = sym::TaylorTape<3>(sym::Expr("x^0"), sym::Expr(x))(0.0);
+  UNIT_TEST_CHECK(zeroth == Eigen::Vector4d(1, 0, 0, 0));
+}
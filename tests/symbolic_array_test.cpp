@@ -184,3 +184,37 @@ UNIT_TEST(symbolic_array_runtime) {
   UNIT_TEST_CHECK_EQUAL(f, result);
   UNIT_TEST_CHECK_EQUAL(sym::simplify(sym::Expr("[1, 1, 1]")+sym::Expr("[0, 1, 2]")), sym::Expr("[1,2,3]"));
 }
+
+UNIT_TEST(symbolic_array_parallel) {
+  //A Jacobian-like array of many independent elements
+  auto A_ptr = sym::ArrayRT::create();
+  auto& A = *A_ptr;
+  for (int i(0); i < 500; ++i)
+    A.push_back(sym::Expr("x^" + std::to_string(i % 7 + 2) + "*sin(" + std::to_string(i) + "*y)+exp(x*y)/" + std::to_string(i + 1)));
+  const sym::Expr f(A);
+  auto x_ptr = sym::VarRT::create("x");
+
+  const sym::Expr dserial = sym::derivative(f, *x_ptr);
+  const sym::Expr sserial = sym::simplify(dserial);
+  const sym::Expr subserial = sym::sub(sserial, sym::Expr("x=2"));
+  const sym::Expr dict = sym::Expr("{a:x*x+x*x, b:y-y, c:2*3}");
+  const sym::Expr dictserial = sym::simplify(dict);
+
+  for (std::size_t grain : {1, 7, 64}) {
+    stator::ParallelScope scope(4, grain);
+    const sym::Expr d = sym::derivative(f, *x_ptr);
+    UNIT_TEST_CHECK_EQUAL(d, dserial);
+    UNIT_TEST_CHECK_EQUAL(sym::simplify(d), sserial);
+    UNIT_TEST_CHECK_EQUAL(sym::sub(sserial, sym::Expr("x=2")), subserial);
+    UNIT_TEST_CHECK_EQUAL(sym::simplify(dict), dictserial);
+  }
+
+  //Exceptions thrown by the elements reach the caller
+  bool caught = false;
+  try {
+    stator::parallel_for(100, [](std::size_t i) { if (i == 42) stator_throw() << "element " << i; }, 4, 8);
+  } catch (const stator::Exception&) {
+    caught = true;
+  }
+  UNIT_TEST_CHECK(caught);
+}
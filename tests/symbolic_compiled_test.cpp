@@ -0,0 +1,196 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//stator
+#include <stator/symbolic/compiled.hpp>
+#define UNIT_TEST_SUITE_NAME Symbolic_Compiled
+#define UNIT_TEST_GOOGLE
+#include <stator/unit_test.hpp>
+
+#include <cmath>
+
+using namespace sym;
+
+UNIT_TEST( compiled_expr_eval )
+{
+  CompiledExpr f(Expr("x*sin(y)+2*x^2-ln(y)/exp(x)-(-y)") + sym::abs(Expr("x-y")), {Expr("x"), Expr("y")});
+  UNIT_TEST_CHECK_EQUAL(f.variables(), 2u);
+
+  for (double x : {-1.5, 0.25, 3.0})
+    for (double y : {0.5, 2.0}) {
+      const double expected = x * std::sin(y) + 2 * x * x - std::log(y) / std::exp(x) + std::abs(x - y) + y;
+      UNIT_TEST_CHECK_CLOSE(f({x, y}), expected, 1e-12);
+    }
+
+  //The constant 2 is pooled
+  UNIT_TEST_CHECK_EQUAL(f.registers(), 2 + 1 + f.program().size());
+
+  //Negative zero is not merged with zero, and NaN is pooled
+  const Expr x("x");
+  UNIT_TEST_CHECK(std::isnan(CompiledExpr(x / Expr(0.0) + x / Expr(-0.0), {x})({1.0})));
+  UNIT_TEST_CHECK_EQUAL(CompiledExpr(x * Expr(NAN) + Expr(NAN), {x}).constants().size(), 1u);
+
+  //Leaves need no instructions
+  UNIT_TEST_CHECK_EQUAL(CompiledExpr(Expr("y"), {Expr("x"), Expr("y")})({1.0, 4.0}), 4.0);
+  UNIT_TEST_CHECK_EQUAL(CompiledExpr(Expr("3"), {})({}), 3.0);
+}
+
+UNIT_TEST( compiled_expr_batch )
+{
+  CompiledExpr f(Expr("x*sin(y)+2*x^2-ln(y)/exp(x)-(-y)+cos(x)") + sym::abs(Expr("x-y")), {Expr("x"), Expr("y")});
+
+  //Enough points to span several blocks, with a partial last block
+  const std::size_t n = 2 * CompiledExpr::batch_lanes + 17;
+  std::vector<double> x(n), y(n);
+  for (std::size_t i(0); i < n; ++i) {
+    x[i] = -2.0 + 4.0 * i / n;
+    y[i] = 0.1 + 3.0 * i / n;
+  }
+
+  const std::vector<double> r = f.batch({x, y});
+  UNIT_TEST_CHECK_EQUAL(r.size(), n);
+  for (std::size_t i(0); i < n; ++i)
+    UNIT_TEST_CHECK_CLOSE(r[i], f({x[i], y[i]}), 1e-12);
+
+  //Constant expressions give one result
+  UNIT_TEST_CHECK_EQUAL(CompiledExpr(Expr("2^3"), {}).batch({}), std::vector<double>{8.0});
+  UNIT_TEST_CHECK_EQUAL(CompiledExpr(Expr("x"), {Expr("x")}).batch({{1.0, 2.0}}), (std::vector<double>{1.0, 2.0}));
+
+  //A long sum of distinct terms only needs a few live registers
+  const Expr X("x");
+  Expr g = sym::sin(X);
+  for (int k(2); k <= 1000; ++k)
+    g = g + sym::sin(Expr(k) * X);
+  const CompiledExpr cg(g, {X});
+  UNIT_TEST_CHECK(cg.registers() > 3000u);
+  UNIT_TEST_CHECK(cg.batch_registers() <= 5u);
+  const std::vector<double> rg = cg.batch({x});
+  for (std::size_t i(0); i < n; ++i)
+    UNIT_TEST_CHECK_CLOSE(rg[i], cg({x[i]}), 1e-12);
+}
+
+UNIT_TEST( cse_shared_subexpressions )
+{
+  const Expr f = Expr("sin(x)*y+sin(x)*z+exp(sin(x)*y)");
+  const CSEResult r = cse(f);
+
+  //Structurally identical subtrees become a single node
+  const auto& sum = r.dag.as<BinaryOp<Expr, detail::Add, Expr> >();
+  const auto& lhs = sum._l.as<BinaryOp<Expr, detail::Add, Expr> >();
+  const auto& exp_arg = sum._r.as<UnaryOp<Expr, detail::Exp> >()._arg;
+  UNIT_TEST_CHECK_EQUAL(lhs._l.get(), exp_arg.get());
+  UNIT_TEST_CHECK_EQUAL(r.dag, f);
+
+  UNIT_TEST_CHECK_EQUAL(r.definitions.size(), 2u);
+  UNIT_TEST_CHECK_EQUAL(r.definitions[0].first, Expr("csea"));
+  UNIT_TEST_CHECK_EQUAL(r.definitions[0].second, Expr("sin(x)"));
+  UNIT_TEST_CHECK_EQUAL(r.definitions[1].second, Expr("csea*y"));
+  UNIT_TEST_CHECK_EQUAL(r.reduced, Expr("cseb+csea*z+exp(cseb)"));
+
+  //Substituting the definitions back in, last first, recovers f
+  Expr g = r.reduced;
+  for (auto it = r.definitions.rbegin(); it != r.definitions.rend(); ++it)
+    g = sub(g, Expr(equality(it->first, it->second)));
+  UNIT_TEST_CHECK_EQUAL(g, f);
+
+  //Nothing is repeated
+  UNIT_TEST_CHECK(cse(Expr("x*y+2")).definitions.empty());
+
+  //The compiled program evaluates each repeated value once
+  UNIT_TEST_CHECK_EQUAL(CompiledExpr(f, {Expr("x"), Expr("y"), Expr("z")}).program().size(), 6u);
+}
+
+UNIT_TEST( cse_deep_expression )
+{
+  //Deep enough to overflow the stack if any pass recursed
+  const std::size_t depth = 200000;
+  Expr f = Expr("x");
+  for (std::size_t i(0); i < depth; ++i)
+    f = BinaryOp<Expr, detail::Add, Expr>::create(f, Expr("sin(x)*y"));
+
+  const CSEResult r = cse(f);
+  UNIT_TEST_CHECK_EQUAL(r.definitions.size(), 1u);
+  UNIT_TEST_CHECK_EQUAL(r.definitions[0].second, Expr("sin(x)*y"));
+  UNIT_TEST_CHECK_EQUAL(r.dag, f);
+
+  //Lowering is also non-recursive
+  Expr g = Expr("x");
+  double expected = 1;
+  for (std::size_t i(0); i < depth; ++i) {
+    g = BinaryOp<Expr, detail::Add, Expr>::create(g, Expr(double(i % 3 + 1)) * Expr("y"));
+    expected += 2 * (i % 3 + 1);
+  }
+  CompiledExpr c(g, {Expr("x"), Expr("y")});
+  UNIT_TEST_CHECK_EQUAL(c({1.0, 2.0}), expected);
+}
+
+UNIT_TEST( compiled_expr_gradient )
+{
+  const Expr f = Expr("x*sin(y)+2*x^2-ln(y)/exp(x)-(-y)+cos(x*y)+y^x+x^3*y") + sym::abs(Expr("x-y"));
+  const std::vector<Expr> vars{Expr("x"), Expr("y")};
+  const CompiledExpr cf(f, vars);
+
+  //Check against the symbolic derivatives (at positive x, where the
+  //derivative of the general power x^3 is defined)
+  const CompiledExpr dfdx(derivative(f, vars[0].as<VarRT>()), vars);
+  const CompiledExpr dfdy(derivative(f, vars[1].as<VarRT>()), vars);
+  for (double x : {0.25, 1.5, 3.0})
+    for (double y : {0.5, 2.0}) {
+      double grad[2];
+      UNIT_TEST_CHECK_CLOSE(cf.gradient(std::vector<double>{x, y}.data(), grad), cf({x, y}), 1e-12);
+      UNIT_TEST_CHECK_CLOSE(grad[0], dfdx({x, y}), 1e-10);
+      UNIT_TEST_CHECK_CLOSE(grad[1], dfdy({x, y}), 1e-10);
+    }
+
+  //Flattened sums and products compile to the same function
+  const CompiledExpr cflat(flatten(f), vars);
+  for (double x : {0.25, 1.5, 3.0}) {
+    double grad[2], flat_grad[2];
+    UNIT_TEST_CHECK_CLOSE(cflat.gradient(std::vector<double>{x, 2.0}.data(), flat_grad), cf.gradient(std::vector<double>{x, 2.0}.data(), grad), 1e-12);
+    UNIT_TEST_CHECK_CLOSE(flat_grad[0], grad[0], 1e-10);
+    UNIT_TEST_CHECK_CLOSE(flat_grad[1], grad[1], 1e-10);
+  }
+
+  //Variables which do not appear have a zero derivative, and a
+  //square (a register multiplied by itself) accumulates both terms
+  UNIT_TEST_CHECK_EQUAL(CompiledExpr(Expr("x*x"), {Expr("x"), Expr("y")}).gradient({3.0, 1.0}), (std::vector<double>{6.0, 0.0}));
+}
+
+//Returns true if f throws a stator::Exception
+template<class F>
+bool throws(F f) {
+  try {
+    f();
+  } catch (const stator::Exception&) {
+    return true;
+  }
+  return false;
+}
+
+UNIT_TEST( compiled_expr_errors )
+{
+  //Unknown variables and unsupported operations are rejected at compile time
+  UNIT_TEST_CHECK(throws([]{ CompiledExpr(Expr("x*z"), {Expr("x")}); }));
+  UNIT_TEST_CHECK(throws([]{ CompiledExpr(Expr("x=2"), {Expr("x")}); }));
+  UNIT_TEST_CHECK(throws([]{ CompiledExpr(Expr("x"), {Expr("x"), Expr("x")}); }));
+  UNIT_TEST_CHECK(throws([]{ CompiledExpr(Expr("x"), {Expr("2")}); }));
+  UNIT_TEST_CHECK(throws([]{ CompiledExpr(Expr("x"), {Expr("x")})({1.0, 2.0}); }));
+  UNIT_TEST_CHECK(throws([]{ CompiledExpr(Expr("x"), {Expr("x")}).gradient({1.0, 2.0}); }));
+  UNIT_TEST_CHECK(throws([]{ CompiledExpr(Expr("x*y"), {Expr("x"), Expr("y")}).batch({{1.0, 2.0}, {1.0}}); }));
+}
@@ -0,0 +1,118 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//stator
+#include <stator/symbolic/disk_cache.hpp>
+#define UNIT_TEST_SUITE_NAME Symbolic_Disk_Cache
+#define UNIT_TEST_GOOGLE
+#include <stator/unit_test.hpp>
+
+using namespace sym;
+
+namespace {
+  const std::string directory = "symbolic_disk_cache_test.dir";
+}
+
+UNIT_TEST( disk_cache_hits )
+{
+  std::filesystem::remove_all(directory);
+  const Expr f("sin(x)*x^2+x*y");
+  const Expr x("x"), y("y");
+  {
+    DiskCache cache(directory);
+    UNIT_TEST_CHECK(cache.simplify(f) == simplify(f));
+    UNIT_TEST_CHECK(cache.derivative(f, x) == derivative(f, x));
+    UNIT_TEST_CHECK(cache.derivative(f, y) == derivative(f, y));
+    UNIT_TEST_CHECK_EQUAL(cache.stats().misses, 3u);
+    UNIT_TEST_CHECK_EQUAL(cache.stats().stores, 3u);
+    UNIT_TEST_CHECK_EQUAL(cache.size(), 3u);
+
+    UNIT_TEST_CHECK(cache.derivative(f, x) == derivative(f, x));
+    UNIT_TEST_CHECK_EQUAL(cache.stats().hits, 1u);
+  }
+
+  //A new cache (e.g., in a later run) finds the stored results
+  //without computing them
+  DiskCache cache(directory);
+  UNIT_TEST_CHECK_EQUAL(cache.size(), 3u);
+  int computed = 0;
+  const Expr d = cache.apply("derivative", f, {y}, [&]() { ++computed; return Expr(); });
+  UNIT_TEST_CHECK_EQUAL(computed, 0);
+  UNIT_TEST_CHECK(d == derivative(f, y));
+  UNIT_TEST_CHECK(cache.simplify(f) == simplify(f));
+  UNIT_TEST_CHECK_EQUAL(cache.stats().hits, 2u);
+
+  //Different arguments, or expressions, are different entries
+  cache.apply("derivative", f, {Expr("z")}, [&]() { ++computed; return Expr(0.0); });
+  cache.apply("simplify", Expr("sin(x)*x^2+x*z"), {}, [&]() { ++computed; return Expr(0.0); });
+  UNIT_TEST_CHECK_EQUAL(computed, 2);
+  UNIT_TEST_CHECK_EQUAL(cache.size(), 5u);
+
+  //Unreadable entries are misses, and are replaced
+  for (const auto& file : std::filesystem::directory_iterator(directory))
+    std::ofstream(file.path(), std::ios::trunc) << "corrupt";
+  UNIT_TEST_CHECK(cache.simplify(f) == simplify(f));
+  UNIT_TEST_CHECK(DiskCache(directory).simplify(f) == simplify(f));
+  UNIT_TEST_CHECK_EQUAL(cache.stats().hits, 2u);
+
+  cache.clear();
+  UNIT_TEST_CHECK_EQUAL(cache.size(), 0u);
+  UNIT_TEST_CHECK(std::filesystem::is_empty(directory));
+  std::filesystem::remove_all(directory);
+}
+
+UNIT_TEST( disk_cache_eviction )
+{
+  std::filesystem::remove_all(directory);
+  std::vector<Expr> terms;
+  for (int i(0); i < 8; ++i)
+    terms.push_back(Expr("x^" + std::to_string(i + 2) + "*sin(x)"));
+  const Expr x("x");
+
+  //Find the size of an entry, so the limit holds about four
+  std::uintmax_t entry_size;
+  {
+    DiskCache cache(directory);
+    cache.derivative(terms[0], x);
+    entry_size = cache.bytes();
+    cache.clear();
+  }
+
+  DiskCache cache(directory, 4 * entry_size + entry_size / 2);
+  for (const Expr& t : terms) {
+    cache.derivative(t, x);
+    //Keep the first entry in use
+    cache.derivative(terms[0], x);
+    UNIT_TEST_CHECK(cache.bytes() <= 4 * entry_size + entry_size / 2);
+  }
+  UNIT_TEST_CHECK(cache.stats().evictions > 0);
+  UNIT_TEST_CHECK(cache.size() <= 4u);
+  const std::size_t hits = cache.stats().hits;
+  cache.derivative(terms[0], x);
+  cache.derivative(terms.back(), x);
+  UNIT_TEST_CHECK_EQUAL(cache.stats().hits, hits + 2);
+  cache.derivative(terms[1], x);
+  UNIT_TEST_CHECK_EQUAL(cache.stats().hits, hits + 2);
+
+  //The limits also apply when opening a directory
+  DiskCache small(directory, 1024 * 1024, 2);
+  UNIT_TEST_CHECK_EQUAL(small.size(), 2u);
+  UNIT_TEST_CHECK_EQUAL(std::size_t(std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator())), 2u);
+  std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,72 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//stator
+#include <stator/symbolic/native.hpp>
+#define UNIT_TEST_SUITE_NAME Symbolic_Native
+#define UNIT_TEST_GOOGLE
+#include <stator/unit_test.hpp>
+
+using namespace sym;
+
+UNIT_TEST( native_expr )
+{
+  NativeOptions options;
+  options.cache_dir = (std::filesystem::temp_directory_path() / ("stator_native_test_" + std::to_string(::getpid()))).string();
+  std::filesystem::remove_all(options.cache_dir);
+
+  const Expr f = Expr("x*sin(y)+2*x^3-ln(y)/exp(x)-(-y)+cos(x)/y^x") + sym::abs(Expr("x-y"));
+  const std::vector<Expr> vars{Expr("x"), Expr("y")};
+  const CompiledExpr cf(f, vars);
+
+  NativeExpr nf(f, vars, options);
+  UNIT_TEST_CHECK(!nf.cached());
+  for (double x : {-1.5, 0.25, 3.0})
+    for (double y : {0.5, 2.0})
+      UNIT_TEST_CHECK_CLOSE(nf({x, y}), cf({x, y}), 1e-12);
+
+  //The same expression is loaded from the cache
+  NativeExpr nf2(Expr("x*sin(y)+2*x^3-ln(y)/exp(x)-(-y)+cos(x)/y^x") + sym::abs(Expr("x-y")), vars, options);
+  UNIT_TEST_CHECK(nf2.cached());
+  UNIT_TEST_CHECK_EQUAL(nf2.library(), nf.library());
+  UNIT_TEST_CHECK_EQUAL(nf2({0.25, 2.0}), nf({0.25, 2.0}));
+
+  //A different source under the same key is treated as a collision
+  std::filesystem::rename(nf.library(), nf.library() + ".bak");
+  std::filesystem::copy_file(nf.library() + ".bak", nf.library());
+  {
+    std::ofstream out(nf.library().substr(0, nf.library().size() - 3) + ".c");
+    out << "/* a different expression */";
+  }
+  NativeExpr nf3(f, vars, options);
+  UNIT_TEST_CHECK(!nf3.cached());
+  UNIT_TEST_CHECK(nf3.library() != nf.library());
+  UNIT_TEST_CHECK_CLOSE(nf3({0.25, 2.0}), cf({0.25, 2.0}), 1e-12);
+
+  //Signed zeros and non-finite constants are written exactly, so
+  //x/(-0.0) is -inf as in the CompiledExpr
+  const Expr x("x");
+  const Expr g = x / Expr(-0.0) + Expr(0.1) * x / Expr(INFINITY);
+  NativeExpr ng(g, {x}, options);
+  UNIT_TEST_CHECK_EQUAL(ng({1.0}), -INFINITY);
+  UNIT_TEST_CHECK_EQUAL(ng({1.0}), CompiledExpr(g, {x})({1.0}));
+  UNIT_TEST_CHECK_EQUAL(NativeExpr(Expr(0.1) * x, {x}, options)({3.0}), 0.1 * 3.0);
+
+  std::filesystem::remove_all(options.cache_dir);
+}
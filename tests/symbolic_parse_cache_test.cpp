@@ -0,0 +1,113 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//stator
+#include <stator/symbolic/runtime.hpp>
+#define UNIT_TEST_SUITE_NAME Symbolic_Parse_Cache
+#define UNIT_TEST_GOOGLE
+#include <stator/unit_test.hpp>
+
+#include <thread>
+
+using namespace sym;
+
+UNIT_TEST( parse_cache_hits )
+{
+  ParseCache cache(2);
+  const Expr f = cache.parse("x^2+sin(x)");
+  UNIT_TEST_CHECK(f == Expr("x^2+sin(x)"));
+  UNIT_TEST_CHECK_EQUAL(cache.stats().misses, 1u);
+
+  //A hit returns the same nodes, not a copy
+  const Expr g = cache.parse("x^2+sin(x)");
+  UNIT_TEST_CHECK_EQUAL(cache.stats().hits, 1u);
+  UNIT_TEST_CHECK(f.get() == g.get());
+
+  //Failures are not cached
+  for (int i(0); i < 2; ++i) {
+    bool thrown = false;
+    try {
+      cache.parse("x+)");
+    } catch (const stator::Exception&) {
+      thrown = true;
+    }
+    UNIT_TEST_CHECK(thrown);
+  }
+  UNIT_TEST_CHECK_EQUAL(cache.size(), 1u);
+  UNIT_TEST_CHECK_EQUAL(cache.stats().misses, 3u);
+}
+
+UNIT_TEST( parse_cache_lru )
+{
+  ParseCache cache(2);
+  cache.parse("a");
+  cache.parse("b");
+  //Using "a" makes "b" the least recently used
+  cache.parse("a");
+  cache.parse("c");
+  UNIT_TEST_CHECK_EQUAL(cache.size(), 2u);
+  UNIT_TEST_CHECK_EQUAL(cache.stats().evictions, 1u);
+
+  cache.reset_stats();
+  cache.parse("a");
+  cache.parse("c");
+  UNIT_TEST_CHECK_EQUAL(cache.stats().hits, 2u);
+  cache.parse("b");
+  UNIT_TEST_CHECK_EQUAL(cache.stats().misses, 1u);
+
+  cache.set_capacity(1);
+  UNIT_TEST_CHECK_EQUAL(cache.size(), 1u);
+  cache.clear();
+  UNIT_TEST_CHECK_EQUAL(cache.size(), 0u);
+}
+
+UNIT_TEST( parse_cache_global )
+{
+  //The global cache is disabled by default
+  UNIT_TEST_CHECK_EQUAL(ParseCache::global().capacity(), 0u);
+  Expr("x*y");
+  UNIT_TEST_CHECK_EQUAL(ParseCache::global().size(), 0u);
+
+  set_parse_cache_capacity(16);
+  const Expr f("x*y");
+  const Expr g("x*y");
+  UNIT_TEST_CHECK(f.get() == g.get());
+  UNIT_TEST_CHECK_EQUAL(ParseCache::global().stats().hits, 1u);
+
+  set_parse_cache_capacity(0);
+  UNIT_TEST_CHECK_EQUAL(ParseCache::global().size(), 0u);
+}
+
+UNIT_TEST( parse_cache_threads )
+{
+  ParseCache cache(8);
+  std::vector<std::thread> threads;
+  for (int t(0); t < 4; ++t)
+    threads.emplace_back([&]{
+	for (int i(0); i < 200; ++i)
+	  cache.parse("x^" + std::to_string(i % 16));
+      });
+  for (auto& t : threads)
+    t.join();
+
+  UNIT_TEST_CHECK_EQUAL(cache.size(), 8u);
+  const ParseCache::Stats s = cache.stats();
+  UNIT_TEST_CHECK_EQUAL(s.hits + s.misses, 800u);
+  UNIT_TEST_CHECK(cache.parse("x^3") == Expr("x^3"));
+}
@@ -0,0 +1,118 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//stator
+#include <stator/symbolic/parse_records.hpp>
+//Both use MappedFile, and must be usable together
+#include <stator/symbolic/serialize.hpp>
+#define UNIT_TEST_SUITE_NAME Symbolic_Parse_Records
+#define UNIT_TEST_GOOGLE
+#include <stator/unit_test.hpp>
+
+#include <fstream>
+
+using namespace sym;
+
+UNIT_TEST( parse_records_split )
+{
+  const auto r = split_records("x+1\r\n2*y\n\nsin(z)\n");
+  UNIT_TEST_CHECK_EQUAL(r.size(), 4u);
+  UNIT_TEST_CHECK_EQUAL(r[0], "x+1");
+  UNIT_TEST_CHECK_EQUAL(r[1], "2*y");
+  UNIT_TEST_CHECK_EQUAL(r[2], "");
+  UNIT_TEST_CHECK_EQUAL(r[3], "sin(z)");
+
+  UNIT_TEST_CHECK_EQUAL(split_records("").size(), 0u);
+  UNIT_TEST_CHECK_EQUAL(split_records("a;b", ';').size(), 2u);
+}
+
+UNIT_TEST( parse_records_order )
+{
+  std::string buffer;
+  for (int i(0); i < 1000; ++i)
+    buffer += "x^" + std::to_string(i % 7) + "+" + std::to_string(i) + "\n";
+
+  const std::vector<Expr> serial = parse_records(buffer, '\n', 1);
+  UNIT_TEST_CHECK_EQUAL(serial.size(), 1000u);
+  UNIT_TEST_CHECK(serial[3] == Expr("x^3+3"));
+
+  //The results do not depend on the number of threads
+  const std::vector<Expr> parallel = parse_records(buffer, '\n', 4);
+  UNIT_TEST_CHECK_EQUAL(parallel.size(), serial.size());
+  for (std::size_t i(0); i < serial.size(); ++i)
+    UNIT_TEST_CHECK(parallel[i] == serial[i]);
+
+  const Expr a = make_array(parallel);
+  UNIT_TEST_CHECK_EQUAL(a.as<ArrayRT>().getStore().size(), 1000u);
+  UNIT_TEST_CHECK(a.as<ArrayRT>().getStore()[999] == serial[999]);
+}
+
+UNIT_TEST( parse_records_errors )
+{
+  const std::string buffer = "x+1\n2*)\ny\n\n(z";
+
+  std::vector<RecordError> errors;
+  const std::vector<Expr> r = parse_records(buffer, errors, '\n', 4);
+  UNIT_TEST_CHECK_EQUAL(r.size(), 5u);
+  UNIT_TEST_CHECK(r[0] == Expr("x+1"));
+  UNIT_TEST_CHECK(!r[1]);
+  UNIT_TEST_CHECK(r[2] == Expr("y"));
+
+  UNIT_TEST_CHECK_EQUAL(errors.size(), 3u);
+  UNIT_TEST_CHECK_EQUAL(errors[0].record, 1u);
+  UNIT_TEST_CHECK_EQUAL(errors[0].offset, 4u);
+  //The message carries the parser's location in the record
+  UNIT_TEST_CHECK(errors[0].message.find("\n2*)\n") != std::string::npos);
+  UNIT_TEST_CHECK_EQUAL(errors[1].record, 3u);
+  UNIT_TEST_CHECK_EQUAL(errors[2].record, 4u);
+
+  //The throwing form reports the first failing record
+  try {
+    parse_records(buffer, '\n', 4);
+    UNIT_TEST_CHECK(false);
+  } catch (const stator::Exception& e) {
+    UNIT_TEST_CHECK(std::string(e.what()).find("Failed to parse record 1 (at offset 4) and 2 other records") != std::string::npos);
+  }
+}
+
+UNIT_TEST( parse_records_file )
+{
+  const std::string path = "symbolic_parse_records_test.txt";
+  {
+    std::ofstream out(path);
+    out << "x*y\nexp(x)\n";
+  }
+  const std::vector<Expr> r = parse_file(path);
+  UNIT_TEST_CHECK_EQUAL(r.size(), 2u);
+  UNIT_TEST_CHECK(r[1] == Expr("exp(x)"));
+
+  {
+    std::ofstream out(path);
+  }
+  UNIT_TEST_CHECK_EQUAL(parse_file(path).size(), 0u);
+  std::remove(path.c_str());
+
+  bool thrown = false;
+  try {
+    parse_file("symbolic_parse_records_test.missing");
+  } catch (const stator::Exception&) {
+    thrown = true;
+  }
+  UNIT_TEST_CHECK(thrown);
+}
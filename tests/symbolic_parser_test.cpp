@@ -66,6 +66,21 @@ UNIT_TEST( symbolic_parser_tokenizer )
     tk.consume();
     UNIT_TEST_CHECK_EQUAL(tk.next(), "");
   }
+
+  //Tokens are views into the input, not copies of it
+  {
+    const std::string s("x + sin(y)");
+    detail::ExprTokenizer tk(s);
+    tk.consume();
+    UNIT_TEST_CHECK_EQUAL(tk.next(), "+");
+    UNIT_TEST_CHECK(tk.next().data() == s.data() + 2);
+  }
+
+  //The operator table is built once and shared by all tokenizers
+  UNIT_TEST_CHECK(&detail::ExprTokenizer::OperatorTable::get() == &detail::ExprTokenizer::OperatorTable::get());
+  UNIT_TEST_CHECK(detail::ExprTokenizer::OperatorTable::get().left("sin") != nullptr);
+  UNIT_TEST_CHECK(detail::ExprTokenizer::OperatorTable::get().right("±") != nullptr);
+  UNIT_TEST_CHECK(detail::ExprTokenizer::OperatorTable::get().right("sin") == nullptr);
 }
 
 UNIT_TEST( symbolic_parser_P )
@@ -81,7 +96,7 @@ UNIT_TEST( symbolic_parser_P )
   {
     detail::ExprTokenizer tk(" p+2");
     Expr v = tk.parseToken();
-    shared_ptr<const VarRT> v2 = dynamic_pointer_cast<const VarRT>(v);
+    NodePtr<const VarRT> v2 = dynamic_pointer_cast<const VarRT>(v);
     
     UNIT_TEST_CHECK(bool(v2));
     UNIT_TEST_CHECK_EQUAL(v2->getName(), "p");
@@ -91,7 +106,7 @@ UNIT_TEST( symbolic_parser_P )
   {
     detail::ExprTokenizer tk(" pow+2");
     Expr v = tk.parseToken();
-    shared_ptr<const VarRT> v2 = dynamic_pointer_cast<const VarRT>(v);
+    NodePtr<const VarRT> v2 = dynamic_pointer_cast<const VarRT>(v);
     
     UNIT_TEST_CHECK(bool(v2));
     UNIT_TEST_CHECK_EQUAL(v2->getName(), "pow");
@@ -232,6 +247,60 @@ UNIT_TEST( symbolic_parser_parsing_errors )
   }
 }
 
+UNIT_TEST( symbolic_parser_try_parse )
+{
+  const ParseResult ok = try_parse("x^2 + sin(x)");
+  UNIT_TEST_CHECK(ok);
+  UNIT_TEST_CHECK(*ok == Expr("x^2 + sin(x)"));
+  UNIT_TEST_CHECK_EQUAL(ok.message(), "");
+
+  const auto check = [](const std::string& s, ParseErrorCode code, std::size_t offset) {
+    const ParseResult r = try_parse(s);
+    UNIT_TEST_CHECK(!r);
+    UNIT_TEST_CHECK(r.code() == code);
+    UNIT_TEST_CHECK_EQUAL(r.offset(), offset);
+  };
+
+  check("", ParseErrorCode::unexpected_end, 0);
+  check("x + ", ParseErrorCode::unexpected_end, 4);
+  check("T-2)", ParseErrorCode::trailing_input, 3);
+  check("((T-2)*2", ParseErrorCode::unexpected_token, 8);
+  check("2 * )", ParseErrorCode::invalid_token, 4);
+  check("x # y", ParseErrorCode::unrecognised_token, 2);
+  check("1.2.3", ParseErrorCode::misplaced_decimal_point, 0);
+  check("1e+", ParseErrorCode::malformed_exponent, 0);
+  check("1e2e3", ParseErrorCode::double_exponent, 0);
+  check("x y", ParseErrorCode::expected_operator, 2);
+  check("[1, 2", ParseErrorCode::unexpected_token, 5);
+  check("{1:2}", ParseErrorCode::invalid_dict_key, 1);
+
+  //The message is that of the exception thrown by Expr(const std::string&)
+  const ParseResult r = try_parse("((T-2)*2");
+  UNIT_TEST_CHECK_EQUAL(r.message(), "Expected \")\" but found the end of expression instead?\n((T-2)*2\n        ^");
+  try {
+    Expr("((T-2)*2");
+  } catch (const stator::Exception& e) {
+    UNIT_TEST_CHECK(std::string(e.what()).find(r.message()) != std::string::npos);
+  }
+
+  bool thrown = false;
+  try {
+    r.value();
+  } catch (const stator::Exception&) {
+    thrown = true;
+  }
+  UNIT_TEST_CHECK(thrown);
+
+  //A failed result outlives its input
+  const ParseResult t = try_parse(std::string("((T-2)*2"));
+  UNIT_TEST_CHECK_EQUAL(t.message(), r.message());
+  try {
+    t.value();
+  } catch (const stator::Exception& e) {
+    UNIT_TEST_CHECK(std::string(e.what()).find(r.message()) != std::string::npos);
+  }
+}
+
 UNIT_TEST( symbolic_parser_lists )
 {
   //Dogfood a expression back into itself
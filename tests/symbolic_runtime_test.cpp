@@ -253,3 +253,380 @@ UNIT_TEST( symbolic_sub_general )
   UNIT_TEST_CHECK_EQUAL(sub(Expr("x"), Expr("x=2")), Expr("2"));
   UNIT_TEST_CHECK_EQUAL(sub(Expr("x"), Expr("{x:2, y:3}")), Expr("2"));
 }
+
+UNIT_TEST( symbolic_fast_sub )
+{
+  Var< > x;
+  const Expr f("x*sin(y)+z^2/x-ln(y)");
+  UNIT_TEST_CHECK_CLOSE(fast_sub(Expr("x*x+1"), x = 2.0), 5.0, 1e-12);
+
+  //Many variables bound by slot
+  const VarSlots slots({Expr("z"), Expr("x"), Expr("y")});
+  const double values[] = {3.0, 2.0, 0.5};
+  const double r = fast_sub(f, slots, values);
+  UNIT_TEST_CHECK_CLOSE(r, simplify(sub(f, Expr("{x:2, y:0.5, z:3}"))).as<double>(), 1e-12);
+  UNIT_TEST_CHECK_CLOSE(fast_sub(f, slots, std::vector<double>{3.0, 2.0, 0.5}), r, 1e-12);
+
+  //More variable nodes than the slot cache holds, so entries are
+  //evicted and looked up again
+  std::vector<Expr> vars;
+  std::vector<double> many;
+  Expr g(0.0);
+  double expected = 0;
+  auto var = [](int i) { return Expr(VarRT::create("v" + std::to_string(i))); };
+  for (int i(0); i < 200; ++i) {
+    vars.push_back(var(i));
+    many.push_back(i);
+    g = g + var(i) * var(i % 7);
+    expected += i * (i % 7);
+  }
+  UNIT_TEST_CHECK_EQUAL(fast_sub(g, VarSlots(vars), many), expected);
+
+  //Unbound variables are an error
+  try {
+    fast_sub(f, VarSlots({Expr("x"), Expr("y")}), values);
+    UNIT_TEST_ERROR("fast_sub evaluated an unbound variable");
+  } catch (const stator::Exception&) {
+  }
+}
+
+UNIT_TEST( symbolic_deep_expression )
+{
+  //Deep enough to overflow the stack if any of these recursed
+  const std::size_t depth = 200000;
+  const Expr x("x");
+  Expr f = x;
+  double expected = 2;
+  for (std::size_t i(0); i < depth; ++i) {
+    f = BinaryOp<Expr, detail::Add, Expr>::create(f, Expr(double(i % 3 + 1)) * x);
+    expected += 2 * (i % 3 + 1);
+  }
+
+  const VarSlots slots({x});
+  const double value = 2;
+  UNIT_TEST_CHECK_EQUAL(fast_sub(f, slots, &value), expected);
+  UNIT_TEST_CHECK_EQUAL(repr(f).size(), 4 * depth + 1);
+
+  Expr g = sub(f, Expr("x=2"));
+  UNIT_TEST_CHECK_EQUAL(simplify(g), Expr(expected));
+  UNIT_TEST_CHECK_EQUAL(fast_sub(flatten(f), slots, &value), expected);
+
+  //Nesting through other operators, sin(x+sin(x+...))
+  Expr n = x;
+  for (std::size_t i(0); i < depth; ++i)
+    n = sym::sin(Expr(BinaryOp<Expr, detail::Add, Expr>::create(x, n)));
+  const Expr fn = flatten(n);
+  UNIT_TEST_CHECK_EQUAL(fast_sub(fn, slots, &value), fast_sub(n, slots, &value));
+  n = Expr();
+
+  //Comparison of separately built trees, with a container at the
+  //bottom so that no hashes are cached and the whole depth is walked
+  auto build = [&](const Expr& leaf) {
+    auto a = ArrayRT::create(1);
+    a->getStore()[0] = leaf;
+    Expr e(a);
+    for (std::size_t i(0); i < depth; ++i)
+      e = BinaryOp<Expr, detail::Add, Expr>::create(e, Expr(double(i % 3 + 1)) * x);
+    return e;
+  };
+  Expr h = build(x), k = build(x), l = build(Expr("y"));
+  UNIT_TEST_CHECK(h.get() != k.get());
+  UNIT_TEST_CHECK(h == k);
+  UNIT_TEST_CHECK(h != l);
+
+  //Destruction is also non-recursive
+  f = Expr();
+  g = Expr();
+  h = k = l = Expr();
+}
+
+UNIT_TEST( symbolic_nary_ops )
+{
+  //Sums and products are flattened into single canonical nodes
+  const Expr f = flatten(Expr("x+2*y+3*x-1"));
+  UNIT_TEST_CHECK_EQUAL(f->_type_idx, int(detail::Type_index<SumRT>::value));
+  UNIT_TEST_CHECK_EQUAL(f.as<SumRT>()._terms.size(), 2u);
+  UNIT_TEST_CHECK_EQUAL(f.as<SumRT>()._constant, -1);
+  UNIT_TEST_CHECK_EQUAL(flatten(Expr("2*y+4*x-1")), f);
+  UNIT_TEST_CHECK_EQUAL(std::hash<Expr>{}(flatten(Expr("z+y+x"))), std::hash<Expr>{}(flatten(Expr("x+z+y"))));
+  UNIT_TEST_CHECK_EQUAL(flatten(Expr("a*b*c")), flatten(Expr("c*(a*b)")));
+  UNIT_TEST_CHECK(flatten(Expr("a*b*c")) != flatten(Expr("a*b+c")));
+
+  //Like factors and constants are merged, and trivial results collapse
+  UNIT_TEST_CHECK_EQUAL(flatten(Expr("x*x/y^3/y")), flatten(Expr("x^2/y^4")));
+  UNIT_TEST_CHECK_EQUAL(flatten(Expr("x+3*x+2")), flatten(Expr("4*x+2")));
+  UNIT_TEST_CHECK_EQUAL(flatten(Expr("x*1")), Expr("x"));
+
+  //Terms are not cancelled where that changes the value, which is
+  //left to simplify
+  const Expr zero_log = BinaryOp<Expr, detail::Multiply, Expr>::create(Expr(0.0), Expr("ln(x)"));
+  const VarSlots xy({Expr("x"), Expr("y")});
+  for (const Expr& g : {Expr("x/x"), Expr("x^2*x^-2"), Expr("x*y*x/y^3"), Expr("x-x+2"), Expr("ln(x)-ln(x)"), zero_log}) {
+    const Expr fg = flatten(g);
+    UNIT_TEST_CHECK(fg->_type_idx != detail::Type_index<ConstantRT<double> >::value);
+    for (const double x : {0.0, -1.0}) {
+      const double values[] = {x, 0.0};
+      UNIT_TEST_CHECK_EQUAL(std::isnan(fast_sub(fg, xy, values)), std::isnan(fast_sub(g, xy, values)));
+    }
+  }
+  UNIT_TEST_CHECK_EQUAL(simplify(flatten(Expr("x/x"))), Expr("1"));
+  UNIT_TEST_CHECK_EQUAL(simplify(flatten(Expr("x*y*x/y^3"))), flatten(Expr("x^2/y^2")));
+  UNIT_TEST_CHECK_EQUAL(simplify(flatten(Expr("x-x+2"))), Expr("2"));
+  UNIT_TEST_CHECK_EQUAL(simplify(flatten(zero_log)), Expr("0"));
+  UNIT_TEST_CHECK(std::isnan(simplify(sub(flatten(Expr("x/x")), Expr("x=0"))).as<double>()));
+
+  //Shared chains are gathered once, rather than along each of the
+  //2^60 paths through them
+  {
+    const Expr s = sym::sin(Expr("x"));
+    Expr p = s, q = s + Expr("y");
+    for (int i(0); i < 60; ++i) {
+      p = p * p;
+      q = q + q;
+    }
+    UNIT_TEST_CHECK_EQUAL(flatten(p), flatten(Expr(BinaryOp<Expr, detail::Power, Expr>::create(s, Expr(std::pow(2.0, 60))))));
+    UNIT_TEST_CHECK_EQUAL(flatten(q), flatten(Expr(std::pow(2.0, 60)) * s + Expr(std::pow(2.0, 60)) * Expr("y")));
+    //Negative exponents are kept apart from positive ones
+    const Expr r = s * s / (s * s);
+    UNIT_TEST_CHECK_EQUAL(flatten(r * r), flatten(Expr("sin(x)^4/sin(x)^4")));
+  }
+
+  //Non-integer powers do not distribute over products, nor fold
+  //into integer powers
+  UNIT_TEST_CHECK(flatten(Expr("(x*y)^0.5")) != flatten(Expr("x^0.5*y^0.5")));
+  UNIT_TEST_CHECK(flatten(Expr("(x^0.5)^2")) != Expr("x"));
+  UNIT_TEST_CHECK(flatten(Expr("x^0.5*x^0.5")) != Expr("x"));
+  UNIT_TEST_CHECK_EQUAL(flatten(Expr("(x^0.5)^2")), flatten(Expr("x^0.5*x^0.5")));
+
+  //Factors of products are never products, non-integer powers are
+  //Power nodes
+  detail::NaryBuilder<detail::Multiply> builder;
+  builder.add(flatten(Expr("x*y")), 0.5);
+  builder.add(Expr("z"));
+  for (const Expr& g : {flatten(Expr("(x*y)^0.5*z")), builder.finish()}) {
+    UNIT_TEST_CHECK_EQUAL(g, flatten(Expr("(x*y)^0.5*z")));
+    for (const auto& t : g.as<ProductRT>()._terms) {
+      UNIT_TEST_CHECK(t.first->_type_idx != detail::Type_index<ProductRT>::value);
+      UNIT_TEST_CHECK_EQUAL(t.second, 1);
+    }
+  }
+
+  //The representation parses back to an equal expression
+  for (const char* s : {"x+2*y+3*x-1", "-(a+b)-c", "x/(y*z)", "a-b*c*2+sin(a+b+a)", "2-x", "-x*y"}) {
+    const Expr g = flatten(Expr(s));
+    UNIT_TEST_CHECK_EQUAL(flatten(Expr(repr(g))), g);
+  }
+
+  //Including products with powers as factors, which keep their value
+  for (const char* s : {"(x^2)^0.5", "(x^2)^0.5*y", "(x^0.5)^2*y", "((x^2)^0.5)^3", "(x*y)^0.5*z", "x^2/(x^3)^0.5"}) {
+    const Expr g = flatten(Expr(s));
+    UNIT_TEST_CHECK_EQUAL(flatten(Expr(repr(g))), g);
+    const VarSlots slots({Expr("x"), Expr("y"), Expr("z")});
+    const double values[] = {-3.0, 2.0, 0.5};
+    const double expected = fast_sub(Expr(s), slots, values);
+    if (std::isnan(expected))
+      UNIT_TEST_CHECK(std::isnan(fast_sub(Expr(repr(g)), slots, values)));
+    else
+      UNIT_TEST_CHECK_CLOSE(fast_sub(Expr(repr(g)), slots, values), expected, 1e-12);
+  }
+
+  //Evaluation and transformations match the binary form
+  const Expr h("x*x*y+3*x+sin(x*y)-y/x");
+  const Expr fh = flatten(h);
+  const VarSlots slots({Expr("x"), Expr("y")});
+  const double values[] = {2.0, 3.0};
+  UNIT_TEST_CHECK_CLOSE(fast_sub(fh, slots, values), fast_sub(h, slots, values), 1e-12);
+  UNIT_TEST_CHECK_CLOSE(fast_sub(derivative(fh, Expr("x")), slots, values), fast_sub(derivative(h, Expr("x")), slots, values), 1e-12);
+  UNIT_TEST_CHECK_CLOSE(simplify(sub(fh, Expr("{x:2, y:3}"))).as<double>(), fast_sub(h, slots, values), 1e-12);
+
+  //Simplification merges into flattened nodes
+  UNIT_TEST_CHECK_EQUAL(simplify(fh + Expr("x") - fh), Expr("x"));
+}
+
+UNIT_TEST( symbolic_interning )
+{
+  InterningScope scope;
+
+  //Structurally equal expressions share a single node
+  Expr f("sin(x*y)+x*y");
+  Expr g("sin(x*y)+x*y");
+  UNIT_TEST_CHECK(f.get() == g.get());
+  UNIT_TEST_CHECK(f->_interned);
+  UNIT_TEST_CHECK_EQUAL(f, g);
+
+  //The shared x*y subterm is held once
+  const auto& sum = f.as<AddOp<Expr, Expr> >();
+  typedef UnaryOp<Expr, detail::Sine> SinOp;
+  UNIT_TEST_CHECK(sum._l.as<SinOp>()._arg.get() == sum._r.get());
+
+  //Different expressions remain unequal
+  UNIT_TEST_CHECK(Expr("sin(x*y)+x*z") != f);
+  UNIT_TEST_CHECK(Expr("sin(x*y)+y*x") != f);
+
+  //Comparison semantics of constants are preserved
+  UNIT_TEST_CHECK_EQUAL(Expr(2.0), Expr(2));
+  UNIT_TEST_CHECK_EQUAL(Expr(0.0), Expr(-0.0));
+  Expr nan(std::numeric_limits<double>::quiet_NaN());
+  UNIT_TEST_CHECK(nan != nan);
+
+  //Results of transformations are interned too
+  auto x_ptr = VarRT::create("x");
+  UNIT_TEST_CHECK(simplify(derivative(f, *x_ptr)).get() == simplify(derivative(g, *x_ptr)).get());
+
+  //Nodes holding containers are not interned, but still compare structurally
+  Expr a = Expr("[x, y]") + Expr("z");
+  Expr b = Expr("[x, y]") + Expr("z");
+  UNIT_TEST_CHECK(!a->_interned);
+  UNIT_TEST_CHECK(a.get() != b.get());
+  UNIT_TEST_CHECK_EQUAL(a, b);
+}
+
+UNIT_TEST( symbolic_interning_mixed )
+{
+  //Interned and plain nodes still compare structurally
+  Expr plain("x*sin(y)");
+  Expr interned;
+  {
+    InterningScope scope;
+    interned = Expr("x*sin(y)");
+  }
+  UNIT_TEST_CHECK(!plain->_interned);
+  UNIT_TEST_CHECK(interned->_interned);
+  UNIT_TEST_CHECK_EQUAL(plain, interned);
+  UNIT_TEST_CHECK_EQUAL(interned, plain);
+  UNIT_TEST_CHECK(!interning());
+}
+
+UNIT_TEST( symbolic_interning_clear )
+{
+  //Nodes interned before the table is cleared still equal new ones
+  InterningScope scope;
+  Expr a("x");
+  Expr f("sin(x)");
+  detail::InternTable::get().clear();
+  Expr b("x");
+  UNIT_TEST_CHECK(a.get() != b.get());
+  UNIT_TEST_CHECK_EQUAL(a, b);
+  UNIT_TEST_CHECK_EQUAL(Expr("sin(x)"), sin(a));
+  UNIT_TEST_CHECK_EQUAL(f, Expr("sin(x)"));
+
+  //Nodes of the new generation are shared again
+  UNIT_TEST_CHECK(Expr("sin(x)").get() == Expr("sin(x)").get());
+}
+
+UNIT_TEST( symbolic_node_ptr )
+{
+  //The reference count is held in the node
+  Expr f("x*y");
+  UNIT_TEST_CHECK_EQUAL(f.use_count(), 1);
+  Expr g = f;
+  UNIT_TEST_CHECK_EQUAL(f.use_count(), 2);
+  Expr h(*f);
+  UNIT_TEST_CHECK_EQUAL(f.use_count(), 3);
+
+  //Moves transfer the reference
+  Expr m(std::move(g));
+  UNIT_TEST_CHECK(!g);
+  UNIT_TEST_CHECK_EQUAL(f.use_count(), 3);
+  g = std::move(m);
+  UNIT_TEST_CHECK(!m);
+  UNIT_TEST_CHECK_EQUAL(g.get(), f.get());
+  h.reset();
+  UNIT_TEST_CHECK_EQUAL(f.use_count(), 2);
+
+  //Nodes leave the intern table when their last reference goes
+  InterningScope scope;
+  const std::size_t interned = detail::InternTable::get().size();
+  Expr i("p*q+sin(r)");
+  UNIT_TEST_CHECK_EQUAL(detail::InternTable::get().size(), interned + 6);
+  Expr j("p*q");
+  UNIT_TEST_CHECK_EQUAL(detail::InternTable::get().size(), interned + 6);
+  UNIT_TEST_CHECK_EQUAL(j.use_count(), 2);
+  i.reset();
+  UNIT_TEST_CHECK_EQUAL(detail::InternTable::get().size(), interned + 3);
+  j.reset();
+  UNIT_TEST_CHECK_EQUAL(detail::InternTable::get().size(), interned);
+}
+
+UNIT_TEST( symbolic_node_arena )
+{
+  //The allocation counts are tested in symbolic_stats_test
+  Expr g;
+  {
+    NodeArena arena;
+    NodeArenaScope scope(arena);
+    g = Expr("x*x+sin(y)");
+  }
+
+  //Nodes outlive the arena and its scope
+  UNIT_TEST_CHECK_EQUAL(g, Expr("x*x+sin(y)"));
+  auto x_ptr = VarRT::create("x");
+  UNIT_TEST_CHECK_EQUAL(simplify(derivative(g, *x_ptr)), Expr("x+x"));
+  g = Expr();
+
+  //Chunks too small to hold a node are enlarged
+  for (std::size_t chunk_size : {0, 16}) {
+    NodeArena arena(chunk_size);
+    NodeArenaScope scope(arena);
+    g = Expr("x*x+sin(y)");
+    UNIT_TEST_CHECK_EQUAL(g, Expr("x*x+sin(y)"));
+  }
+  g = Expr();
+}
+
+UNIT_TEST( symbolic_simplify_shared )
+{
+  //A DAG with 2^40 leaves but only 40 distinct nodes, which could
+  //never be simplified as a tree
+  Expr f("x+0");
+  for (int i(0); i < 40; ++i)
+    f = f * f;
+
+  Expr g = simplify(f);
+  //The sharing is kept in the result
+  for (int i(0); i < 39; ++i) {
+    const auto& op = g.as<BinaryOp<Expr, detail::Multiply, Expr> >();
+    UNIT_TEST_CHECK_EQUAL(op._l.get(), op._r.get());
+    g = op._l;
+  }
+  const auto& op = g.as<BinaryOp<Expr, detail::Multiply, Expr> >();
+  UNIT_TEST_CHECK_EQUAL(op._l, Expr("x"));
+
+  auto x_ptr = VarRT::create("x");
+  UNIT_TEST_CHECK_EQUAL(simplify(derivative(Expr("x*x*x"), *x_ptr)), Expr("(x+x)*x+x*x"));
+}
+
+UNIT_TEST( symbolic_cached_hash )
+{
+  const Expr f("sin(x*y)+2^x-ln(-z)");
+  const Expr g("sin(x*y)+2^x-ln(-z)");
+  UNIT_TEST_CHECK(f->_hash_cached);
+  UNIT_TEST_CHECK_EQUAL(std::hash<Expr>{}(f), std::hash<Expr>{}(g));
+
+  //The stored hash matches a full traversal
+  detail::HashRT visitor;
+  UNIT_TEST_CHECK_EQUAL(f->hash(), f->visit(visitor));
+
+  //Unequal expressions of the same type are rejected by their hash
+  UNIT_TEST_CHECK(f != Expr("sin(x*y)+2^x-ln(-y)"));
+  UNIT_TEST_CHECK(f == g);
+
+  //Containers are mutable, so are hashed on request
+  const Expr a("[x, y+1]");
+  UNIT_TEST_CHECK(!a->_hash_cached);
+  UNIT_TEST_CHECK_EQUAL(std::hash<Expr>{}(a), std::hash<Expr>{}(Expr("[x, y+1]")));
+  UNIT_TEST_CHECK_EQUAL(Expr("[x, y+1]") + f, a + g);
+
+  //As are the expressions holding them, so a change to a container
+  //is seen by its parents
+  auto c = ArrayRT::create(1), d = ArrayRT::create(1);
+  c->getStore()[0] = d->getStore()[0] = Expr("x");
+  const Expr h = sin(Expr(c)) * Expr("y"), k = sin(Expr(d)) * Expr("y");
+  UNIT_TEST_CHECK(!h->_hash_cached);
+  UNIT_TEST_CHECK(h == k);
+  c->getStore()[0] = Expr("z");
+  UNIT_TEST_CHECK(h != k);
+  d->getStore()[0] = Expr("z");
+  UNIT_TEST_CHECK(h == k);
+  UNIT_TEST_CHECK_EQUAL(std::hash<Expr>{}(h), std::hash<Expr>{}(k));
+}
@@ -0,0 +1,168 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//stator
+#include <stator/symbolic/serialize.hpp>
+#include <stator/symbolic/sparse_polynomial.hpp>
+#define UNIT_TEST_SUITE_NAME Symbolic_Serialize
+#define UNIT_TEST_GOOGLE
+#include <stator/unit_test.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+using namespace sym;
+
+namespace {
+  Expr round_trip(const Expr& f) { return deserialize(serialize(f)); }
+
+  //Check the round trip of an expression is exact
+  void check_round_trip(const Expr& f) {
+    const std::string bytes = serialize(f);
+    const Expr g = deserialize(bytes);
+    UNIT_TEST_CHECK(g == f);
+    //Dictionary entries are written in a deterministic order, but
+    //the repr of a dictionary follows the iteration order of its hash
+    //map, which depends on the order the entries were inserted
+    if (f->_type_idx != detail::Type_index<DictRT>::value) {
+      UNIT_TEST_CHECK_EQUAL(repr(g), repr(f));
+    } else {
+      UNIT_TEST_CHECK_EQUAL(repr(round_trip(g)), repr(g));
+    }
+    UNIT_TEST_CHECK(serialize(g) == bytes);
+  }
+
+  bool rejected(const std::string& bytes) {
+    try {
+      deserialize(bytes);
+    } catch (const stator::Exception&) {
+      return true;
+    }
+    return false;
+  }
+}
+
+UNIT_TEST( serialize_round_trip )
+{
+  for (const std::string s : {"x", "1.5", "sin(x)+cos(y)-ln(z)*exp(x)/y^2", "-x", "x=y+1", "[1,x,y*z][1]", "{x:1, y:sin(z)}"})
+    check_round_trip(Expr(s));
+
+  const Expr x("x");
+  check_round_trip(Expr(BinaryOp<Expr, detail::Units, Expr>::create(Expr(2.0), x)));
+  check_round_trip(Expr(BinaryOp<Expr, detail::Uncertainty, Expr>::create(Expr(1.0), Expr(0.1))));
+  check_round_trip(Expr(UnaryOp<Expr, detail::Arbsign>::create(x)));
+  check_round_trip(Expr(UnaryOp<Expr, detail::Absolute>::create(x)));
+
+  //Flattened sums and products keep the order of their terms
+  check_round_trip(expand(Expr("(x+2*y-z)^3*sin(x)/y")));
+
+  //Constants are kept bit for bit
+  for (const double v : {-0.0, 0.1, 1e-310, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::max()}) {
+    const double r = round_trip(Expr(v)).as<ConstantRT<double>>().get();
+    UNIT_TEST_CHECK(std::memcmp(&r, &v, sizeof(double)) == 0);
+  }
+  UNIT_TEST_CHECK(std::isnan(round_trip(Expr(std::nan(""))).as<ConstantRT<double>>().get()));
+
+  //Empty expressions, and empty array elements
+  UNIT_TEST_CHECK(!round_trip(Expr()));
+
+  //The image of a dictionary does not depend on its insertion order
+  UNIT_TEST_CHECK(serialize(Expr("{x:1, y:2, z:3}")) == serialize(Expr("{z:3, y:2, x:1}")));
+  auto a_ptr = ArrayRT::create(3);
+  (*a_ptr)[0] = Expr("[x, [y]]");
+  (*a_ptr)[2] = Expr("{x:[1,2]}");
+  const Expr a(a_ptr);
+  const Expr b = round_trip(a);
+  UNIT_TEST_CHECK(!b.as<ArrayRT>()[1]);
+  UNIT_TEST_CHECK(b.as<ArrayRT>()[0] == a.as<ArrayRT>()[0]);
+  UNIT_TEST_CHECK(b.as<ArrayRT>()[2] == a.as<ArrayRT>()[2]);
+}
+
+UNIT_TEST( serialize_shared_subexpressions )
+{
+  //A DAG whose tree would have 2^40 leaves
+  Expr f("sin(x)+y");
+  for (int i(0); i < 40; ++i)
+    f = Expr(BinaryOp<Expr, detail::Multiply, Expr>::create(f, f));
+  const std::string bytes = serialize(f);
+  const ExprImage image(bytes);
+  UNIT_TEST_CHECK_EQUAL(image.size(), 44u);
+  UNIT_TEST_CHECK_EQUAL(image.type(image.root()), int(detail::Type_index<BinaryOp<Expr, detail::Multiply, Expr>>::value));
+  UNIT_TEST_CHECK_EQUAL(image.operand(image.root(), 0), image.operand(image.root(), 1));
+  UNIT_TEST_CHECK(serialize(deserialize(bytes)) == bytes);
+
+  //Structurally equal subexpressions are merged too
+  InterningScope off(false);
+  const ExprImage sum(serialize(Expr("sin(x)*y+sin(x)*y")));
+  UNIT_TEST_CHECK_EQUAL(sum.size(), 5u);
+
+  //The image may be read without rebuilding the expression
+  const std::string vbytes = serialize(Expr("[foo, 2.5]"));
+  const ExprImage v(vbytes);
+  UNIT_TEST_CHECK_EQUAL(v.operands(v.root()), 2u);
+  UNIT_TEST_CHECK(v.name(v.operand(v.root(), 0)) == "foo");
+  UNIT_TEST_CHECK_EQUAL(v.constant(v.operand(v.root(), 1)), 2.5);
+}
+
+UNIT_TEST( serialize_files_and_errors )
+{
+  const Expr f("{x:sin(y)^2, z:[1, x*y]}");
+  const std::string filename = "symbolic_serialize_test.bin";
+  save(f, filename);
+  UNIT_TEST_CHECK(load(filename) == f);
+  {
+    MappedFile file(filename);
+    UNIT_TEST_CHECK(file.bytes() == serialize(f));
+  }
+  std::remove(filename.c_str());
+
+  const std::string bytes = serialize(Expr("sin(x)*y"));
+  UNIT_TEST_CHECK(!rejected(bytes));
+  UNIT_TEST_CHECK(rejected(""));
+  UNIT_TEST_CHECK(rejected(bytes.substr(0, bytes.size() - 1)));
+  UNIT_TEST_CHECK(rejected("X" + bytes.substr(1)));
+
+  //Operands must precede their users
+  std::string cyclic = bytes;
+  const std::uint32_t self = 1;
+  std::memcpy(&cyclic[ExprImage::header_size + ExprImage::node_size + 8], &self, sizeof(self));
+  UNIT_TEST_CHECK(rejected(cyclic));
+
+  //Dictionary keys may not be empty
+  {
+    std::string dict = serialize(Expr("{x:1}"));
+    const ExprImage image(dict);
+    std::uint64_t offset;
+    std::memcpy(&offset, &dict[ExprImage::header_size + ExprImage::node_size * image.root() + 8], sizeof(offset));
+    const std::uint64_t null = ExprImage::null;
+    std::memcpy(&dict[ExprImage::header_size + ExprImage::node_size * image.size() + 8 * offset], &null, sizeof(null));
+    UNIT_TEST_CHECK(rejected(dict));
+  }
+
+  //Sums and products have at least one term
+  {
+    std::string product = serialize(flatten(Expr("2*x*y^3")));
+    const ExprImage image(product);
+    UNIT_TEST_CHECK_EQUAL(image.type(image.root()), int(detail::Type_index<ProductRT>::value));
+    const std::uint32_t none = 0;
+    std::memcpy(&product[ExprImage::header_size + ExprImage::node_size * image.root() + 4], &none, sizeof(none));
+    UNIT_TEST_CHECK(rejected(product));
+  }
+}
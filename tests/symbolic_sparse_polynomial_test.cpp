@@ -0,0 +1,156 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//stator
+#include <stator/symbolic/sparse_polynomial.hpp>
+#define UNIT_TEST_SUITE_NAME Symbolic_Sparse_Polynomial
+#define UNIT_TEST_GOOGLE
+#include <stator/unit_test.hpp>
+
+using namespace sym;
+
+UNIT_TEST( sparse_polynomial_arithmetic )
+{
+  const SparsePolynomial p(Expr("(x+y)^2"));
+  UNIT_TEST_CHECK_EQUAL(p.size(), 3u);
+  UNIT_TEST_CHECK_EQUAL(p.degree(), 2u);
+  UNIT_TEST_CHECK_EQUAL(p.generators().size(), 2u);
+  UNIT_TEST_CHECK_EQUAL(p.coefficient({1, 1}), 2.0);
+  UNIT_TEST_CHECK_EQUAL(p.coefficient({0, 2, 0}), 1.0);
+  UNIT_TEST_CHECK_EQUAL(p.coefficient({3}), 0.0);
+
+  UNIT_TEST_CHECK((p * p).to_expr() == flatten(Expr("x^4+4*x^3*y+6*x^2*y^2+4*x*y^3+y^4")));
+  UNIT_TEST_CHECK(pow(p, 2) == p * p);
+  UNIT_TEST_CHECK(pow(p, 0) == SparsePolynomial(1.0));
+  UNIT_TEST_CHECK_EQUAL((p - p).size(), 0u);
+  UNIT_TEST_CHECK_EQUAL((p * 0).size(), 0u);
+  UNIT_TEST_CHECK((p + p) == 2 * p);
+
+  //Polynomials with differently ordered generators are realigned
+  const SparsePolynomial q(Expr("z*y+x"));
+  UNIT_TEST_CHECK(SparsePolynomial(Expr("x+y")) == SparsePolynomial(Expr("y+x")));
+  UNIT_TEST_CHECK((q + p).to_expr() == flatten(Expr("x^2+2*x*y+y^2+y*z+x")));
+  UNIT_TEST_CHECK((q * p).to_expr() == expand(Expr("(z*y+x)*(x+y)^2")));
+  UNIT_TEST_CHECK_EQUAL((q - SparsePolynomial::generator(Expr("x"))).size(), 1u);
+
+  //Division by constants, and constant powers, are folded
+  UNIT_TEST_CHECK(SparsePolynomial(Expr("(2*x+4)/2-2^2")) == SparsePolynomial(Expr("x-2")));
+}
+
+UNIT_TEST( sparse_polynomial_generators )
+{
+  //Non-polynomial subexpressions are generators
+  const SparsePolynomial p(Expr("sin(x)*(x+1)"));
+  UNIT_TEST_CHECK_EQUAL(p.size(), 2u);
+  UNIT_TEST_CHECK_EQUAL(p.generators().size(), 2u);
+
+  //Only the generators in use are kept
+  const SparsePolynomial s(Expr("sin(x+y)^2"));
+  UNIT_TEST_CHECK_EQUAL(s.generators().size(), 1u);
+  UNIT_TEST_CHECK(s.generators()[0] == Expr("sin(x+y)"));
+  UNIT_TEST_CHECK_EQUAL(s.coefficient({2}), 1.0);
+
+  //Division gives an inverse generator
+  const SparsePolynomial d(Expr("(x+1)/y"));
+  UNIT_TEST_CHECK_EQUAL(d.size(), 2u);
+  UNIT_TEST_CHECK_EQUAL(d.generators().size(), 2u);
+  UNIT_TEST_CHECK(d.to_expr() == flatten(Expr("x/y+1/y")));
+
+  //Non-integer powers are not expanded
+  UNIT_TEST_CHECK_EQUAL(SparsePolynomial(Expr("(x+1)^0.5")).size(), 1u);
+
+  //The arguments of generators are not converted, here a product
+  //with 2^60 paths through it which would never finish
+  Expr q("x+1");
+  for (int i(0); i < 60; ++i)
+    q = q * q;
+  const SparsePolynomial g(sym::sin(q) * Expr("y"));
+  UNIT_TEST_CHECK_EQUAL(g.size(), 1u);
+  UNIT_TEST_CHECK_EQUAL(g.generators().size(), 2u);
+}
+
+UNIT_TEST( sparse_polynomial_expand )
+{
+  UNIT_TEST_CHECK(expand(Expr("(x+1)*(x-1)")) == flatten(Expr("x^2-1")));
+  UNIT_TEST_CHECK(expand(Expr("(x+1)^2-x^2-2*x")) == Expr(1.0));
+
+  //Division is not cancelled, as x/x is not 1 at x=0 (see flatten)
+  UNIT_TEST_CHECK(expand(Expr("(x+y)/x")) == flatten(Expr("y/x+x/x")));
+  UNIT_TEST_CHECK(expand(Expr("(x+1)^2/x^2")) == flatten(Expr("x^2/x^2+2*x/x^2+1/x^2")));
+  UNIT_TEST_CHECK(simplify(expand(Expr("(x+1)^2/x^2"))) == flatten(Expr("1+2/x+1/x^2")));
+
+  //The arguments of functions are expanded too
+  UNIT_TEST_CHECK(expand(Expr("sin((x+1)^2)")) == expand(Expr("sin(x^2+2*x+1)")));
+  UNIT_TEST_CHECK(expand(Expr("sin((x+1)^2)")) != Expr("sin((x+1)^2)"));
+
+  //The expansion has the same value
+  const Expr f("(x+2*y-1)^5*(x-y)+ln(y)*(x+y)^2/(x+3)");
+  const Expr g = expand(f);
+  const VarSlots slots({Expr("x"), Expr("y")});
+  for (const std::vector<double>& v : {std::vector<double>{0.5, 1.5}, std::vector<double>{-2.0, 3.0}})
+    UNIT_TEST_CHECK_CLOSE(fast_sub(g, slots, v), fast_sub(f, slots, v), 1e-10);
+
+  //Products of large sums
+  Expr a(0.0), b(0.0);
+  const std::string names = "abcdefghijklmnopqrstuvw";
+  for (std::size_t i(0); i < names.size(); ++i) {
+    a = a + Expr(names.substr(i, 1));
+    b = b + Expr(double(i)) * Expr(names.substr(i, 1)) + Expr(1.0);
+  }
+  const std::size_t n = names.size();
+  UNIT_TEST_CHECK_EQUAL(SparsePolynomial(expand(a * a)).size(), n * (n + 1) / 2);
+  UNIT_TEST_CHECK_EQUAL(SparsePolynomial(expand(a * b)).size(), n * (n + 1) / 2 - 1 + n);
+
+  //Array elements are expanded separately
+  UNIT_TEST_CHECK(expand(Expr("[(x+1)^2, x*(x-1)]")) == expand(Expr("[x^2+2*x+1, x^2-x]")));
+}
+
+UNIT_TEST( sparse_polynomial_large_powers )
+{
+  //Powers beyond max_expanded_power are kept whole, as generators
+  for (const char* s : {"x^1e20", "x^-1e20", "(x+y)^100000"}) {
+    const SparsePolynomial p{Expr(s)};
+    UNIT_TEST_CHECK_EQUAL(p.size(), 1u);
+    UNIT_TEST_CHECK(expand(Expr(s)) == flatten(Expr(s)));
+  }
+  UNIT_TEST_CHECK_EQUAL(SparsePolynomial(expand(Expr("(x+y)^64"))).size(), 65u);
+  UNIT_TEST_CHECK(expand(Expr("x*(x+y)^65")) == flatten(Expr("x*(x+y)^65")));
+
+  //As are products and powers with too many terms
+  const Expr g("(a+b+c+d+e+f+g+h+i+j)^64");
+  UNIT_TEST_CHECK_EQUAL(SparsePolynomial(g).size(), 1u);
+  const Expr h = expand(Expr("((x+y+z)^64)^64"));
+  UNIT_TEST_CHECK_EQUAL(h.as<ProductRT>()._terms.size(), 1u);
+  UNIT_TEST_CHECK_EQUAL(h.as<ProductRT>()._terms[0].second, 64);
+  UNIT_TEST_CHECK_EQUAL(h.as<ProductRT>()._terms[0].first.as<SumRT>()._terms.size(), 2145u);
+  UNIT_TEST_CHECK_EQUAL(expand(Expr("(x+y+z)^64*(u+v+w)^64")).as<SumRT>()._terms.size(), 2145u);
+  UNIT_TEST_CHECK_EQUAL(SparsePolynomial(expand(Expr("(x+y+z)^4"))).size(), 15u);
+
+  //As are powers whose exponents would overflow
+  const Expr f("((((((x^64)^64)^64)^64)^64)^64)");
+  UNIT_TEST_CHECK(expand(f) != Expr(1.0));
+  UNIT_TEST_CHECK_EQUAL(SparsePolynomial(f).size(), 1u);
+  UNIT_TEST_CHECK_EQUAL(SparsePolynomial(f).degree(), 1u);
+
+  try {
+    pow(pow(SparsePolynomial::generator(Expr("x")), 1u << 31), 2);
+    UNIT_TEST_ERROR("SparsePolynomial exponent overflowed");
+  } catch (const stator::Exception&) {
+  }
+}
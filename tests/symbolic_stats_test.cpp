@@ -0,0 +1,132 @@
+/*
+  Copyright (C) 2026 Marcus N Campbell Bannerman <m.bannerman@gmail.com>
+
+  This file is part of stator.
+
+  stator is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  stator is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with stator. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//The counters are tested whether or not the rest of the build enables them
+#ifndef STATOR_STATS
+# define STATOR_STATS
+#endif
+
+//stator
+#include <stator/symbolic/ad.hpp>
+#define UNIT_TEST_SUITE_NAME Symbolic_Stats
+#define UNIT_TEST_GOOGLE
+#include <stator/unit_test.hpp>
+
+using namespace sym;
+
+UNIT_TEST( engine_stats_counts )
+{
+  UNIT_TEST_CHECK(engine_stats_enabled());
+
+  reset_engine_stats();
+  const Expr f("sin(x)*2+1");
+  EngineStats s = engine_stats();
+  //sin ( x ) * 2 + 1
+  UNIT_TEST_CHECK_EQUAL(s.tokens, 8u);
+  const int var = detail::Type_index<VarRT>::value;
+  const int sine = detail::Type_index<UnaryOp<Expr, detail::Sine>>::value;
+  const int add = detail::Type_index<BinaryOp<Expr, detail::Add, Expr>>::value;
+  UNIT_TEST_CHECK_EQUAL(s.nodes_created[var], 1u);
+  UNIT_TEST_CHECK_EQUAL(s.nodes_created[sine], 1u);
+  UNIT_TEST_CHECK(s.nodes_created[add] > 0);
+
+  //x*1+0, built directly as the parser already simplifies
+  const Expr x("x");
+  const Expr g(BinaryOp<Expr, detail::Add, Expr>::create(Expr(BinaryOp<Expr, detail::Multiply, Expr>::create(x, Expr(1.0))), Expr(0.0)));
+  reset_engine_stats();
+  simplify(g);
+  s = engine_stats();
+  UNIT_TEST_CHECK_EQUAL(s.simplify_passes, 1u);
+  //x*1 -> x, then x+0 -> x
+  UNIT_TEST_CHECK_EQUAL(s.simplify_rewrites, 2u);
+  UNIT_TEST_CHECK(s.visits("SimplifyRT") > 0);
+  UNIT_TEST_CHECK_EQUAL(s.visits("DerivativeRT"), 0u);
+
+  const Expr f2("sin(x)*2+1");
+  reset_engine_stats();
+  const bool equal = (f == f2);
+  UNIT_TEST_CHECK(equal);
+  const std::size_t h = std::hash<Expr>{}(f);
+  (void)h;
+  s = engine_stats();
+  UNIT_TEST_CHECK(s.compares > 0);
+  UNIT_TEST_CHECK_EQUAL(s.hashes, 1u);
+  UNIT_TEST_CHECK(s.visits("ComparisonVisitor") > 0);
+
+  reset_engine_stats();
+  s = engine_stats();
+  UNIT_TEST_CHECK_EQUAL(s.tokens, 0u);
+  UNIT_TEST_CHECK_EQUAL(s.compares, 0u);
+  UNIT_TEST_CHECK_EQUAL(s.visits(""), 0u);
+  for (std::size_t n : s.nodes_created)
+    UNIT_TEST_CHECK_EQUAL(n, 0u);
+}
+
+UNIT_TEST( node_alloc_stats_counts )
+{
+  //Each node (and its reference count) is a single allocation
+  reset_node_alloc_stats();
+  Expr f = Expr("x") * Expr("x");
+  UNIT_TEST_CHECK_EQUAL(node_alloc_stats().allocations, 3u);
+  UNIT_TEST_CHECK_EQUAL(node_alloc_stats().heap_allocations, 3u);
+
+  Expr g;
+  {
+    NodeArena arena;
+    NodeArenaScope scope(arena);
+    reset_node_alloc_stats();
+    g = Expr("x*x+sin(y)");
+    UNIT_TEST_CHECK(node_alloc_stats().allocations > 0);
+    UNIT_TEST_CHECK_EQUAL(node_alloc_stats().heap_allocations, 0u);
+    UNIT_TEST_CHECK_EQUAL(node_alloc_stats().arena_allocations, node_alloc_stats().allocations);
+  }
+  reset_node_alloc_stats();
+  g = Expr();
+  UNIT_TEST_CHECK(node_alloc_stats().deallocations > 0);
+
+  //fast_sub makes no node allocations
+  const Expr h("x*sin(y)+z^2/x-ln(y)");
+  const VarSlots slots({Expr("z"), Expr("x"), Expr("y")});
+  const double values[] = {3.0, 2.0, 0.5};
+  reset_node_alloc_stats();
+  fast_sub(h, slots, values);
+  UNIT_TEST_CHECK_EQUAL(node_alloc_stats().allocations, 0u);
+}
+
+UNIT_TEST( shared_subexpressions_evaluated_once )
+{
+  //A DAG of a repeated sin(x), with 2^300 paths to it, deep enough
+  //for fast_sub to leave recursion for its explicit stack
+  const Expr x("x");
+  Expr f = sym::sin(x);
+  for (int i(0); i < 300; ++i)
+    f = f * f;
+  const VarSlots slots({x});
+  const double value = M_PI / 2;
+
+  //Each of the 300 products, sin(x), and x are visited once
+  reset_engine_stats();
+  UNIT_TEST_CHECK_CLOSE(fast_sub(f, slots, &value), 1.0, 1e-12);
+  UNIT_TEST_CHECK_EQUAL(engine_stats().visits("FastSubRT"), 302u);
+
+  reset_engine_stats();
+  const Gradient<1> g = gradient<1>(f, slots, &value);
+  UNIT_TEST_CHECK_EQUAL(engine_stats().visits("GradientRT"), 302u);
+  UNIT_TEST_CHECK_CLOSE(g.value, 1.0, 1e-12);
+}